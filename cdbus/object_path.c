@@ -30,6 +30,9 @@
 #include "../common.h"
 #include "helpers.h"
 
+void (* cdbus_g_method_call_hook)(const char * iface_name, const char * method_name);
+void (* cdbus_g_method_done_hook)(const char * iface_name, const char * method_name);
+
 struct cdbus_object_path_interface
 {
   const struct cdbus_interface_descriptor * iface;
@@ -358,6 +361,11 @@ static DBusHandlerResult cdbus_object_path_handler(DBusConnection * connection,
 
   /* Check if there's an interface specified for this method call. */
   iface_name = dbus_message_get_interface(message);
+
+  if (cdbus_g_method_call_hook != NULL)
+  {
+    cdbus_g_method_call_hook(iface_name, call.method_name);
+  }
   if (iface_name != NULL)
   {
     for (iface_ptr = opath_ptr->ifaces; iface_ptr->iface != NULL; iface_ptr++)
@@ -371,7 +379,7 @@ static DBusHandlerResult cdbus_object_path_handler(DBusConnection * connection,
           break;
         }
 
-        goto send_return;
+        goto known_method;
       }
     }
   }
@@ -388,15 +396,24 @@ static DBusHandlerResult cdbus_object_path_handler(DBusConnection * connection,
     for (iface_ptr = opath_ptr->ifaces; iface_ptr->iface != NULL; iface_ptr++)
     {
       call.iface_context = iface_ptr->iface_context;
-      if (!iface_ptr->iface->handler(iface_ptr->iface, &call))
+      if (iface_ptr->iface->handler(iface_ptr->iface, &call))
       {
         /* known method */
-        goto send_return;
+        goto known_method;
       }
     }
   }
 
   cdbus_error(&call, DBUS_ERROR_UNKNOWN_METHOD, "Method \"%s\" with signature \"%s\" on interface \"%s\" doesn't exist", call.method_name, dbus_message_get_signature(message), iface_name);
+  goto send_return;
+
+known_method:
+  /* the method name matched an entry of the interface method table,
+     so the hook gets a bounded set of names */
+  if (cdbus_g_method_done_hook != NULL)
+  {
+    cdbus_g_method_done_hook(iface_ptr->iface->name, call.method_name);
+  }
 
 send_return:
   cdbus_method_return_send(&call);
@@ -37,4 +37,9 @@ bool cdbus_object_path_register(DBusConnection * connection_ptr, cdbus_object_pa
 void cdbus_object_path_unregister(DBusConnection * connection_ptr, cdbus_object_path opath);
 void cdbus_object_path_destroy(DBusConnection * connection_ptr, cdbus_object_path opath);
 
+/* if set, called for each method call dispatched through an object path */
+extern void (* cdbus_g_method_call_hook)(const char * iface_name, const char * method_name);
+/* if set, called when the method handler returns, before the reply is sent */
+extern void (* cdbus_g_method_done_hook)(const char * iface_name, const char * method_name);
+
 #endif /* __CDBUS_OBJECT_PATH_H__ */
@@ -0,0 +1,183 @@
+/* -*- Mode: C ; c-basic-offset: 2 -*- */
+/*
+ * LADI Session Handler (ladish)
+ *
+ * Copyright (C) 2026 ladish authors, see the AUTHORS file
+ *
+ **************************************************************************
+ * This file contains implementation of the intrusive hash table
+ **************************************************************************
+ *
+ * LADI Session Handler is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * LADI Session Handler is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LADI Session Handler. If not, see <http://www.gnu.org/licenses/>
+ * or write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "../common.h"
+#include "hash.h"
+
+#define LADISH_HASH_INITIAL_BUCKETS 16
+
+bool ladish_hash_init(struct ladish_hash * hash_ptr)
+{
+  uint32_t i;
+
+  hash_ptr->buckets = malloc(LADISH_HASH_INITIAL_BUCKETS * sizeof(struct hlist_head));
+  if (hash_ptr->buckets == NULL)
+  {
+    log_error("malloc() failed to allocate hash buckets");
+    return false;
+  }
+
+  for (i = 0; i < LADISH_HASH_INITIAL_BUCKETS; i++)
+  {
+    INIT_HLIST_HEAD(hash_ptr->buckets + i);
+  }
+
+  hash_ptr->mask = LADISH_HASH_INITIAL_BUCKETS - 1;
+  hash_ptr->count = 0;
+
+  return true;
+}
+
+void ladish_hash_uninit(struct ladish_hash * hash_ptr)
+{
+  free(hash_ptr->buckets);
+  hash_ptr->buckets = NULL;
+}
+
+static void ladish_hash_grow(struct ladish_hash * hash_ptr)
+{
+  struct hlist_head * buckets;
+  uint32_t new_size;
+  uint32_t i;
+  struct hlist_node * node_ptr;
+  struct hlist_node * temp_node_ptr;
+  struct ladish_hash_node * entry_ptr;
+
+  new_size = (hash_ptr->mask + 1) * 2;
+
+  buckets = malloc(new_size * sizeof(struct hlist_head));
+  if (buckets == NULL)
+  {
+    /* not fatal, chains will just get longer */
+    log_error("malloc() failed to grow hash buckets to %"PRIu32, new_size);
+    return;
+  }
+
+  for (i = 0; i < new_size; i++)
+  {
+    INIT_HLIST_HEAD(buckets + i);
+  }
+
+  for (i = 0; i <= hash_ptr->mask; i++)
+  {
+    hlist_for_each_safe(node_ptr, temp_node_ptr, hash_ptr->buckets + i)
+    {
+      entry_ptr = hlist_entry(node_ptr, struct ladish_hash_node, siblings);
+      hlist_add_head(node_ptr, buckets + (entry_ptr->hash & (new_size - 1)));
+    }
+  }
+
+  free(hash_ptr->buckets);
+  hash_ptr->buckets = buckets;
+  hash_ptr->mask = new_size - 1;
+}
+
+void ladish_hash_add(struct ladish_hash * hash_ptr, struct ladish_hash_node * node_ptr, uint32_t hash)
+{
+  if (hash_ptr->count > hash_ptr->mask * 2)
+  {
+    ladish_hash_grow(hash_ptr);
+  }
+
+  node_ptr->hash = hash;
+  hlist_add_head(&node_ptr->siblings, ladish_hash_bucket(hash_ptr, hash));
+  hash_ptr->count++;
+}
+
+/* Deleting entry that is not in the hash table is noop */
+void ladish_hash_del(struct ladish_hash * hash_ptr, struct ladish_hash_node * node_ptr)
+{
+  if (!ladish_hash_node_is_hashed(node_ptr))
+  {
+    return;
+  }
+
+  ASSERT(hash_ptr->count > 0);
+  hlist_del_init(&node_ptr->siblings);
+  hash_ptr->count--;
+}
+
+/* Move entry to the bucket of new key, add it if not hashed yet */
+void ladish_hash_rehash(struct ladish_hash * hash_ptr, struct ladish_hash_node * node_ptr, uint32_t hash)
+{
+  ladish_hash_del(hash_ptr, node_ptr);
+  ladish_hash_add(hash_ptr, node_ptr, hash);
+}
+
+uint32_t ladish_hash_u64(uint64_t value)
+{
+  /* 64-bit finalizer of MurmurHash3 */
+  value ^= value >> 33;
+  value *= 0xFF51AFD7ED558CCDULL;
+  value ^= value >> 33;
+  value *= 0xC4CEB9FE1A85EC53ULL;
+  value ^= value >> 33;
+
+  return (uint32_t)value;
+}
+
+uint32_t ladish_hash_ptr(const void * ptr)
+{
+  return ladish_hash_u64((uint64_t)(uintptr_t)ptr);
+}
+
+/* FNV-1a */
+uint32_t ladish_hash_bytes(const void * data, size_t size)
+{
+  const unsigned char * ptr;
+  uint32_t hash;
+
+  hash = 2166136261U;
+
+  for (ptr = data; size > 0; ptr++, size--)
+  {
+    hash ^= *ptr;
+    hash *= 16777619U;
+  }
+
+  return hash;
+}
+
+uint32_t ladish_hash_string(const char * str)
+{
+  const unsigned char * ptr;
+  uint32_t hash;
+
+  hash = 2166136261U;
+
+  for (ptr = (const unsigned char *)str; *ptr != 0; ptr++)
+  {
+    hash ^= *ptr;
+    hash *= 16777619U;
+  }
+
+  return hash;
+}
+
+uint32_t ladish_hash_combine(uint32_t hash1, uint32_t hash2)
+{
+  return ladish_hash_u64(((uint64_t)hash1 << 32) | hash2);
+}
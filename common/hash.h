@@ -0,0 +1,86 @@
+/* -*- Mode: C ; c-basic-offset: 2 -*- */
+/*
+ * LADI Session Handler (ladish)
+ *
+ * Copyright (C) 2026 ladish authors, see the AUTHORS file
+ *
+ **************************************************************************
+ * This file contains interface of the intrusive hash table
+ **************************************************************************
+ *
+ * LADI Session Handler is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * LADI Session Handler is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LADI Session Handler. If not, see <http://www.gnu.org/licenses/>
+ * or write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef HASH_H__B72D4B0C_8D0A_42EA_95B7_574FB437742E__INCLUDED
+#define HASH_H__B72D4B0C_8D0A_42EA_95B7_574FB437742E__INCLUDED
+
+/* The hash table does not own its entries. Objects embed struct ladish_hash_node
+ * and the caller compares keys itself while iterating the bucket of the key hash.
+ * Bucket array grows automatically, so chains stay short. */
+
+struct ladish_hash_node
+{
+  struct hlist_node siblings;
+  uint32_t hash;
+};
+
+struct ladish_hash
+{
+  struct hlist_head * buckets;
+  uint32_t mask;                /* buckets count - 1 */
+  uint32_t count;
+};
+
+bool ladish_hash_init(struct ladish_hash * hash_ptr);
+void ladish_hash_uninit(struct ladish_hash * hash_ptr);
+void ladish_hash_add(struct ladish_hash * hash_ptr, struct ladish_hash_node * node_ptr, uint32_t hash);
+void ladish_hash_del(struct ladish_hash * hash_ptr, struct ladish_hash_node * node_ptr);
+void ladish_hash_rehash(struct ladish_hash * hash_ptr, struct ladish_hash_node * node_ptr, uint32_t hash);
+
+static inline bool ladish_hash_node_is_hashed(const struct ladish_hash_node * node_ptr)
+{
+  return !hlist_unhashed(&node_ptr->siblings);
+}
+
+static inline void ladish_hash_node_init(struct ladish_hash_node * node_ptr)
+{
+  INIT_HLIST_NODE(&node_ptr->siblings);
+}
+
+static inline struct hlist_head * ladish_hash_bucket(const struct ladish_hash * hash_ptr, uint32_t hash)
+{
+  return hash_ptr->buckets + (hash & hash_ptr->mask);
+}
+
+/**
+ * ladish_hash_for_each_possible - iterate over entries that may match a key
+ * @tpos:     the type * to use as a loop counter.
+ * @pos:      the &struct hlist_node to use as a loop counter.
+ * @hash_ptr: the hash table.
+ * @member:   the name of the struct ladish_hash_node within the struct.
+ * @key_hash: hash of the searched key
+ */
+#define ladish_hash_for_each_possible(tpos, pos, hash_ptr, member, key_hash)                \
+  hlist_for_each_entry(tpos, pos, ladish_hash_bucket((hash_ptr), (key_hash)), member.siblings) \
+    if ((tpos)->member.hash == (key_hash))
+
+uint32_t ladish_hash_u64(uint64_t value);
+uint32_t ladish_hash_ptr(const void * ptr);
+uint32_t ladish_hash_string(const char * str);
+uint32_t ladish_hash_bytes(const void * data, size_t size);
+uint32_t ladish_hash_combine(uint32_t hash1, uint32_t hash2);
+
+#endif /* #ifndef HASH_H__B72D4B0C_8D0A_42EA_95B7_574FB437742E__INCLUDED */
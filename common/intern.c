@@ -0,0 +1,139 @@
+/* -*- Mode: C ; c-basic-offset: 2 -*- */
+/*
+ * LADI Session Handler (ladish)
+ *
+ * Copyright (C) 2026 ladish authors, see the AUTHORS file
+ *
+ **************************************************************************
+ * This file contains implementation of the interned strings table
+ **************************************************************************
+ *
+ * LADI Session Handler is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * LADI Session Handler is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LADI Session Handler. If not, see <http://www.gnu.org/licenses/>
+ * or write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stddef.h>
+
+#include "../common.h"
+#include "intern.h"
+#include "hash.h"
+
+struct ladish_interned_string
+{
+  struct ladish_hash_node node;
+  unsigned int refcount;
+  char str[];
+};
+
+static struct ladish_hash g_interned_strings;
+static bool g_interned_strings_initialized;
+
+#define ladish_interned_string_from_str(interned) \
+  ((struct ladish_interned_string *)((char *)(interned) - offsetof(struct ladish_interned_string, str)))
+
+static struct ladish_interned_string * ladish_intern_lookup(const char * str, uint32_t hash)
+{
+  struct hlist_node * node_ptr;
+  struct ladish_interned_string * entry_ptr;
+
+  if (!g_interned_strings_initialized)
+  {
+    return NULL;
+  }
+
+  ladish_hash_for_each_possible(entry_ptr, node_ptr, &g_interned_strings, node, hash)
+  {
+    if (strcmp(entry_ptr->str, str) == 0)
+    {
+      return entry_ptr;
+    }
+  }
+
+  return NULL;
+}
+
+const char * ladish_intern(const char * str)
+{
+  uint32_t hash;
+  struct ladish_interned_string * entry_ptr;
+  size_t len;
+
+  hash = ladish_hash_string(str);
+
+  entry_ptr = ladish_intern_lookup(str, hash);
+  if (entry_ptr != NULL)
+  {
+    entry_ptr->refcount++;
+    return entry_ptr->str;
+  }
+
+  if (!g_interned_strings_initialized)
+  {
+    if (!ladish_hash_init(&g_interned_strings))
+    {
+      return NULL;
+    }
+
+    g_interned_strings_initialized = true;
+  }
+
+  len = strlen(str);
+  entry_ptr = malloc(sizeof(struct ladish_interned_string) + len + 1);
+  if (entry_ptr == NULL)
+  {
+    log_error("malloc() failed to allocate interned string '%s'", str);
+    return NULL;
+  }
+
+  memcpy(entry_ptr->str, str, len + 1);
+  entry_ptr->refcount = 1;
+  ladish_hash_add(&g_interned_strings, &entry_ptr->node, hash);
+
+  return entry_ptr->str;
+}
+
+const char * ladish_intern_find(const char * str)
+{
+  struct ladish_interned_string * entry_ptr;
+
+  entry_ptr = ladish_intern_lookup(str, ladish_hash_string(str));
+  return entry_ptr != NULL ? entry_ptr->str : NULL;
+}
+
+const char * ladish_intern_ref(const char * interned)
+{
+  ladish_interned_string_from_str(interned)->refcount++;
+  return interned;
+}
+
+void ladish_intern_release(const char * interned)
+{
+  struct ladish_interned_string * entry_ptr;
+
+  if (interned == NULL)
+  {
+    return;
+  }
+
+  entry_ptr = ladish_interned_string_from_str(interned);
+  ASSERT(entry_ptr->refcount > 0);
+
+  entry_ptr->refcount--;
+  if (entry_ptr->refcount == 0)
+  {
+    ladish_hash_del(&g_interned_strings, &entry_ptr->node);
+    free(entry_ptr);
+  }
+}
@@ -0,0 +1,45 @@
+/* -*- Mode: C ; c-basic-offset: 2 -*- */
+/*
+ * LADI Session Handler (ladish)
+ *
+ * Copyright (C) 2026 ladish authors, see the AUTHORS file
+ *
+ **************************************************************************
+ * This file contains interface of the interned strings table
+ **************************************************************************
+ *
+ * LADI Session Handler is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * LADI Session Handler is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LADI Session Handler. If not, see <http://www.gnu.org/licenses/>
+ * or write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef INTERN_H__6A1E83D2_57C4_4F0B_A3E9_1D0C9B2F7E45__INCLUDED
+#define INTERN_H__6A1E83D2_57C4_4F0B_A3E9_1D0C9B2F7E45__INCLUDED
+
+/* Interned strings are stored once and reference counted.
+ * Two interned strings are equal if and only if their pointers are equal. */
+
+/* Get interned copy of a string, with a reference. NULL on failure. */
+const char * ladish_intern(const char * str);
+
+/* Get interned copy of a string if it exists, without a reference. */
+const char * ladish_intern_find(const char * str);
+
+/* Add reference to an interned string, returns the string itself */
+const char * ladish_intern_ref(const char * interned);
+
+/* Drop reference to an interned string, NULL is ignored */
+void ladish_intern_release(const char * interned);
+
+#endif /* #ifndef INTERN_H__6A1E83D2_57C4_4F0B_A3E9_1D0C9B2F7E45__INCLUDED */
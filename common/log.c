@@ -31,6 +31,9 @@
 #include <time.h>
 #include <stdarg.h>
 #include <sys/stat.h>
+#include <unistd.h>
+#include <signal.h>
+#include <pthread.h>
 
 #include "../common/catdup.h"
 #include "../common/dirhelpers.h"
@@ -41,6 +44,7 @@
 
 #if !defined(LOG_OUTPUT_STDOUT)
 static ino_t g_log_file_ino;
+static time_t g_log_file_checked; /* rotation is checked at most once per second */
 static FILE * g_logfile;
 static char * g_log_filename;
 
@@ -49,9 +53,18 @@ static bool ladish_log_open(void)
     struct stat st;
     int ret;
     int retry;
+    time_t now;
 
     if (g_logfile != NULL)
     {
+        now = time(NULL);
+        if (now == g_log_file_checked)
+        {
+            return true;
+        }
+
+        g_log_file_checked = now;
+
         ret = stat(g_log_filename, &st);
         if (ret != 0 || g_log_file_ino != st.st_ino)
         {
@@ -147,6 +160,8 @@ exit:
 void ladish_log_uninit()  __attribute__ ((destructor));
 void ladish_log_uninit()
 {
+  ladish_log_async_stop();
+
   if (g_logfile != NULL)
   {
     fclose(g_logfile);
@@ -154,6 +169,12 @@ void ladish_log_uninit()
 
   free(g_log_filename);
 }
+#else  /* #if !defined(LOG_OUTPUT_STDOUT) */
+void ladish_log_uninit()  __attribute__ ((destructor));
+void ladish_log_uninit()
+{
+  ladish_log_async_stop();
+}
 #endif  /* #if !defined(LOG_OUTPUT_STDOUT) */
 
 #if 0
@@ -175,6 +196,579 @@ ladish_log_enabled(
   return level != LADISH_LOG_LEVEL_DEBUG;
 }
 
+/* Reopening the log file is allowed only to the thread that owns the
+ * log file, the writer thread or the holder of the drain mutex */
+static FILE * ladish_log_get_stream(unsigned int level, bool reopen)
+{
+#if !defined(LOG_OUTPUT_STDOUT)
+  if (g_logfile != NULL && (!reopen || ladish_log_open()))
+  {
+    return g_logfile;
+  }
+#else
+  (void)reopen;
+#endif
+
+  switch (level)
+  {
+  case LADISH_LOG_LEVEL_DEBUG:
+  case LADISH_LOG_LEVEL_INFO:
+    return stdout;
+  case LADISH_LOG_LEVEL_WARN:
+  case LADISH_LOG_LEVEL_ERROR:
+  case LADISH_LOG_LEVEL_ERROR_PLAIN:
+  default:
+    return stderr;
+  }
+}
+
+/*
+ * Asynchronous backend
+ *
+ * Each producer thread formats messages into its own single producer,
+ * single consumer ring. The writer thread drains all rings in batches.
+ * Producers wait a bit for space in a full ring, messages that still
+ * do not fit are counted and dropped.
+ */
+
+#define LADISH_LOG_RING_SIZE    65536 /* power of two */
+#define LADISH_LOG_RECORD_MAX   4096  /* longer messages are truncated */
+#define LADISH_LOG_RECORD_PAD   UINT32_MAX
+#define LADISH_LOG_FULL_RETRIES 100   /* milliseconds to wait for space in full ring */
+#define LADISH_LOG_WRITER_PERIOD 1    /* seconds, writer wakes up at least this often */
+
+struct ladish_log_record
+{
+  uint32_t size;                /* including this header, multiple of 8 */
+  uint32_t level;               /* LADISH_LOG_RECORD_PAD means skip to the ring start */
+  int64_t timestamp;
+};
+
+struct ladish_log_ring
+{
+  struct ladish_log_ring * next;
+  uint64_t head;                /* written by producer */
+  uint64_t tail;                /* written by consumer */
+  unsigned int dropped;
+  bool orphaned;                /* producer thread exited, freed by the consumer once drained */
+  char data[LADISH_LOG_RING_SIZE] __attribute__((aligned(8)));
+};
+
+static bool g_log_async;
+static bool g_log_writer_stop;
+static bool g_log_writer_wakeup;
+static bool g_log_writer_started;
+static bool g_log_atfork_registered;
+static pthread_t g_log_writer_thread;
+static pthread_mutex_t g_log_writer_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_log_writer_cond = PTHREAD_COND_INITIALIZER;
+static pthread_mutex_t g_log_drain_mutex = PTHREAD_MUTEX_INITIALIZER;
+static bool g_log_drain_mutex_stuck; /* locking it timed out, probably held by a crashed thread */
+static bool g_log_ring_key_created;
+static pthread_key_t g_log_ring_key;
+static struct ladish_log_ring * g_log_rings;
+static __thread struct ladish_log_ring * g_log_thread_ring;
+static __thread bool g_log_thread_is_writer;
+
+static void ladish_log_wake_writer(void);
+
+/* pthread key destructor, runs when a producer thread exits */
+static void ladish_log_release_thread_ring(void * ring)
+{
+  /* messages logged by later destructors go to a new ring */
+  g_log_thread_ring = NULL;
+
+  __atomic_store_n(&((struct ladish_log_ring *)ring)->orphaned, true, __ATOMIC_RELEASE);
+  ladish_log_wake_writer();
+}
+
+static struct ladish_log_ring * ladish_log_get_thread_ring(void)
+{
+  struct ladish_log_ring * ring_ptr;
+
+  ring_ptr = g_log_thread_ring;
+  if (ring_ptr != NULL)
+  {
+    return ring_ptr;
+  }
+
+  ring_ptr = malloc(sizeof(struct ladish_log_ring));
+  if (ring_ptr == NULL)
+  {
+    return NULL;
+  }
+
+  ring_ptr->head = 0;
+  ring_ptr->tail = 0;
+  ring_ptr->dropped = 0;
+  ring_ptr->orphaned = false;
+
+  if (pthread_setspecific(g_log_ring_key, ring_ptr) != 0)
+  {
+    free(ring_ptr);
+    return NULL;
+  }
+
+  /* rings of exited threads are freed by ladish_log_drain() */
+  ring_ptr->next = __atomic_load_n(&g_log_rings, __ATOMIC_RELAXED);
+  while (!__atomic_compare_exchange_n(&g_log_rings, &ring_ptr->next, ring_ptr, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+
+  g_log_thread_ring = ring_ptr;
+  return ring_ptr;
+}
+
+static void ladish_log_wake_writer(void)
+{
+  if (__atomic_exchange_n(&g_log_writer_wakeup, true, __ATOMIC_ACQ_REL))
+  {
+    return;                     /* writer is going to drain anyway */
+  }
+
+  pthread_mutex_lock(&g_log_writer_mutex);
+  pthread_cond_signal(&g_log_writer_cond);
+  pthread_mutex_unlock(&g_log_writer_mutex);
+}
+
+static
+bool
+ladish_log_push(
+  unsigned int level,
+  const char * file,
+  unsigned int line,
+  const char * func,
+  const char * format,
+  va_list ap)
+{
+  struct ladish_log_ring * ring_ptr;
+  struct ladish_log_record record;
+  char buffer[LADISH_LOG_RECORD_MAX];
+  const char * color;
+  size_t len;
+  int ret;
+  uint64_t head;
+  uint64_t tail;
+  size_t offset;
+  size_t contiguous;
+  size_t needed;
+  unsigned int retry;
+
+  if (g_log_thread_is_writer)
+  {
+    return false;
+  }
+
+  ring_ptr = ladish_log_get_thread_ring();
+  if (ring_ptr == NULL)
+  {
+    return false;
+  }
+
+  len = 0;
+  color = NULL;
+  switch (level)
+  {
+  case LADISH_LOG_LEVEL_DEBUG:
+    ret = snprintf(buffer, sizeof(buffer), "%s:%d:%s ", file, line, func);
+    len = ret > 0 ? ladish_min((size_t)ret, sizeof(buffer) - 1) : 0;
+    break;
+  case LADISH_LOG_LEVEL_WARN:
+    color = ANSI_COLOR_YELLOW;
+    break;
+  case LADISH_LOG_LEVEL_ERROR:
+  case LADISH_LOG_LEVEL_ERROR_PLAIN:
+    color = ANSI_COLOR_RED;
+    break;
+  }
+
+  if (color != NULL)
+  {
+    strcpy(buffer, color);
+    len = strlen(color);
+  }
+
+  ret = vsnprintf(buffer + len, sizeof(buffer) - len, format, ap);
+  if (ret > 0)
+  {
+    len = ladish_min(len + ret, sizeof(buffer) - 1);
+  }
+
+  if (color != NULL && len + sizeof(ANSI_RESET) <= sizeof(buffer))
+  {
+    memcpy(buffer + len, ANSI_RESET, sizeof(ANSI_RESET) - 1);
+    len += sizeof(ANSI_RESET) - 1;
+  }
+
+  /* the rounding leaves room for the terminating zero */
+  record.size = (sizeof(record) + len + 8) & ~7U;
+  record.level = level;
+  record.timestamp = time(NULL);
+
+  head = ring_ptr->head;
+  offset = head & (LADISH_LOG_RING_SIZE - 1);
+  contiguous = LADISH_LOG_RING_SIZE - offset;
+  needed = contiguous < record.size ? contiguous + record.size : record.size;
+
+  /* when the ring is full, give the writer some time before dropping */
+  retry = 0;
+  while (true)
+  {
+    tail = __atomic_load_n(&ring_ptr->tail, __ATOMIC_ACQUIRE);
+    if (head + needed - tail <= LADISH_LOG_RING_SIZE)
+    {
+      break;
+    }
+
+    if (!__atomic_load_n(&g_log_async, __ATOMIC_ACQUIRE))
+    {
+      /* the ring will not be drained any time soon, write the message directly */
+      return false;
+    }
+
+    if (retry++ == LADISH_LOG_FULL_RETRIES)
+    {
+      __atomic_fetch_add(&ring_ptr->dropped, 1, __ATOMIC_RELAXED);
+      return true;
+    }
+
+    ladish_log_wake_writer();
+    usleep(1000);
+  }
+
+  if (contiguous < record.size)
+  {
+    if (contiguous >= sizeof(record))
+    {
+      struct ladish_log_record pad;
+
+      pad.size = contiguous;
+      pad.level = LADISH_LOG_RECORD_PAD;
+      pad.timestamp = 0;
+      memcpy(ring_ptr->data + offset, &pad, sizeof(pad));
+    }
+
+    head += contiguous;
+    offset = 0;
+  }
+
+  memcpy(ring_ptr->data + offset, &record, sizeof(record));
+  memcpy(ring_ptr->data + offset + sizeof(record), buffer, len);
+  ring_ptr->data[offset + sizeof(record) + len] = 0;
+
+  __atomic_store_n(&ring_ptr->head, head + record.size, __ATOMIC_RELEASE);
+
+  ladish_log_wake_writer();
+  return true;
+}
+
+static void ladish_log_write_record(unsigned int level, time_t timestamp, const char * text)
+{
+  FILE * stream;
+#if !defined(LOG_OUTPUT_STDOUT)
+  static time_t cached_timestamp;
+  static char timestamp_str[26];
+#endif
+
+  stream = ladish_log_get_stream(level, true);
+
+#if !defined(LOG_OUTPUT_STDOUT)
+  if (timestamp != cached_timestamp || timestamp_str[0] == 0)
+  {
+    cached_timestamp = timestamp;
+    ctime_r(&timestamp, timestamp_str);
+    timestamp_str[24] = 0;
+  }
+
+  fprintf(stream, "%s: ", timestamp_str);
+#else
+  (void)timestamp;
+#endif
+
+  fputs(text, stream);
+  fputs("\n", stream);
+}
+
+/* must be called with the drain mutex locked, returns whether anything was written */
+static bool ladish_log_drain(void)
+{
+  struct ladish_log_ring * ring_ptr;
+  struct ladish_log_ring * prev_ring_ptr;
+  struct ladish_log_ring * next_ring_ptr;
+  bool orphaned;
+  struct ladish_log_record record;
+  uint64_t head;
+  uint64_t tail;
+  size_t offset;
+  size_t contiguous;
+  unsigned int dropped;
+  char text[100];
+  bool written;
+
+  written = false;
+
+  prev_ring_ptr = NULL;
+  for (ring_ptr = __atomic_load_n(&g_log_rings, __ATOMIC_ACQUIRE); ring_ptr != NULL; ring_ptr = next_ring_ptr)
+  {
+    next_ring_ptr = ring_ptr->next;
+
+    /* read before head, so nothing is pushed after the head that is drained below */
+    orphaned = __atomic_load_n(&ring_ptr->orphaned, __ATOMIC_ACQUIRE);
+
+    tail = ring_ptr->tail;
+    head = __atomic_load_n(&ring_ptr->head, __ATOMIC_ACQUIRE);
+
+    while (tail < head)
+    {
+      offset = tail & (LADISH_LOG_RING_SIZE - 1);
+      contiguous = LADISH_LOG_RING_SIZE - offset;
+      if (contiguous < sizeof(record))
+      {
+        tail += contiguous;
+        continue;
+      }
+
+      memcpy(&record, ring_ptr->data + offset, sizeof(record));
+      if (record.level == LADISH_LOG_RECORD_PAD)
+      {
+        tail += contiguous;
+        continue;
+      }
+
+      ladish_log_write_record(record.level, record.timestamp, ring_ptr->data + offset + sizeof(record));
+      tail += record.size;
+      written = true;
+    }
+
+    __atomic_store_n(&ring_ptr->tail, tail, __ATOMIC_RELEASE);
+
+    dropped = __atomic_exchange_n(&ring_ptr->dropped, 0, __ATOMIC_RELAXED);
+    if (dropped != 0)
+    {
+      snprintf(text, sizeof(text), ANSI_COLOR_RED "%u log messages were dropped" ANSI_RESET, dropped);
+      ladish_log_write_record(LADISH_LOG_LEVEL_ERROR, time(NULL), text);
+      written = true;
+    }
+
+    /* Producers push new rings in front of the list head,
+     * so only rings that are not the head can be unlinked here */
+    if (orphaned && prev_ring_ptr != NULL)
+    {
+      prev_ring_ptr->next = next_ring_ptr;
+      free(ring_ptr);
+      continue;
+    }
+
+    prev_ring_ptr = ring_ptr;
+  }
+
+  return written;
+}
+
+static void ladish_log_flush_streams(void)
+{
+#if !defined(LOG_OUTPUT_STDOUT)
+  if (g_logfile != NULL)
+  {
+    fflush(g_logfile);
+  }
+#endif
+
+  fflush(stdout);
+  fflush(stderr);
+}
+
+static void * ladish_log_writer(void * UNUSED(arg))
+{
+  struct timespec deadline;
+  bool stop;
+
+  /* the writer logs its own messages synchronously */
+  g_log_thread_is_writer = true;
+
+  do
+  {
+    __atomic_store_n(&g_log_writer_wakeup, false, __ATOMIC_RELEASE);
+    stop = __atomic_load_n(&g_log_writer_stop, __ATOMIC_ACQUIRE);
+
+    pthread_mutex_lock(&g_log_drain_mutex);
+    if (ladish_log_drain())
+    {
+      ladish_log_flush_streams();
+    }
+#if !defined(LOG_OUTPUT_STDOUT)
+    else if (g_logfile != NULL)
+    {
+      /* notice rotation even when idle */
+      ladish_log_open();
+    }
+#endif
+    pthread_mutex_unlock(&g_log_drain_mutex);
+
+    if (stop)
+    {
+      break;
+    }
+
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += LADISH_LOG_WRITER_PERIOD;
+
+    pthread_mutex_lock(&g_log_writer_mutex);
+    if (!__atomic_load_n(&g_log_writer_wakeup, __ATOMIC_ACQUIRE) &&
+        !__atomic_load_n(&g_log_writer_stop, __ATOMIC_ACQUIRE))
+    {
+      pthread_cond_timedwait(&g_log_writer_cond, &g_log_writer_mutex, &deadline);
+    }
+    pthread_mutex_unlock(&g_log_writer_mutex);
+  }
+  while (true);
+
+  return NULL;
+}
+
+/* forked child has no writer thread */
+static void ladish_log_atfork_child(void)
+{
+  g_log_async = false;
+  g_log_writer_started = false;
+}
+
+bool ladish_log_async_start(void)
+{
+  int ret;
+  sigset_t sigmask;
+  sigset_t old_sigmask;
+
+  if (g_log_writer_started)
+  {
+    return true;
+  }
+
+  if (!g_log_atfork_registered)
+  {
+    ret = pthread_atfork(NULL, NULL, ladish_log_atfork_child);
+    if (ret != 0)
+    {
+      log_error("pthread_atfork() failed. %d (%s)", ret, strerror(ret));
+      return false;
+    }
+
+    g_log_atfork_registered = true;
+  }
+
+  if (!g_log_ring_key_created)
+  {
+    ret = pthread_key_create(&g_log_ring_key, ladish_log_release_thread_ring);
+    if (ret != 0)
+    {
+      log_error("pthread_key_create() failed. %d (%s)", ret, strerror(ret));
+      return false;
+    }
+
+    g_log_ring_key_created = true;
+  }
+
+  g_log_writer_stop = false;
+
+  /* signals are for the other threads */
+  sigfillset(&sigmask);
+  pthread_sigmask(SIG_BLOCK, &sigmask, &old_sigmask);
+  ret = pthread_create(&g_log_writer_thread, NULL, ladish_log_writer, NULL);
+  pthread_sigmask(SIG_SETMASK, &old_sigmask, NULL);
+  if (ret != 0)
+  {
+    log_error("Cannot start log writer thread. %d (%s)", ret, strerror(ret));
+    return false;
+  }
+
+  g_log_writer_started = true;
+  __atomic_store_n(&g_log_async, true, __ATOMIC_RELEASE);
+
+  return true;
+}
+
+void ladish_log_async_stop(void)
+{
+  if (!g_log_writer_started)
+  {
+    return;
+  }
+
+  __atomic_store_n(&g_log_async, false, __ATOMIC_RELEASE);
+
+  __atomic_store_n(&g_log_writer_stop, true, __ATOMIC_RELEASE);
+  ladish_log_wake_writer();
+
+  pthread_join(g_log_writer_thread, NULL);
+  g_log_writer_started = false;
+
+  /* messages queued while the writer was stopping */
+  pthread_mutex_lock(&g_log_drain_mutex);
+  ladish_log_drain();
+  ladish_log_flush_streams();
+  pthread_mutex_unlock(&g_log_drain_mutex);
+}
+
+void ladish_log_flush(void)
+{
+  unsigned int retry;
+
+  /* everything logged after this point is written synchronously */
+  __atomic_store_n(&g_log_async, false, __ATOMIC_RELEASE);
+
+  if (!g_log_writer_started)
+  {
+    return;
+  }
+
+  /* Don't wait forever, this is called from crash handlers
+   * and the writer thread itself may be the one that crashed. */
+  for (retry = 0; retry < 100; retry++)
+  {
+    if (pthread_mutex_trylock(&g_log_drain_mutex) == 0)
+    {
+      ladish_log_drain();
+      ladish_log_flush_streams();
+      pthread_mutex_unlock(&g_log_drain_mutex);
+      return;
+    }
+
+    usleep(10000);
+  }
+}
+
+/* While the writer thread is running, synchronous writers take the drain
+ * mutex so they do not reopen the log file concurrently with it.
+ * Returns whether the mutex was locked. */
+static bool ladish_log_lock_file(void)
+{
+  struct timespec deadline;
+
+  if (g_log_thread_is_writer)
+  {
+    return false;               /* writer reopens the file only while draining */
+  }
+
+  if (!g_log_writer_started)
+  {
+    return false;               /* there is no one to race with */
+  }
+
+  if (__atomic_load_n(&g_log_drain_mutex_stuck, __ATOMIC_RELAXED))
+  {
+    return false;
+  }
+
+  /* don't wait forever, the mutex may be held by a thread that crashed */
+  clock_gettime(CLOCK_REALTIME, &deadline);
+  deadline.tv_sec += 1;
+  if (pthread_mutex_timedlock(&g_log_drain_mutex, &deadline) != 0)
+  {
+    __atomic_store_n(&g_log_drain_mutex_stuck, true, __ATOMIC_RELAXED);
+    return false;
+  }
+
+  return true;
+}
+
 void
 ladish_log(
   unsigned int level,
@@ -191,34 +785,29 @@ ladish_log(
   char timestamp_str[26];
 #endif
   const char * color;
+  bool pushed;
+  bool locked;
 
   if (!ladish_log_enabled(level, file, line, func))
   {
     return;
   }
 
-#if !defined(LOG_OUTPUT_STDOUT)
-  if (g_logfile != NULL && ladish_log_open())
+  if (__atomic_load_n(&g_log_async, __ATOMIC_ACQUIRE))
   {
-    stream = g_logfile;
-  }
-  else
-#endif
-  {
-    switch (level)
+    va_start(ap, format);
+    pushed = ladish_log_push(level, file, line, func, format, ap);
+    va_end(ap);
+
+    if (pushed)
     {
-    case LADISH_LOG_LEVEL_DEBUG:
-    case LADISH_LOG_LEVEL_INFO:
-      stream = stdout;
-      break;
-    case LADISH_LOG_LEVEL_WARN:
-    case LADISH_LOG_LEVEL_ERROR:
-    case LADISH_LOG_LEVEL_ERROR_PLAIN:
-    default:
-      stream = stderr;
+      return;
     }
   }
 
+  locked = ladish_log_lock_file();
+  stream = ladish_log_get_stream(level, locked || !g_log_writer_started);
+
 #if !defined(LOG_OUTPUT_STDOUT)
   time(&timestamp);
   ctime_r(&timestamp, timestamp_str);
@@ -259,4 +848,9 @@ ladish_log(
   fputs("\n", stream);
 
   fflush(stream);
+
+  if (locked)
+  {
+    pthread_mutex_unlock(&g_log_drain_mutex);
+  }
 }
@@ -0,0 +1,168 @@
+/* -*- Mode: C ; c-basic-offset: 2 -*- */
+/*
+ * LADI Session Handler (ladish)
+ *
+ * Copyright (C) 2026 ladish authors, see the AUTHORS file
+ *
+ **************************************************************************
+ * This file contains implementation of the fixed size object pool
+ **************************************************************************
+ *
+ * LADI Session Handler is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * LADI Session Handler is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LADI Session Handler. If not, see <http://www.gnu.org/licenses/>
+ * or write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "../common.h"
+#include "slab.h"
+
+struct ladish_slab_chunk
+{
+  struct list_head siblings;    /* link for the slab::chunks list */
+  struct list_head partial;     /* link for the slab::partial list, self linked when the chunk is full */
+  void * free_list;
+  unsigned int used;
+  char objects[] __attribute__((aligned(LADISH_SLAB_ALIGNMENT)));
+};
+
+void ladish_slab_init(struct ladish_slab * slab_ptr, size_t object_size, unsigned int objects_per_chunk)
+{
+  ASSERT(objects_per_chunk > 0);
+
+  INIT_LIST_HEAD(&slab_ptr->chunks);
+  INIT_LIST_HEAD(&slab_ptr->partial);
+  slab_ptr->object_size = LADISH_SLAB_OBJECT_SIZE(object_size);
+  slab_ptr->objects_per_chunk = objects_per_chunk;
+  slab_ptr->chunk_size = 0;
+  slab_ptr->allocated = 0;
+}
+
+static void ladish_slab_release_chunk(struct ladish_slab_chunk * chunk_ptr)
+{
+  list_del(&chunk_ptr->siblings);
+  list_del(&chunk_ptr->partial);
+  free(chunk_ptr);
+}
+
+void ladish_slab_uninit(struct ladish_slab * slab_ptr)
+{
+  if (slab_ptr->allocated != 0)
+  {
+    log_error("%u objects of size %zu are still allocated from slab", slab_ptr->allocated, slab_ptr->object_size);
+    ASSERT_NO_PASS;
+  }
+
+  while (!list_empty(&slab_ptr->chunks))
+  {
+    ladish_slab_release_chunk(list_entry(slab_ptr->chunks.next, struct ladish_slab_chunk, siblings));
+  }
+}
+
+static bool ladish_slab_grow(struct ladish_slab * slab_ptr)
+{
+  struct ladish_slab_chunk * chunk_ptr;
+  unsigned int i;
+  char * object_ptr;
+  size_t size;
+  int ret;
+
+  if (slab_ptr->chunk_size == 0)
+  {
+    size = sizeof(struct ladish_slab_chunk) + slab_ptr->object_size * slab_ptr->objects_per_chunk;
+    slab_ptr->chunk_size = LADISH_SLAB_ALIGNMENT;
+    while (slab_ptr->chunk_size < size)
+    {
+      slab_ptr->chunk_size *= 2;
+    }
+
+    /* use the space left by rounding up */
+    slab_ptr->objects_per_chunk = (slab_ptr->chunk_size - sizeof(struct ladish_slab_chunk)) / slab_ptr->object_size;
+  }
+
+  ret = posix_memalign((void **)&chunk_ptr, slab_ptr->chunk_size, slab_ptr->chunk_size);
+  if (ret != 0)
+  {
+    log_error("posix_memalign() failed to allocate slab chunk of %u objects with size %zu", slab_ptr->objects_per_chunk, slab_ptr->object_size);
+    return false;
+  }
+
+  list_add_tail(&chunk_ptr->siblings, &slab_ptr->chunks);
+  list_add(&chunk_ptr->partial, &slab_ptr->partial);
+  chunk_ptr->used = 0;
+  chunk_ptr->free_list = NULL;
+
+  /* thread the new objects in the free list, lower addresses first */
+  i = slab_ptr->objects_per_chunk;
+  while (i > 0)
+  {
+    i--;
+    object_ptr = chunk_ptr->objects + i * slab_ptr->object_size;
+    *(void **)object_ptr = chunk_ptr->free_list;
+    chunk_ptr->free_list = object_ptr;
+  }
+
+  return true;
+}
+
+void * ladish_slab_alloc(struct ladish_slab * slab_ptr)
+{
+  struct ladish_slab_chunk * chunk_ptr;
+  void * object_ptr;
+
+  if (list_empty(&slab_ptr->partial) && !ladish_slab_grow(slab_ptr))
+  {
+    return NULL;
+  }
+
+  chunk_ptr = list_entry(slab_ptr->partial.next, struct ladish_slab_chunk, partial);
+  ASSERT(chunk_ptr->free_list != NULL);
+
+  object_ptr = chunk_ptr->free_list;
+  chunk_ptr->free_list = *(void **)object_ptr;
+  chunk_ptr->used++;
+  if (chunk_ptr->free_list == NULL)
+  {
+    list_del_init(&chunk_ptr->partial);
+  }
+
+  slab_ptr->allocated++;
+
+  return object_ptr;
+}
+
+void ladish_slab_free(struct ladish_slab * slab_ptr, void * object_ptr)
+{
+  struct ladish_slab_chunk * chunk_ptr;
+
+  ASSERT(slab_ptr->allocated > 0);
+
+  chunk_ptr = (struct ladish_slab_chunk *)((uintptr_t)object_ptr & ~(uintptr_t)(slab_ptr->chunk_size - 1));
+  ASSERT(chunk_ptr->used > 0);
+
+  if (chunk_ptr->free_list == NULL)
+  {
+    list_add(&chunk_ptr->partial, &slab_ptr->partial);
+  }
+
+  *(void **)object_ptr = chunk_ptr->free_list;
+  chunk_ptr->free_list = object_ptr;
+  chunk_ptr->used--;
+  slab_ptr->allocated--;
+
+  /* don't keep memory pinned at the peak size, but avoid thrashing when a single chunk is in use */
+  if (chunk_ptr->used == 0 && slab_ptr->chunks.next != slab_ptr->chunks.prev)
+  {
+    ladish_slab_release_chunk(chunk_ptr);
+  }
+}
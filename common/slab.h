@@ -0,0 +1,61 @@
+/* -*- Mode: C ; c-basic-offset: 2 -*- */
+/*
+ * LADI Session Handler (ladish)
+ *
+ * Copyright (C) 2026 ladish authors, see the AUTHORS file
+ *
+ **************************************************************************
+ * This file contains interface of the fixed size object pool
+ **************************************************************************
+ *
+ * LADI Session Handler is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * LADI Session Handler is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LADI Session Handler. If not, see <http://www.gnu.org/licenses/>
+ * or write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef SLAB_H__0E5D2F4B_6C1A_4A43_9D28_3F7B1E8C54A6__INCLUDED
+#define SLAB_H__0E5D2F4B_6C1A_4A43_9D28_3F7B1E8C54A6__INCLUDED
+
+/* Objects of same size are carved out of larger chunks and recycled
+ * through per chunk free lists. Chunks are aligned to their size, so the
+ * chunk of an object is found from its address. A chunk is released as
+ * soon as all its objects are freed, except for the last chunk of the
+ * slab, which is kept until the slab is uninitialized. */
+
+/* keep objects suitably aligned for any of the structs stored in them */
+#define LADISH_SLAB_ALIGNMENT (2 * sizeof(void *))
+
+#define LADISH_SLAB_OBJECT_SIZE(size)                                   \
+  ((((size) < sizeof(void *) ? sizeof(void *) : (size)) + LADISH_SLAB_ALIGNMENT - 1) & ~(LADISH_SLAB_ALIGNMENT - 1))
+
+/* static initializer, an alternative to ladish_slab_init() */
+#define LADISH_SLAB_INIT(name, type, objects_per_chunk)                 \
+  { LIST_HEAD_INIT((name).chunks), LIST_HEAD_INIT((name).partial), LADISH_SLAB_OBJECT_SIZE(sizeof(type)), (objects_per_chunk), 0, 0 }
+
+struct ladish_slab
+{
+  struct list_head chunks;      /* all chunks */
+  struct list_head partial;     /* chunks with free objects */
+  size_t object_size;
+  unsigned int objects_per_chunk; /* minimum, raised to fill the chunk size */
+  size_t chunk_size;            /* power of two, 0 until the first chunk is allocated */
+  unsigned int allocated;       /* objects in use, for leak diagnostics */
+};
+
+void ladish_slab_init(struct ladish_slab * slab_ptr, size_t object_size, unsigned int objects_per_chunk);
+void ladish_slab_uninit(struct ladish_slab * slab_ptr);
+void * ladish_slab_alloc(struct ladish_slab * slab_ptr);
+void ladish_slab_free(struct ladish_slab * slab_ptr, void * object_ptr);
+
+#endif /* #ifndef SLAB_H__0E5D2F4B_6C1A_4A43_9D28_3F7B1E8C54A6__INCLUDED */
@@ -0,0 +1,243 @@
+/* -*- Mode: C ; c-basic-offset: 2 -*- */
+/*
+ * LADI Session Handler (ladish)
+ *
+ * Copyright (C) 2026 ladish authors, see the AUTHORS file
+ *
+ **************************************************************************
+ * This file contains implementation of the per-app log files
+ **************************************************************************
+ *
+ * LADI Session Handler is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * LADI Session Handler is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LADI Session Handler. If not, see <http://www.gnu.org/licenses/>
+ * or write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "app_log.h"
+
+#include <time.h>
+#include <sys/stat.h>
+
+#include "../common/catdup.h"
+#include "../common/dirhelpers.h"
+
+/* number of rotated files kept, app.log.1 is the newest one */
+#define APP_LOG_BACKUPS 3
+
+#define APP_LOG_SUFFIX ".log"
+
+char * ladish_app_log_escape_name(const char * name)
+{
+  char * escaped;
+  char * char_ptr;
+
+  escaped = strdup(name);
+  if (escaped == NULL)
+  {
+    log_error("strdup() failed for name \"%s\"", name);
+    return NULL;
+  }
+
+  /* app and room names are free form, they must not escape the log dir */
+  for (char_ptr = escaped; *char_ptr != 0; char_ptr++)
+  {
+    if (*char_ptr == '/')
+    {
+      *char_ptr = '_';
+    }
+  }
+
+  if (escaped[0] == '.')
+  {
+    escaped[0] = '_';
+  }
+
+  return escaped;
+}
+
+bool
+ladish_app_log_init(
+  struct ladish_app_log * log_ptr,
+  const char * dir,
+  const char * app_name,
+  off_t limit)
+{
+  char * name;
+
+  name = ladish_app_log_escape_name(app_name);
+  if (name == NULL)
+  {
+    return false;
+  }
+
+  log_ptr->path = catdup4(dir, "/", name, APP_LOG_SUFFIX);
+  free(name);
+  if (log_ptr->path == NULL)
+  {
+    log_error("catdup4() failed to compose app log path");
+    return false;
+  }
+
+  log_ptr->file = NULL;
+  log_ptr->size = 0;
+  log_ptr->limit = limit;
+  log_ptr->failed = false;
+  log_ptr->timestamp = 0;
+  log_ptr->timestamp_str[0] = 0;
+
+  return true;
+}
+
+static void ladish_app_log_close(struct ladish_app_log * log_ptr)
+{
+  if (log_ptr->file != NULL)
+  {
+    fclose(log_ptr->file);
+    log_ptr->file = NULL;
+  }
+}
+
+void ladish_app_log_uninit(struct ladish_app_log * log_ptr)
+{
+  ladish_app_log_close(log_ptr);
+  free(log_ptr->path);
+}
+
+static bool ladish_app_log_open(struct ladish_app_log * log_ptr)
+{
+  char * dir;
+  char * char_ptr;
+  struct stat st;
+
+  dir = strdup(log_ptr->path);
+  if (dir == NULL)
+  {
+    log_error("strdup() failed for app log path");
+    return false;
+  }
+
+  char_ptr = strrchr(dir, '/');
+  ASSERT(char_ptr != NULL);
+  *char_ptr = 0;
+
+  if (!ensure_dir_exist_varg(0700, dir, NULL))
+  {
+    free(dir);
+    return false;
+  }
+
+  free(dir);
+
+  log_ptr->file = fopen(log_ptr->path, "a");
+  if (log_ptr->file == NULL)
+  {
+    log_error("Cannot open app log file \"%s\": %d (%s)", log_ptr->path, errno, strerror(errno));
+    return false;
+  }
+
+  if (fstat(fileno(log_ptr->file), &st) == 0)
+  {
+    log_ptr->size = st.st_size;
+  }
+  else
+  {
+    log_ptr->size = 0;
+  }
+
+  return true;
+}
+
+static void ladish_app_log_rotate(struct ladish_app_log * log_ptr)
+{
+  size_t len = strlen(log_ptr->path) + 20;
+  char paths[2][len];
+  unsigned int backup;
+
+  ladish_app_log_close(log_ptr);
+
+  for (backup = APP_LOG_BACKUPS; backup > 0; backup--)
+  {
+    if (backup > 1)
+    {
+      snprintf(paths[0], len, "%s.%u", log_ptr->path, backup - 1);
+    }
+    else
+    {
+      snprintf(paths[0], len, "%s", log_ptr->path);
+    }
+
+    snprintf(paths[1], len, "%s.%u", log_ptr->path, backup);
+
+    if (rename(paths[0], paths[1]) != 0 && errno != ENOENT)
+    {
+      log_error("rename('%s' -> '%s') failed. errno = %d (%s)", paths[0], paths[1], errno, strerror(errno));
+    }
+  }
+
+  log_ptr->failed = false;
+}
+
+bool ladish_app_log_line(struct ladish_app_log * log_ptr, bool error, const char * line, size_t len)
+{
+  time_t now;
+  int ret;
+
+  if (log_ptr->limit != 0 && log_ptr->size >= log_ptr->limit)
+  {
+    ladish_app_log_rotate(log_ptr);
+  }
+
+  if (log_ptr->file == NULL)
+  {
+    if (log_ptr->failed)
+    {
+      return false;
+    }
+
+    if (!ladish_app_log_open(log_ptr))
+    {
+      log_ptr->failed = true;
+      return false;
+    }
+  }
+
+  /* format the timestamp only once per second */
+  time(&now);
+  if (now != log_ptr->timestamp)
+  {
+    log_ptr->timestamp = now;
+    ctime_r(&now, log_ptr->timestamp_str);
+    log_ptr->timestamp_str[24] = 0;
+  }
+
+  ret = fprintf(log_ptr->file, "%s: %s%.*s\n", log_ptr->timestamp_str, error ? "stderr: " : "", (int)len, line);
+  if (ret < 0)
+  {
+    log_error("Cannot write app log file \"%s\"", log_ptr->path);
+    ladish_app_log_close(log_ptr);
+    log_ptr->failed = true;
+    return false;
+  }
+
+  log_ptr->size += ret;
+  return true;
+}
+
+void ladish_app_log_flush(struct ladish_app_log * log_ptr)
+{
+  if (log_ptr->file != NULL)
+  {
+    fflush(log_ptr->file);
+  }
+}
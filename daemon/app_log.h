@@ -0,0 +1,67 @@
+/* -*- Mode: C ; c-basic-offset: 2 -*- */
+/*
+ * LADI Session Handler (ladish)
+ *
+ * Copyright (C) 2026 ladish authors, see the AUTHORS file
+ *
+ **************************************************************************
+ * This file contains interface of the per-app log files
+ **************************************************************************
+ *
+ * LADI Session Handler is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * LADI Session Handler is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LADI Session Handler. If not, see <http://www.gnu.org/licenses/>
+ * or write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef APP_LOG_H__C5F36CD6_EE4A_4A4F_BC24_8FFB8CDC44D5__INCLUDED
+#define APP_LOG_H__C5F36CD6_EE4A_4A4F_BC24_8FFB8CDC44D5__INCLUDED
+
+#include "common.h"
+#include <sys/types.h>
+
+/* Output of a managed app is written to its own log file. The file is
+ * opened when the first line is written and is rotated when it grows
+ * over the size limit. Writes are buffered, call ladish_app_log_flush()
+ * after a batch of lines. */
+
+struct ladish_app_log
+{
+  char * path;
+  FILE * file;
+  off_t size;
+  off_t limit;                  /* 0 means no rotation */
+  bool failed;                  /* don't retry opening until rotation */
+  time_t timestamp;
+  char timestamp_str[26];
+};
+
+/* Returns malloc()ed copy of name that is safe to use as single path
+ * component: slashes and leading dot are replaced with underscores */
+char * ladish_app_log_escape_name(const char * name);
+
+bool
+ladish_app_log_init(
+  struct ladish_app_log * log_ptr,
+  const char * dir,
+  const char * app_name,
+  off_t limit);
+
+void ladish_app_log_uninit(struct ladish_app_log * log_ptr);
+
+/* returns false if the line could not be written */
+bool ladish_app_log_line(struct ladish_app_log * log_ptr, bool error, const char * line, size_t len);
+
+void ladish_app_log_flush(struct ladish_app_log * log_ptr);
+
+#endif /* #ifndef APP_LOG_H__C5F36CD6_EE4A_4A4F_BC24_8FFB8CDC44D5__INCLUDED */
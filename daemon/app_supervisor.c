@@ -40,6 +40,11 @@
 #include "../common/catdup.h"
 #include "../common/dirhelpers.h"
 #include "jack_session.h"
+#include "metrics.h"
+#include "app_log.h"
+
+/* subdir of project dir (or of ~/.ladish) where app output logs are written */
+#define APP_LOGS_SUBDIR "/logs"
 
 struct ladish_app
 {
@@ -61,6 +66,8 @@ struct ladish_app
   unsigned int state;
   char * dbus_name;
   struct ladish_app_supervisor * supervisor;
+  uint64_t spawn_time;          /* when the app was started, zero once its first client appeared */
+  loader_output_handle output;  /* recent output of the last run, NULL if never started */
 };
 
 struct ladish_app_supervisor
@@ -77,6 +84,7 @@ struct ladish_app_supervisor
 
   char * project_name;
   uint64_t version;
+  uint64_t modified;            /* modification clock value of the last app list or app state change */
   uint64_t next_id;
   struct list_head applist;
   void * on_app_renamed_context;
@@ -173,6 +181,7 @@ ladish_app_supervisor_create(
   supervisor_ptr->project_name = NULL;
 
   supervisor_ptr->version = 0;
+  supervisor_ptr->modified = ladish_modified_now();
   supervisor_ptr->next_id = 1;
 
   INIT_LIST_HEAD(&supervisor_ptr->applist);
@@ -209,6 +218,7 @@ void remove_app_internal(struct ladish_app_supervisor * supervisor_ptr, struct l
   list_del(&app_ptr->siblings);
 
   supervisor_ptr->version++;
+  supervisor_ptr->modified = ladish_modified_now();
 
   cdbus_signal_emit(
     cdbus_g_dbus_connection,
@@ -219,6 +229,11 @@ void remove_app_internal(struct ladish_app_supervisor * supervisor_ptr, struct l
     &supervisor_ptr->version,
     &app_ptr->id);
 
+  if (app_ptr->output != NULL)
+  {
+    loader_output_release(app_ptr->output);
+  }
+
   free(app_ptr->dbus_name);
   free(app_ptr->name);
   free(app_ptr->commandline);
@@ -239,6 +254,7 @@ void emit_app_state_changed(struct ladish_app_supervisor * supervisor_ptr, struc
   level_byte = ladish_level_string_to_integer(app_ptr->level);
 
   supervisor_ptr->version++;
+  supervisor_ptr->modified = ladish_modified_now();
 
   cdbus_signal_emit(
     cdbus_g_dbus_connection,
@@ -315,6 +331,7 @@ static void ladish_js_save_complete(struct ladish_app_supervisor * supervisor_pt
       free(app_ptr->commandline);
       app_ptr->commandline = app_ptr->js_commandline;
       app_ptr->js_commandline = NULL;
+      supervisor_ptr->modified = ladish_modified_now();
     }
   }
 
@@ -457,6 +474,8 @@ ladish_app_supervisor_add(
   memcpy(app_ptr->level, level, len + 1);
   app_ptr->pid = 0;
   app_ptr->pgrp = 0;
+  app_ptr->spawn_time = 0;
+  app_ptr->output = NULL;
   app_ptr->firstborn_pid = 0;
   app_ptr->firstborn_pgrp = 0;
   app_ptr->firstborn_refcount = 0;
@@ -478,6 +497,7 @@ ladish_app_supervisor_add(
   list_add_tail(&app_ptr->siblings, &supervisor_ptr->applist);
 
   supervisor_ptr->version++;
+  supervisor_ptr->modified = ladish_modified_now();
 
   running = false;
   dbus_terminal = terminal;
@@ -920,6 +940,7 @@ bool ladish_app_supervisor_child_exit(ladish_app_supervisor_handle supervisor_ha
 
       app_ptr->pid = 0;
       app_ptr->pgrp = 0;
+      app_ptr->spawn_time = 0;
       /* firstborn pid and pgrp is not reset here because it is refcounted
          and managed independently through the add/del_pid() methods */
 
@@ -974,6 +995,9 @@ bool ladish_app_supervisor_start_app(ladish_app_supervisor_handle supervisor_han
 {
   char uuid_str[37];
   char * js_dir;
+  char * log_dir;
+  char * room_dir;
+  loader_output_handle output;
   bool ret;
 
   app_ptr->zombie = false;
@@ -995,16 +1019,37 @@ bool ladish_app_supervisor_start_app(ladish_app_supervisor_handle supervisor_han
     js_dir = NULL;
   }
 
+  /* app logs are kept in the project dir, studio apps log to ~/.ladish/logs/studio/ */
+  if (supervisor_ptr->dir != NULL)
+  {
+    log_dir = catdup(supervisor_ptr->dir, APP_LOGS_SUBDIR);
+  }
+  else
+  {
+    /* supervisor name is the room name, it can be anything */
+    room_dir = ladish_app_log_escape_name(supervisor_ptr->name);
+    log_dir = room_dir != NULL ? catdup4(g_base_dir, APP_LOGS_SUBDIR, "/", room_dir) : NULL;
+    free(room_dir);
+  }
+
+  if (log_dir == NULL)
+  {
+    log_error("catdup() failed to compose app log dir");
+  }
+
   ret = loader_execute(
     supervisor_ptr->name,
     supervisor_ptr->project_name,
     app_ptr->name,
     supervisor_ptr->dir != NULL ? supervisor_ptr->dir : "/",
     js_dir,
+    log_dir,
     app_ptr->terminal,
     app_ptr->commandline,
-    &app_ptr->pid);
+    &app_ptr->pid,
+    &output);
 
+  free(log_dir);
   free(js_dir);
 
   if (!ret)
@@ -1012,8 +1057,17 @@ bool ladish_app_supervisor_start_app(ladish_app_supervisor_handle supervisor_han
     return false;
   }
 
+  /* output of the previous run is kept until now */
+  if (app_ptr->output != NULL)
+  {
+    loader_output_release(app_ptr->output);
+  }
+
+  app_ptr->output = output;
+
   ASSERT(app_ptr->pid != 0);
   app_ptr->state = LADISH_APP_STATE_STARTED;
+  app_ptr->spawn_time = ladish_metrics_now();
 
   emit_app_state_changed(supervisor_ptr, app_ptr);
   return true;
@@ -1080,6 +1134,12 @@ void ladish_app_add_pid(ladish_app_handle app_handle, pid_t pid)
     return;
   }
 
+  if (app_ptr->spawn_time != 0)
+  { /* first JACK client (or a2j port) of the app */
+    ladish_metrics_record("app", "spawn_to_first_client", ladish_metrics_now() - app_ptr->spawn_time);
+    app_ptr->spawn_time = 0;
+  }
+
   if (app_ptr->pid == pid)
   { /* The top level process that is already known */
     return;
@@ -1296,6 +1356,11 @@ bool ladish_app_supervisor_has_apps(ladish_app_supervisor_handle supervisor_hand
   return !list_empty(&supervisor_ptr->applist);
 }
 
+uint64_t ladish_app_supervisor_get_modified(ladish_app_supervisor_handle supervisor_handle)
+{
+  return supervisor_ptr->modified;
+}
+
 void ladish_app_supervisor_dump(ladish_app_supervisor_handle supervisor_handle)
 {
   struct list_head * node_ptr;
@@ -1874,6 +1939,99 @@ static void is_app_running(struct cdbus_method_call * call_ptr)
   cdbus_method_return_new_single(call_ptr, DBUS_TYPE_BOOLEAN, &running);
 }
 
+static bool append_app_output_line(void * context, const char * line)
+{
+  char * sanitized;
+  char * char_ptr;
+  bool ret;
+
+  if (dbus_validate_utf8(line, NULL))
+  {
+    return dbus_message_iter_append_basic(context, DBUS_TYPE_STRING, &line);
+  }
+
+  /* D-Bus strings must be valid UTF-8, programs may output anything */
+  sanitized = strdup(line);
+  if (sanitized == NULL)
+  {
+    return false;
+  }
+
+  for (char_ptr = sanitized; *char_ptr != 0; char_ptr++)
+  {
+    if ((unsigned char)*char_ptr >= 0x80)
+    {
+      *char_ptr = '?';
+    }
+  }
+
+  ret = dbus_message_iter_append_basic(context, DBUS_TYPE_STRING, &sanitized);
+  free(sanitized);
+  return ret;
+}
+
+static void get_app_output(struct cdbus_method_call * call_ptr)
+{
+  uint64_t id;
+  dbus_uint32_t max_lines;
+  struct ladish_app * app_ptr;
+  DBusMessageIter iter, array_iter;
+
+  if (!dbus_message_get_args(
+        call_ptr->message,
+        &cdbus_g_dbus_error,
+        DBUS_TYPE_UINT64, &id,
+        DBUS_TYPE_UINT32, &max_lines,
+        DBUS_TYPE_INVALID))
+  {
+    cdbus_error(call_ptr, DBUS_ERROR_INVALID_ARGS, "Invalid arguments to method \"%s\": %s",  call_ptr->method_name, cdbus_g_dbus_error.message);
+    dbus_error_free(&cdbus_g_dbus_error);
+    return;
+  }
+
+  app_ptr = ladish_app_supervisor_find_app_by_id_internal(supervisor_ptr, id);
+  if (app_ptr == NULL)
+  {
+    cdbus_error(call_ptr, DBUS_ERROR_INVALID_ARGS, "App with ID %"PRIu64" not found", id);
+    return;
+  }
+
+  call_ptr->reply = dbus_message_new_method_return(call_ptr->message);
+  if (call_ptr->reply == NULL)
+  {
+    goto fail;
+  }
+
+  dbus_message_iter_init_append(call_ptr->reply, &iter);
+
+  if (!dbus_message_iter_open_container(&iter, DBUS_TYPE_ARRAY, DBUS_TYPE_STRING_AS_STRING, &array_iter))
+  {
+    goto fail_unref;
+  }
+
+  /* output of stopped apps is kept until they are restarted or removed */
+  if (app_ptr->output != NULL &&
+      !loader_output_get_lines(app_ptr->output, max_lines, &array_iter, append_app_output_line))
+  {
+    dbus_message_iter_abandon_container(&iter, &array_iter);
+    goto fail_unref;
+  }
+
+  if (!dbus_message_iter_close_container(&iter, &array_iter))
+  {
+    goto fail_unref;
+  }
+
+  return;
+
+fail_unref:
+  dbus_message_unref(call_ptr->reply);
+  call_ptr->reply = NULL;
+
+fail:
+  log_error("Ran out of memory trying to construct method return");
+}
+
 #undef supervisor_ptr
 
 CDBUS_METHOD_ARGS_BEGIN(GetInterfaceVersion, "Get version of this D-Bus interface")
@@ -1959,6 +2117,12 @@ CDBUS_METHOD_ARGS_BEGIN(IsAppRunning, "Check whether application is running")
   CDBUS_METHOD_ARG_DESCRIBE_OUT("running", DBUS_TYPE_BOOLEAN_AS_STRING, "Whether app is running")
 CDBUS_METHOD_ARGS_END
 
+CDBUS_METHOD_ARGS_BEGIN(GetAppOutput, "Get recent output lines of an application, of its last run if it is stopped")
+  CDBUS_METHOD_ARG_DESCRIBE_IN("id", DBUS_TYPE_UINT64_AS_STRING, "id of app")
+  CDBUS_METHOD_ARG_DESCRIBE_IN("max_lines", DBUS_TYPE_UINT32_AS_STRING, "Max number of lines to return, 0 for all buffered")
+  CDBUS_METHOD_ARG_DESCRIBE_OUT("lines", "as", "Output lines, oldest first")
+CDBUS_METHOD_ARGS_END
+
 
 CDBUS_METHODS_BEGIN
   CDBUS_METHOD_DESCRIBE(GetInterfaceVersion, get_version)     /* sync */
@@ -1975,6 +2139,7 @@ CDBUS_METHODS_BEGIN
   CDBUS_METHOD_DESCRIBE(SetAppProperties2, set_app_properties2) /* sync */
   CDBUS_METHOD_DESCRIBE(RemoveApp, remove_app)                /* sync */
   CDBUS_METHOD_DESCRIBE(IsAppRunning, is_app_running)         /* sync */
+  CDBUS_METHOD_DESCRIBE(GetAppOutput, get_app_output)         /* sync */
 CDBUS_METHODS_END
 
 CDBUS_SIGNAL_ARGS_BEGIN(AppAdded, "")
@@ -292,6 +292,15 @@ unsigned int ladish_app_supervisor_get_running_app_count(ladish_app_supervisor_h
  */
 bool ladish_app_supervisor_has_apps(ladish_app_supervisor_handle supervisor_handle);
 
+/**
+ * Get the modification clock value of the last change of the app list or of app state
+ *
+ * @param[in] supervisor_handle supervisor object handle
+ *
+ * @return modification clock value, see ladish_modified_now()
+ */
+uint64_t ladish_app_supervisor_get_modified(ladish_app_supervisor_handle supervisor_handle);
+
 /**
  * Dump to log the contents of the app supervisor
  *
@@ -41,6 +41,10 @@ struct ladish_command
   unsigned int state;
   bool cancel;
 
+  const char * type;             /* static string, used as metrics key */
+  const char * scope;            /* interned opath of room or app supervisor, NULL for whole studio */
+  uint64_t start_time;           /* when run() was first called, in microseconds */
+
   void * context;
   bool (* run)(void * context);
   void (* destructor)(void * context);
@@ -54,12 +58,15 @@ struct ladish_cqueue
 
 void ladish_cqueue_init(struct ladish_cqueue * queue_ptr);
 void ladish_cqueue_run(struct ladish_cqueue * queue_ptr);
+bool ladish_cqueue_is_empty(struct ladish_cqueue * queue_ptr);
 void ladish_cqueue_cancel(struct ladish_cqueue * queue_ptr);
 bool ladish_cqueue_add_command(struct ladish_cqueue * queue_ptr, struct ladish_command * command_ptr);
+bool ladish_cqueue_add_scoped_command(struct ladish_cqueue * queue_ptr, struct ladish_command * command_ptr, const char * scope);
 void ladish_cqueue_drop_command(struct ladish_cqueue * queue_ptr);
 void ladish_cqueue_clear(struct ladish_cqueue * queue_ptr);
 
-void * ladish_command_new(size_t size);
+void * ladish_command_new(size_t size, const char * type);
+const char * ladish_command_room_scope(const uuid_t room_uuid);
 
 bool ladish_command_new_studio(void * call_ptr, struct ladish_cqueue * queue_ptr, const char * studio_name);
 bool ladish_command_load_studio(void * call_ptr, struct ladish_cqueue * queue_ptr, const char * studio_name, bool autostart);
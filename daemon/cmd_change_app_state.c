@@ -165,7 +165,7 @@ bool ladish_command_change_app_state(void * call_ptr, struct ladish_cqueue * que
     goto fail;
   }
 
-  cmd_ptr = ladish_command_new(sizeof(struct ladish_command_change_app_state));
+  cmd_ptr = ladish_command_new(sizeof(struct ladish_command_change_app_state), "change_app_state");
   if (cmd_ptr == NULL)
   {
     cdbus_error(call_ptr, DBUS_ERROR_FAILED, "ladish_command_new() failed.");
@@ -201,9 +201,9 @@ bool ladish_command_change_app_state(void * call_ptr, struct ladish_cqueue * que
     goto fail_destroy_command;
   }
 
-  if (!ladish_cqueue_add_command(queue_ptr, &cmd_ptr->command))
+  if (!ladish_cqueue_add_scoped_command(queue_ptr, &cmd_ptr->command, opath))
   {
-    cdbus_error(call_ptr, DBUS_ERROR_FAILED, "ladish_cqueue_add_command() failed.");
+    cdbus_error(call_ptr, DBUS_ERROR_FAILED, "ladish_cqueue_add_scoped_command() failed.");
     goto fail_destroy_command;
   }
 
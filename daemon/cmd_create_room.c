@@ -112,7 +112,7 @@ bool ladish_command_create_room(void * call_ptr, struct ladish_cqueue * queue_pt
     goto fail_free_room_name;
   }
 
-  cmd_ptr = ladish_command_new(sizeof(struct ladish_command_create_room));
+  cmd_ptr = ladish_command_new(sizeof(struct ladish_command_create_room), "create_room");
   if (cmd_ptr == NULL)
   {
     cdbus_error(call_ptr, DBUS_ERROR_FAILED, "ladish_command_new() failed.");
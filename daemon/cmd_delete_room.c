@@ -104,7 +104,7 @@ bool ladish_command_delete_room(void * call_ptr, struct ladish_cqueue * queue_pt
     goto fail;
   }
 
-  cmd_ptr = ladish_command_new(sizeof(struct ladish_command_delete_room));
+  cmd_ptr = ladish_command_new(sizeof(struct ladish_command_delete_room), "delete_room");
   if (cmd_ptr == NULL)
   {
     cdbus_error(call_ptr, DBUS_ERROR_FAILED, "ladish_command_new() failed.");
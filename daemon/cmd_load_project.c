@@ -94,7 +94,7 @@ ladish_command_load_project(
     goto fail_drop_unload_command;
   }
 
-  cmd_ptr = ladish_command_new(sizeof(struct ladish_command_load_project));
+  cmd_ptr = ladish_command_new(sizeof(struct ladish_command_load_project), "load_project");
   if (cmd_ptr == NULL)
   {
     log_error("ladish_command_new() failed.");
@@ -106,9 +106,9 @@ ladish_command_load_project(
   uuid_copy(cmd_ptr->room_uuid, room_uuid_ptr);
   cmd_ptr->project_dir = project_dir_dup;
 
-  if (!ladish_cqueue_add_command(queue_ptr, &cmd_ptr->command))
+  if (!ladish_cqueue_add_scoped_command(queue_ptr, &cmd_ptr->command, ladish_command_room_scope(room_uuid_ptr)))
   {
-    cdbus_error(call_ptr, DBUS_ERROR_FAILED, "ladish_cqueue_add_command() failed.");
+    cdbus_error(call_ptr, DBUS_ERROR_FAILED, "ladish_cqueue_add_scoped_command() failed.");
     goto fail_destroy_command;
   }
 
@@ -894,10 +894,7 @@ static bool run(void * command_context)
   char * path;
   struct stat st;
   XML_Parser parser;
-  int bytes_read;
-  void * buffer;
   int fd;
-  enum XML_Status xmls;
   struct ladish_parse_context parse_context;
 
   ASSERT(cmd_ptr->command.state == LADISH_COMMAND_STATE_PENDING);
@@ -943,28 +940,6 @@ static bool run(void * command_context)
     return false;
   }
 
-  //log_info("conf file size is %llu bytes", (unsigned long long)st.st_size);
-
-  /* we are expecting that conf file has small enough size to fit in memory */
-
-  buffer = XML_GetBuffer(parser, st.st_size);
-  if (buffer == NULL)
-  {
-    log_error("XML_GetBuffer() failed.");
-    XML_ParserFree(parser);
-    close(fd);
-    return false;
-  }
-
-  bytes_read = read(fd, buffer, st.st_size);
-  if (bytes_read != st.st_size)
-  {
-    log_error("read() returned unexpected result.");
-    XML_ParserFree(parser);
-    close(fd);
-    return false;
-  }
-
   parse_context.error = XML_FALSE;
   parse_context.depth = -1;
   parse_context.str = NULL;
@@ -985,14 +960,8 @@ static bool run(void * command_context)
     return false;
   }
 
-  xmls = XML_ParseBuffer(parser, bytes_read, XML_TRUE);
-  if (xmls == XML_STATUS_ERROR)
+  if (!ladish_parse_fd(parser, fd, path, &parse_context.error))
   {
-    if (!parse_context.error)
-    {
-      log_error("XML_ParseBuffer() failed.");
-    }
-
     ladish_notify_simple(LADISH_NOTIFY_URGENCY_HIGH, "Studio load failed", LADISH_CHECK_LOG_TEXT);
     ladish_studio_clear();
     XML_ParserFree(parser);
@@ -1003,16 +972,10 @@ static bool run(void * command_context)
   XML_ParserFree(parser);
   close(fd);
 
-  if (parse_context.error)
-  {
-    ladish_studio_clear();
-    ladish_notify_simple(LADISH_NOTIFY_URGENCY_HIGH, "Studio load failed", LADISH_CHECK_LOG_TEXT);
-    return false;
-  }
-
   ladish_interlink(ladish_studio_get_studio_graph(), ladish_studio_get_studio_app_supervisor());
 
   g_studio.persisted = true;
+  g_studio.saved = ladish_modified_now();
   log_info("Studio loaded. ('%s')", path);
 
   ladish_graph_dump(g_studio.jack_graph);
@@ -1060,7 +1023,7 @@ bool ladish_command_load_studio(void * call_ptr, struct ladish_cqueue * queue_pt
     goto fail_free_name;
   }
 
-  cmd_ptr = ladish_command_new(sizeof(struct ladish_command_load_studio));
+  cmd_ptr = ladish_command_new(sizeof(struct ladish_command_load_studio), "load_studio");
   if (cmd_ptr == NULL)
   {
     log_error("ladish_command_new() failed.");
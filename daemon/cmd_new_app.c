@@ -202,7 +202,7 @@ ladish_command_new_app(
     goto fail_free_name;
   }
 
-  cmd_ptr = ladish_command_new(sizeof(struct ladish_command_new_app));
+  cmd_ptr = ladish_command_new(sizeof(struct ladish_command_new_app), "new_app");
   if (cmd_ptr == NULL)
   {
     cdbus_error(call_ptr, DBUS_ERROR_FAILED, "ladish_command_new() failed.");
@@ -217,9 +217,9 @@ ladish_command_new_app(
   cmd_ptr->terminal = terminal;
   cmd_ptr->level = level_dup;
 
-  if (!ladish_cqueue_add_command(queue_ptr, &cmd_ptr->command))
+  if (!ladish_cqueue_add_scoped_command(queue_ptr, &cmd_ptr->command, opath))
   {
-    cdbus_error(call_ptr, DBUS_ERROR_FAILED, "ladish_cqueue_add_command() failed.");
+    cdbus_error(call_ptr, DBUS_ERROR_FAILED, "ladish_cqueue_add_scoped_command() failed.");
     goto fail_destroy_command;
   }
 
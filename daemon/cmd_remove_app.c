@@ -113,7 +113,7 @@ bool ladish_command_remove_app(void * call_ptr, struct ladish_cqueue * queue_ptr
     goto fail_drop_stop_command;
   }
 
-  cmd_ptr = ladish_command_new(sizeof(struct ladish_command_remove_app));
+  cmd_ptr = ladish_command_new(sizeof(struct ladish_command_remove_app), "remove_app");
   if (cmd_ptr == NULL)
   {
     cdbus_error(call_ptr, DBUS_ERROR_FAILED, "ladish_command_new() failed.");
@@ -125,9 +125,9 @@ bool ladish_command_remove_app(void * call_ptr, struct ladish_cqueue * queue_ptr
   cmd_ptr->opath = opath_dup;
   cmd_ptr->id = id;
 
-  if (!ladish_cqueue_add_command(queue_ptr, &cmd_ptr->command))
+  if (!ladish_cqueue_add_scoped_command(queue_ptr, &cmd_ptr->command, opath))
   {
-    cdbus_error(call_ptr, DBUS_ERROR_FAILED, "ladish_cqueue_add_command() failed.");
+    cdbus_error(call_ptr, DBUS_ERROR_FAILED, "ladish_cqueue_add_scoped_command() failed.");
     goto fail_destroy_command;
   }
 
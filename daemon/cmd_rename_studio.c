@@ -76,7 +76,7 @@ bool ladish_command_rename_studio(void * call_ptr, struct ladish_cqueue * queue_
     goto fail;
   }
 
-  cmd_ptr = ladish_command_new(sizeof(struct ladish_command_rename_studio));
+  cmd_ptr = ladish_command_new(sizeof(struct ladish_command_rename_studio), "rename_studio");
   if (cmd_ptr == NULL)
   {
     log_error("ladish_command_new() failed.");
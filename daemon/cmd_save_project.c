@@ -123,7 +123,7 @@ ladish_command_save_project(
     goto fail_free_dir;
   }
 
-  cmd_ptr = ladish_command_new(sizeof(struct ladish_command_save_project));
+  cmd_ptr = ladish_command_new(sizeof(struct ladish_command_save_project), "save_project");
   if (cmd_ptr == NULL)
   {
     log_error("ladish_command_new() failed.");
@@ -139,9 +139,9 @@ ladish_command_save_project(
   cmd_ptr->done = false;
   cmd_ptr->success = true;
 
-  if (!ladish_cqueue_add_command(queue_ptr, &cmd_ptr->command))
+  if (!ladish_cqueue_add_scoped_command(queue_ptr, &cmd_ptr->command, ladish_command_room_scope(room_uuid_ptr)))
   {
-    cdbus_error(call_ptr, DBUS_ERROR_FAILED, "ladish_cqueue_add_command() failed.");
+    cdbus_error(call_ptr, DBUS_ERROR_FAILED, "ladish_cqueue_add_scoped_command() failed.");
     goto fail_destroy_command;
   }
 
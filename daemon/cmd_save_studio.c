@@ -44,7 +44,7 @@
 
 bool
 write_jack_parameter(
-  int fd,
+  struct ladish_writer * writer,
   int indent,
   struct jack_conf_parameter * parameter_ptr)
 {
@@ -66,17 +66,17 @@ write_jack_parameter(
   while (*src != 0);
   *dst = 0;
 
-  if (!ladish_write_indented_string(fd, indent, "<parameter path=\""))
+  if (!ladish_write_indented_string(writer, indent, "<parameter path=\""))
   {
     return false;
   }
 
-  if (!ladish_write_string(fd, path))
+  if (!ladish_write_string(writer, path))
   {
     return false;
   }
 
-  if (!ladish_write_string(fd, "\">"))
+  if (!ladish_write_string(writer, "\">"))
   {
     return false;
   }
@@ -112,12 +112,12 @@ write_jack_parameter(
     return false;
   }
 
-  if (!ladish_write_string(fd, content))
+  if (!ladish_write_string(writer, content))
   {
     return false;
   }
 
-  if (!ladish_write_string(fd, "</parameter>\n"))
+  if (!ladish_write_string(writer, "</parameter>\n"))
   {
     return false;
   }
@@ -125,7 +125,7 @@ write_jack_parameter(
   return true;
 }
 
-#define fd (((struct ladish_write_context *)context)->fd)
+#define writer (((struct ladish_write_context *)context)->writer)
 #define indent (((struct ladish_write_context *)context)->indent)
 
 static bool save_studio_room(void * context, ladish_room_handle room)
@@ -135,17 +135,17 @@ static bool save_studio_room(void * context, ladish_room_handle room)
 
   log_info("saving room '%s'", ladish_room_get_name(room));
 
-  if (!ladish_write_indented_string(fd, indent, "<room name=\""))
+  if (!ladish_write_indented_string(writer, indent, "<room name=\""))
   {
     return false;
   }
 
-  if (!ladish_write_string(fd, ladish_room_get_name(room)))
+  if (!ladish_write_string(writer, ladish_room_get_name(room)))
   {
     return false;
   }
 
-  if (!ladish_write_string(fd, "\" uuid=\""))
+  if (!ladish_write_string(writer, "\" uuid=\""))
   {
     return false;
   }
@@ -153,23 +153,23 @@ static bool save_studio_room(void * context, ladish_room_handle room)
   ladish_room_get_uuid(room, uuid);
   uuid_unparse(uuid, str);
 
-  if (!ladish_write_string(fd, str))
+  if (!ladish_write_string(writer, str))
   {
     return false;
   }
 
-  if (!ladish_write_string(fd, "\">\n"))
+  if (!ladish_write_string(writer, "\">\n"))
   {
     return false;
   }
 
-  if (!ladish_write_room_link_ports(fd, indent + 1, room))
+  if (!ladish_write_room_link_ports(writer, indent + 1, room))
   {
     log_error("ladish_write_room_link_ports() failed");
     return false;
   }
 
-  if (!ladish_write_indented_string(fd, indent, " </room>\n"))
+  if (!ladish_write_indented_string(writer, indent, " </room>\n"))
   {
     return false;
   }
@@ -178,7 +178,7 @@ static bool save_studio_room(void * context, ladish_room_handle room)
 }
 
 #undef indent
-#undef fd
+#undef writer
 
 struct ladish_command_save_studio
 {
@@ -186,13 +186,18 @@ struct ladish_command_save_studio
   char * studio_name;
   bool done;
   bool success;
+  bool renaming;
+  uint64_t snapshot;            /* modification clock value at the time the studio xml was composed */
+  struct ladish_save_job * job;
 };
 
+static void ladish_save_studio_xml_complete(void * context, bool success);
+
 static bool ladish_save_studio_xml(struct ladish_command_save_studio * cmd_ptr)
 {
   struct list_head * node_ptr;
   struct jack_conf_parameter * parameter_ptr;
-  int fd;
+  struct ladish_writer writer;
   time_t timestamp;
   char timestamp_str[26];
   bool ret;
@@ -248,19 +253,22 @@ static bool ladish_save_studio_xml(struct ladish_command_save_studio * cmd_ptr)
   ASSERT(g_studio.filename != NULL);
   ASSERT(g_studio.filename != bak_filename);
 
+  if (!renaming &&
+      old_filename != NULL &&
+      strcmp(old_filename, g_studio.filename) == 0 &&
+      !ladish_studio_is_dirty())
+  {
+    log_info("studio is not modified, skipping the studio xml write (%s)", g_studio.filename);
+    cmd_ptr->done = true;
+    ret = true;
+    goto free_filenames;
+  }
+
   if (bak_filename != NULL)
   {
     ASSERT(old_filename != NULL);
 
-    if (stat(old_filename, &st) == 0) /* if old filename does not exist, rename with fail */
-    {
-      if (rename(old_filename, bak_filename) != 0)
-      {
-        log_error("rename(%s, %s) failed: %d (%s)", old_filename, bak_filename, errno, strerror(errno));
-        goto free_filenames;
-      }
-    }
-    else
+    if (stat(old_filename, &st) != 0)
     {
       /* mark that there is no backup file */
       free(bak_filename);
@@ -270,59 +278,58 @@ static bool ladish_save_studio_xml(struct ladish_command_save_studio * cmd_ptr)
 
   log_info("saving studio... (%s)", g_studio.filename);
 
-  fd = open(g_studio.filename, O_WRONLY | O_TRUNC | O_CREAT, 0666);
-  if (fd == -1)
+  /* the document is composed in memory and written to disk by a save job */
+  if (!ladish_writer_open_memory(&writer))
   {
-    log_error("open(%s) failed: %d (%s)", g_studio.filename, errno, strerror(errno));
-    goto rename_back;
+    goto free_filenames;
   }
 
-  if (!ladish_write_string(fd, "<?xml version=\"1.0\"?>\n"))
+  if (!ladish_write_string(&writer, "<?xml version=\"1.0\"?>\n"))
   {
     goto close;
   }
 
-  if (!ladish_write_string(fd, "<!--\n"))
+  if (!ladish_write_string(&writer, "<!--\n"))
   {
     goto close;
   }
 
-  if (!ladish_write_string(fd, STUDIO_HEADER_TEXT))
+  if (!ladish_write_string(&writer, STUDIO_HEADER_TEXT))
   {
     goto close;
   }
 
-  if (!ladish_write_string(fd, "-->\n"))
+  if (!ladish_write_string(&writer, "-->\n"))
   {
     goto close;
   }
 
-  if (!ladish_write_string(fd, "<!-- "))
+  if (!ladish_write_string(&writer, "<!-- "))
   {
     goto close;
   }
 
-  if (!ladish_write_string(fd, timestamp_str))
+  if (!ladish_write_string(&writer, timestamp_str))
   {
     goto close;
   }
 
-  if (!ladish_write_string(fd, " -->\n"))
+  if (!ladish_write_string(&writer, " -->\n"))
   {
     goto close;
   }
 
-  if (!ladish_write_string(fd, "<studio>\n"))
+  if (!ladish_write_string(&writer, "<studio>\n"))
   {
     goto close;
   }
 
-  if (!ladish_write_indented_string(fd, 1, "<jack>\n"))
+  if (!ladish_write_indented_string(&writer, 1, "<jack>\n"))
   {
     goto close;
   }
 
-  if (!ladish_write_indented_string(fd, 2, "<conf>\n"))
+  if (!ladish_write_indented_string(&writer, 2, "<conf>\n"))
   {
     goto close;
   }
@@ -331,37 +338,37 @@ static bool ladish_save_studio_xml(struct ladish_command_save_studio * cmd_ptr)
   {
     parameter_ptr = list_entry(node_ptr, struct jack_conf_parameter, leaves);
 
-    if (!write_jack_parameter(fd, 3, parameter_ptr))
+    if (!write_jack_parameter(&writer, 3, parameter_ptr))
     {
       goto close;
     }
   }
 
-  if (!ladish_write_indented_string(fd, 2, "</conf>\n"))
+  if (!ladish_write_indented_string(&writer, 2, "</conf>\n"))
   {
     goto close;
   }
 
-  if (!ladish_write_jgraph(fd, 2, ladish_studio_get_studio_graph(), ladish_studio_get_studio_app_supervisor()))
+  if (!ladish_write_jgraph(&writer, 2, ladish_studio_get_studio_graph(), ladish_studio_get_studio_app_supervisor()))
   {
     log_error("ladish_write_jgraph() failed for studio graph");
     goto close;
   }
 
-  if (!ladish_write_indented_string(fd, 1, "</jack>\n"))
+  if (!ladish_write_indented_string(&writer, 1, "</jack>\n"))
   {
     goto close;
   }
 
   if (ladish_studio_has_rooms())
   {
-    if (!ladish_write_indented_string(fd, 1, "<rooms>\n"))
+    if (!ladish_write_indented_string(&writer, 1, "<rooms>\n"))
     {
       goto close;
     }
 
     save_context.indent = 2;
-    save_context.fd = fd;
+    save_context.writer = &writer;
 
     if (!ladish_studio_iterate_rooms(&save_context, save_studio_room))
     {
@@ -369,55 +376,42 @@ static bool ladish_save_studio_xml(struct ladish_command_save_studio * cmd_ptr)
       goto close;
     }
 
-    if (!ladish_write_indented_string(fd, 1, "</rooms>\n"))
+    if (!ladish_write_indented_string(&writer, 1, "</rooms>\n"))
     {
       goto close;
     }
   }
 
-  if (!ladish_write_vgraph(fd, 1, g_studio.studio_graph, g_studio.app_supervisor))
+  if (!ladish_write_vgraph(&writer, 1, g_studio.studio_graph, g_studio.app_supervisor))
   {
     log_error("ladish_write_vgraph() failed for studio");
     goto close;
   }
 
-  if (!ladish_write_dict(fd, 1, ladish_graph_get_dict(g_studio.studio_graph)))
+  if (!ladish_write_dict(&writer, 1, ladish_graph_get_dict(g_studio.studio_graph)))
   {
     goto close;
   }
 
-  if (!ladish_write_string(fd, "</studio>\n"))
+  if (!ladish_write_string(&writer, "</studio>\n"))
   {
     goto close;
   }
 
-  log_info("studio saved. (%s)", g_studio.filename);
-  g_studio.persisted = true;
-  g_studio.automatic = false;   /* even if it was automatic, it is not anymore because it is saved */
-
-  ret = true;
-
-  if (renaming)
+  cmd_ptr->job = ladish_save_job_start(&writer, g_studio.filename, old_filename, bak_filename, cmd_ptr, ladish_save_studio_xml_complete);
+  if (cmd_ptr->job == NULL)
   {
-    free(g_studio.name);
-    g_studio.name = cmd_ptr->studio_name;
-    cmd_ptr->studio_name = NULL; /* mark that descructor does not need to free the new name buffer */
-    ladish_studio_emit_renamed(); /* uses g_studio.name */
+    goto close;
   }
 
-close:
-  close(fd);
+  /* the job took over the document */
+  cmd_ptr->renaming = renaming;
+  cmd_ptr->snapshot = ladish_modified_now();
+  ret = true;
+  goto free_filenames;
 
-rename_back:
-  if (!ret && bak_filename != NULL)
-  {
-    /* save failed - try to rename the backup file back */
-    ASSERT(old_filename != NULL);
-    if (rename(bak_filename, old_filename) != 0)
-    {
-      log_error("rename(%s, %s) failed: %d (%s)", bak_filename, g_studio.filename, errno, strerror(errno));
-    }
-  }
+close:
+  ladish_writer_close(&writer);
 
 free_filenames:
   if (bak_filename != NULL)
@@ -439,6 +433,38 @@ exit:
 
 #define cmd_ptr ((struct ladish_command_save_studio *)context)
 
+static void ladish_save_studio_xml_complete(void * context, bool success)
+{
+  ASSERT(cmd_ptr->command.state == LADISH_COMMAND_STATE_WAITING);
+
+  ladish_save_job_destroy(cmd_ptr->job);
+  cmd_ptr->job = NULL;
+
+  if (!success)
+  {
+    log_error("studio save failed. (%s)", g_studio.filename);
+    ladish_notify_simple(LADISH_NOTIFY_URGENCY_HIGH, "Studio save failed", LADISH_CHECK_LOG_TEXT);
+    cmd_ptr->success = false;
+    goto done;
+  }
+
+  log_info("studio saved. (%s)", g_studio.filename);
+  g_studio.persisted = true;
+  g_studio.saved = cmd_ptr->snapshot;
+  g_studio.automatic = false;   /* even if it was automatic, it is not anymore because it is saved */
+
+  if (cmd_ptr->renaming)
+  {
+    free(g_studio.name);
+    g_studio.name = cmd_ptr->studio_name;
+    cmd_ptr->studio_name = NULL; /* mark that descructor does not need to free the new name buffer */
+    ladish_studio_emit_renamed(); /* uses g_studio.name */
+  }
+
+done:
+  cmd_ptr->done = true;
+}
+
 static void ladish_studio_apps_save_complete(void * context, bool success)
 {
   ASSERT(cmd_ptr->command.state == LADISH_COMMAND_STATE_WAITING);
@@ -451,17 +477,14 @@ static void ladish_studio_apps_save_complete(void * context, bool success)
 
   log_info("Studio apps saved successfully");
   if (ladish_save_studio_xml(cmd_ptr))
-  {
-    goto done;
+  { /* ladish_save_studio_xml_complete() is called when the save job finishes */
+    return;
   }
 
 fail:
   ladish_notify_simple(LADISH_NOTIFY_URGENCY_HIGH, "Studio save failed", LADISH_CHECK_LOG_TEXT);
   cmd_ptr->success = false;
-
-done:
   cmd_ptr->done = true;
-  return;
 }
 
 #undef cmd_ptr
@@ -506,6 +529,11 @@ static bool run(void * command_context)
 static void destructor(void * command_context)
 {
   log_info("save studio command destructor");
+  if (cmd_ptr->job != NULL)
+  {
+    ladish_save_job_destroy(cmd_ptr->job);
+  }
+
   if (cmd_ptr->studio_name != NULL)
   {
     free(cmd_ptr->studio_name);
@@ -526,7 +554,7 @@ bool ladish_command_save_studio(void * call_ptr, struct ladish_cqueue * queue_pt
     goto fail;
   }
 
-  cmd_ptr = ladish_command_new(sizeof(struct ladish_command_save_studio));
+  cmd_ptr = ladish_command_new(sizeof(struct ladish_command_save_studio), "save_studio");
   if (cmd_ptr == NULL)
   {
     log_error("ladish_command_new() failed.");
@@ -538,6 +566,9 @@ bool ladish_command_save_studio(void * call_ptr, struct ladish_cqueue * queue_pt
   cmd_ptr->studio_name = studio_name_dup;
   cmd_ptr->done = false;
   cmd_ptr->success = true;
+  cmd_ptr->renaming = false;
+  cmd_ptr->snapshot = 0;
+  cmd_ptr->job = NULL;
 
   if (!ladish_cqueue_add_command(queue_ptr, &cmd_ptr->command))
   {
@@ -134,7 +134,7 @@ bool ladish_command_start_studio(void * call_ptr, struct ladish_cqueue * queue_p
 {
   struct ladish_command_start_studio * cmd_ptr;
 
-  cmd_ptr = ladish_command_new(sizeof(struct ladish_command_start_studio));
+  cmd_ptr = ladish_command_new(sizeof(struct ladish_command_start_studio), "start_studio");
   if (cmd_ptr == NULL)
   {
     cdbus_error(call_ptr, DBUS_ERROR_FAILED, "ladish_command_new() failed.");
@@ -195,7 +195,7 @@ bool ladish_command_stop_studio(void * call_ptr, struct ladish_cqueue * queue_pt
 {
   struct ladish_command_stop_studio * cmd_ptr;
 
-  cmd_ptr = ladish_command_new(sizeof(struct ladish_command_stop_studio));
+  cmd_ptr = ladish_command_new(sizeof(struct ladish_command_stop_studio), "stop_studio");
   if (cmd_ptr == NULL)
   {
     cdbus_error(call_ptr, DBUS_ERROR_FAILED, "ladish_command_new() failed.");
@@ -52,7 +52,7 @@ bool ladish_command_unload_studio(void * call_ptr, struct ladish_cqueue * queue_
     goto fail;
   }
 
-  cmd_ptr = ladish_command_new(sizeof(struct ladish_command));
+  cmd_ptr = ladish_command_new(sizeof(struct ladish_command), "unload_studio");
   if (cmd_ptr == NULL)
   {
     log_error("ladish_command_new() failed.");
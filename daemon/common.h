@@ -59,6 +59,16 @@ struct connection
 
 extern bool g_quit;
 
+/* Monotonic modification clock. Objects that are persisted remember the
+ * clock value of their last change, savers remember the value at the time
+ * of the last successful save. Zero means "never". */
+extern uint64_t g_ladish_modified_clock;
+
+static inline uint64_t ladish_modified_now(void)
+{
+  return ++g_ladish_modified_clock;
+}
+
 void ladish_check_integrity(void);
 
 #endif /* #ifndef COMMON_H__CFDC869A_31AE_4FA3_B2D3_DACA8488CA55__INCLUDED */
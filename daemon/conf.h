@@ -32,11 +32,15 @@
 #define LADISH_CONF_KEY_DAEMON_TERMINAL           "/org/ladish/daemon/terminal"
 #define LADISH_CONF_KEY_DAEMON_STUDIO_AUTOSTART   "/org/ladish/daemon/studio_autostart"
 #define LADISH_CONF_KEY_DAEMON_JS_SAVE_DELAY      "/org/ladish/daemon/js_save_delay"
+#define LADISH_CONF_KEY_DAEMON_APP_OUTPUT_BUFFER  "/org/ladish/daemon/app_output_buffer"
+#define LADISH_CONF_KEY_DAEMON_APP_LOG_SIZE       "/org/ladish/daemon/app_log_size"
 
 #define LADISH_CONF_KEY_DAEMON_NOTIFY_DEFAULT             true
 #define LADISH_CONF_KEY_DAEMON_SHELL_DEFAULT              "sh"
 #define LADISH_CONF_KEY_DAEMON_TERMINAL_DEFAULT           "xterm"
 #define LADISH_CONF_KEY_DAEMON_STUDIO_AUTOSTART_DEFAULT   true
 #define LADISH_CONF_KEY_DAEMON_JS_SAVE_DELAY_DEFAULT      0
+#define LADISH_CONF_KEY_DAEMON_APP_OUTPUT_BUFFER_DEFAULT  65536 /* bytes of recent output kept per app, 0 disables */
+#define LADISH_CONF_KEY_DAEMON_APP_LOG_SIZE_DEFAULT       1048576 /* app log file is rotated above this size, 0 disables rotation */
 
 #endif /* #ifndef CONF_H__795797BE_4EB8_44F8_BD9C_B8A9CB975228__INCLUDED */
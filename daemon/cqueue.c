@@ -26,6 +26,20 @@
 
 #include "cmd.h"
 #include "control.h"
+#include "studio.h"
+#include "room.h"
+#include "flightrec.h"
+#include "metrics.h"
+#include "../common/intern.h"
+
+/* Commands are queued in submission order. Each command has a scope,
+ * the object path of the room or app supervisor it operates on, or
+ * NULL for commands that operate on the whole studio. A command is
+ * run once all commands queued before it on the same scope are done,
+ * so a command waiting for apps in one room does not block commands
+ * for other rooms. Whole studio commands are barriers, they wait for
+ * all commands queued before them and block all commands queued after
+ * them. */
 
 void ladish_cqueue_init(struct ladish_cqueue * queue_ptr)
 {
@@ -33,69 +47,166 @@ void ladish_cqueue_init(struct ladish_cqueue * queue_ptr)
   INIT_LIST_HEAD(&queue_ptr->queue);
 }
 
-void ladish_cqueue_run(struct ladish_cqueue * queue_ptr)
+static void ladish_cqueue_destroy_command(struct ladish_command * cmd_ptr)
+{
+  if (cmd_ptr->destructor != NULL)
+  {
+    cmd_ptr->destructor(cmd_ptr->context);
+  }
+
+  ladish_intern_release(cmd_ptr->scope);
+  free(cmd_ptr);
+}
+
+/* scopes are interned so they can be compared by pointer */
+static bool ladish_cqueue_is_runnable(struct ladish_cqueue * queue_ptr, struct ladish_command * cmd_ptr)
 {
   struct list_head * node_ptr;
-  struct ladish_command * cmd_ptr;
+  struct ladish_command * prev_cmd_ptr;
 
-loop:
-  if (list_empty(&queue_ptr->queue))
+  list_for_each(node_ptr, &queue_ptr->queue)
   {
-    return;
+    prev_cmd_ptr = list_entry(node_ptr, struct ladish_command, siblings);
+    if (prev_cmd_ptr == cmd_ptr)
+    {
+      return true;
+    }
+
+    if (prev_cmd_ptr->scope == NULL || cmd_ptr->scope == NULL || prev_cmd_ptr->scope == cmd_ptr->scope)
+    {
+      return false;
+    }
   }
 
-  node_ptr = queue_ptr->queue.next;
-  cmd_ptr = list_entry(node_ptr, struct ladish_command, siblings);
+  ASSERT_NO_PASS;               /* command is not in the queue */
+  return false;
+}
 
-  ASSERT(cmd_ptr->run != NULL);
-  ASSERT(cmd_ptr->state == LADISH_COMMAND_STATE_PENDING || cmd_ptr->state == LADISH_COMMAND_STATE_WAITING);
+/* Remove a failed command together with the commands that depend on it:
+ * the ones queued after it on the same scope, the barriers queued after
+ * it and everything queued after such barrier. Commands of other scopes
+ * that are already running are left to complete. If the failed command
+ * is itself a barrier, everything queued after it is removed. */
+static void ladish_cqueue_clear_failed(struct ladish_cqueue * queue_ptr, struct ladish_command * failed_cmd_ptr)
+{
+  struct list_head * node_ptr;
+  struct list_head * next_node_ptr;
+  struct ladish_command * cmd_ptr;
+  bool barrier_cleared;
 
-  if (cmd_ptr->state == LADISH_COMMAND_STATE_PENDING)
-  { /* if this is a new command, put a separator so its impact is clearly visible in the log */
-    log_info("-------");
-  }
+  barrier_cleared = failed_cmd_ptr->scope == NULL;
+  node_ptr = failed_cmd_ptr->siblings.next;
 
-  if (!cmd_ptr->run(cmd_ptr->context))
+  while (node_ptr != &queue_ptr->queue)
   {
-    ladish_cqueue_clear(queue_ptr);
-    emit_queue_execution_halted();
-    return;
+    next_node_ptr = node_ptr->next;
+    cmd_ptr = list_entry(node_ptr, struct ladish_command, siblings);
+
+    if (cmd_ptr->scope == NULL)
+    {
+      barrier_cleared = true;
+    }
+
+    if (barrier_cleared || cmd_ptr->scope == failed_cmd_ptr->scope)
+    {
+      /* commands queued after the failed one cannot have been started yet */
+      ASSERT(cmd_ptr->state == LADISH_COMMAND_STATE_PENDING);
+
+      list_del(node_ptr);
+      ladish_flightrec_record(LADISH_FLIGHTREC_CMD_CLEARED, (uintptr_t)cmd_ptr, (uintptr_t)cmd_ptr->run, cmd_ptr->state);
+      ladish_cqueue_destroy_command(cmd_ptr);
+    }
+
+    node_ptr = next_node_ptr;
   }
 
-  switch (cmd_ptr->state)
+  list_del(&failed_cmd_ptr->siblings);
+  ladish_flightrec_record(LADISH_FLIGHTREC_CMD_CLEARED, (uintptr_t)failed_cmd_ptr, (uintptr_t)failed_cmd_ptr->run, failed_cmd_ptr->state);
+  ladish_cqueue_destroy_command(failed_cmd_ptr);
+
+  if (queue_ptr->cancel && list_empty(&queue_ptr->queue))
   {
-  case LADISH_COMMAND_STATE_DONE:
-    break;
-  case LADISH_COMMAND_STATE_WAITING:
-    return;
-  default:
-    log_error("unexpected cmd state %u after run()", cmd_ptr->state);
-    ASSERT_NO_PASS;
-    ladish_cqueue_clear(queue_ptr);
-    emit_queue_execution_halted();
-    return;
+    queue_ptr->cancel = false;
   }
+}
 
-  list_del(node_ptr);
+void ladish_cqueue_run(struct ladish_cqueue * queue_ptr)
+{
+  struct list_head * node_ptr;
+  struct list_head * next_node_ptr;
+  struct ladish_command * cmd_ptr;
 
-  if (cmd_ptr->destructor != NULL)
+  /* run() is not supposed to modify the queue */
+  list_for_each_safe(node_ptr, next_node_ptr, &queue_ptr->queue)
   {
-    cmd_ptr->destructor(cmd_ptr->context);
-  }
+    cmd_ptr = list_entry(node_ptr, struct ladish_command, siblings);
 
-  free(cmd_ptr);
+    ASSERT(cmd_ptr->run != NULL);
+    ASSERT(cmd_ptr->state == LADISH_COMMAND_STATE_PENDING || cmd_ptr->state == LADISH_COMMAND_STATE_WAITING);
+
+    if (!ladish_cqueue_is_runnable(queue_ptr, cmd_ptr))
+    {
+      if (cmd_ptr->scope == NULL)
+      { /* barrier, nothing after it can run */
+        break;
+      }
+
+      continue;
+    }
+
+    if (cmd_ptr->state == LADISH_COMMAND_STATE_PENDING)
+    { /* if this is a new command, put a separator so its impact is clearly visible in the log */
+      log_info("-------");
+      cmd_ptr->start_time = ladish_metrics_now();
+    }
+
+    ladish_flightrec_record(LADISH_FLIGHTREC_CMD_RUN, (uintptr_t)cmd_ptr, (uintptr_t)cmd_ptr->run, cmd_ptr->state);
+
+    if (!cmd_ptr->run(cmd_ptr->context))
+    {
+      ladish_flightrec_record(LADISH_FLIGHTREC_CMD_FAILED, (uintptr_t)cmd_ptr, (uintptr_t)cmd_ptr->run, cmd_ptr->state);
+      ladish_cqueue_clear_failed(queue_ptr, cmd_ptr);
+      emit_queue_execution_halted();
+      return;
+    }
+
+    switch (cmd_ptr->state)
+    {
+    case LADISH_COMMAND_STATE_DONE:
+      break;
+    case LADISH_COMMAND_STATE_WAITING:
+      continue;
+    default:
+      log_error("unexpected cmd state %u after run()", cmd_ptr->state);
+      ASSERT_NO_PASS;
+      ladish_cqueue_clear_failed(queue_ptr, cmd_ptr);
+      emit_queue_execution_halted();
+      return;
+    }
+
+    list_del(node_ptr);
+
+    ladish_flightrec_record(LADISH_FLIGHTREC_CMD_DONE, (uintptr_t)cmd_ptr, (uintptr_t)cmd_ptr->run, cmd_ptr->state);
+    ladish_metrics_record("cmd", cmd_ptr->type, ladish_metrics_now() - cmd_ptr->start_time);
+
+    ladish_cqueue_destroy_command(cmd_ptr);
+  }
 
   if (queue_ptr->cancel && list_empty(&queue_ptr->queue))
   {
     queue_ptr->cancel = false;
   }
+}
 
-  goto loop;
+bool ladish_cqueue_is_empty(struct ladish_cqueue * queue_ptr)
+{
+  return list_empty(&queue_ptr->queue);
 }
 
 void ladish_cqueue_cancel(struct ladish_cqueue * queue_ptr)
 {
   struct list_head * node_ptr;
+  struct list_head * next_node_ptr;
   struct ladish_command * cmd_ptr;
 
   if (list_empty(&queue_ptr->queue))
@@ -103,35 +214,27 @@ void ladish_cqueue_cancel(struct ladish_cqueue * queue_ptr)
     return;
   }
 
-  node_ptr = queue_ptr->queue.next; /* current command */
-  cmd_ptr = list_entry(node_ptr, struct ladish_command, siblings);
-  if (cmd_ptr->state != LADISH_COMMAND_STATE_WAITING)
-  {
-    ladish_cqueue_clear(queue_ptr);
-    return;
-  }
-
-  /* clear all commands except currently waiting one */
-  while (queue_ptr->queue.next != queue_ptr->queue.prev)
+  /* clear all commands except the currently waiting ones */
+  list_for_each_safe(node_ptr, next_node_ptr, &queue_ptr->queue)
   {
-    node_ptr = queue_ptr->queue.prev;
-    list_del(node_ptr);
-
     cmd_ptr = list_entry(node_ptr, struct ladish_command, siblings);
-
-    if (cmd_ptr->destructor != NULL)
+    if (cmd_ptr->state == LADISH_COMMAND_STATE_WAITING)
     {
-      cmd_ptr->destructor(cmd_ptr->context);
+      cmd_ptr->cancel = true;
+      continue;
     }
 
-    free(cmd_ptr);
+    list_del(node_ptr);
+    ladish_cqueue_destroy_command(cmd_ptr);
   }
 
-  queue_ptr->cancel = true;
-  cmd_ptr->cancel = true;
+  if (!list_empty(&queue_ptr->queue))
+  {
+    queue_ptr->cancel = true;
+  }
 }
 
-bool ladish_cqueue_add_command(struct ladish_cqueue * queue_ptr, struct ladish_command * cmd_ptr)
+bool ladish_cqueue_add_scoped_command(struct ladish_cqueue * queue_ptr, struct ladish_command * cmd_ptr, const char * scope)
 {
   ASSERT(cmd_ptr->run != NULL);
 
@@ -141,12 +244,28 @@ bool ladish_cqueue_add_command(struct ladish_cqueue * queue_ptr, struct ladish_c
   }
 
   ASSERT(cmd_ptr->state == LADISH_COMMAND_STATE_PREPARE);
+  ASSERT(cmd_ptr->scope == NULL);
+
+  if (scope != NULL)
+  {
+    cmd_ptr->scope = ladish_intern(scope);
+    if (cmd_ptr->scope == NULL)
+    {
+      return false;
+    }
+  }
+
   cmd_ptr->state = LADISH_COMMAND_STATE_PENDING;
 
   list_add_tail(&cmd_ptr->siblings, &queue_ptr->queue);
   return true;
 }
 
+bool ladish_cqueue_add_command(struct ladish_cqueue * queue_ptr, struct ladish_command * cmd_ptr)
+{
+  return ladish_cqueue_add_scoped_command(queue_ptr, cmd_ptr, NULL);
+}
+
 void ladish_cqueue_clear(struct ladish_cqueue * queue_ptr)
 {
   struct list_head * node_ptr;
@@ -159,12 +278,9 @@ void ladish_cqueue_clear(struct ladish_cqueue * queue_ptr)
 
     cmd_ptr = list_entry(node_ptr, struct ladish_command, siblings);
 
-    if (cmd_ptr->destructor != NULL)
-    {
-      cmd_ptr->destructor(cmd_ptr->context);
-    }
+    ladish_flightrec_record(LADISH_FLIGHTREC_CMD_CLEARED, (uintptr_t)cmd_ptr, (uintptr_t)cmd_ptr->run, cmd_ptr->state);
 
-    free(cmd_ptr);
+    ladish_cqueue_destroy_command(cmd_ptr);
   }
 
   queue_ptr->cancel = false;
@@ -188,15 +304,10 @@ void ladish_cqueue_drop_command(struct ladish_cqueue * queue_ptr)
   /* commands that are not yet prepared and those that are already processed are not supposed to be in the queue */
   ASSERT(cmd_ptr->state == LADISH_COMMAND_STATE_PENDING);
 
-  if (cmd_ptr->destructor != NULL)
-  {
-    cmd_ptr->destructor(cmd_ptr->context);
-  }
-
-  free(cmd_ptr);
+  ladish_cqueue_destroy_command(cmd_ptr);
 }
 
-void * ladish_command_new(size_t size)
+void * ladish_command_new(size_t size, const char * type)
 {
   struct ladish_command * cmd_ptr;
 
@@ -211,6 +322,9 @@ void * ladish_command_new(size_t size)
 
   cmd_ptr->state = LADISH_COMMAND_STATE_PREPARE;
   cmd_ptr->cancel = false;
+  cmd_ptr->type = type;
+  cmd_ptr->scope = NULL;
+  cmd_ptr->start_time = 0;
 
   cmd_ptr->context = cmd_ptr;
   cmd_ptr->run = NULL;
@@ -218,3 +332,17 @@ void * ladish_command_new(size_t size)
 
   return cmd_ptr;
 }
+
+/* Scope of commands that operate on a room, NULL (whole studio) if the room is not found */
+const char * ladish_command_room_scope(const uuid_t room_uuid)
+{
+  ladish_room_handle room;
+
+  room = ladish_studio_find_room_by_uuid(room_uuid);
+  if (room == NULL)
+  {
+    return NULL;
+  }
+
+  return ladish_room_get_opath(room);
+}
@@ -36,6 +36,7 @@ struct ladish_dict_entry
 struct ladish_dict
 {
   struct list_head entries;
+  uint64_t modified;            /* modification clock value of the last change */
 };
 
 bool ladish_dict_create(ladish_dict_handle * dict_handle_ptr)
@@ -50,6 +51,7 @@ bool ladish_dict_create(ladish_dict_handle * dict_handle_ptr)
   }
 
   INIT_LIST_HEAD(&dict_ptr->entries);
+  dict_ptr->modified = ladish_modified_now();
 
   *dict_handle_ptr = (ladish_dict_handle)dict_ptr;
 
@@ -97,6 +99,11 @@ bool ladish_dict_set(ladish_dict_handle dict_handle, const char * key, const cha
   entry_ptr = ladish_dict_find_key(dict_ptr, key);
   if (entry_ptr != NULL)
   {
+    if (strcmp(entry_ptr->value, value) == 0)
+    {
+      return true;
+    }
+
     new_value = strdup(value);
     if (new_value == NULL)
     {
@@ -106,6 +113,7 @@ bool ladish_dict_set(ladish_dict_handle dict_handle, const char * key, const cha
 
     free(entry_ptr->value);
     entry_ptr->value = new_value;
+    dict_ptr->modified = ladish_modified_now();
     return true;
   }
 
@@ -134,6 +142,7 @@ bool ladish_dict_set(ladish_dict_handle dict_handle, const char * key, const cha
   }
 
   list_add_tail(&entry_ptr->siblings, &dict_ptr->entries);
+  dict_ptr->modified = ladish_modified_now();
 
   return true;
 }
@@ -160,6 +169,7 @@ void ladish_dict_drop(ladish_dict_handle dict_handle, const char * key)
   if (entry_ptr != NULL)
   {
     ladish_dict_drop_entry(entry_ptr);
+    dict_ptr->modified = ladish_modified_now();
   }
 }
 
@@ -167,11 +177,18 @@ void ladish_dict_clear(ladish_dict_handle dict_handle)
 {
   struct ladish_dict_entry * entry_ptr;
 
+  if (list_empty(&dict_ptr->entries))
+  {
+    return;
+  }
+
   while (!list_empty(&dict_ptr->entries))
   {
     entry_ptr = list_entry(dict_ptr->entries.next, struct ladish_dict_entry, siblings);
     ladish_dict_drop_entry(entry_ptr);
   }
+
+  dict_ptr->modified = ladish_modified_now();
 }
 
 bool ladish_dict_iterate(ladish_dict_handle dict_handle, void * context, bool (* callback)(void * context, const char * key, const char * value))
@@ -196,6 +213,11 @@ bool ladish_dict_is_empty(ladish_dict_handle dict_handle)
   return list_empty(&dict_ptr->entries);
 }
 
+uint64_t ladish_dict_get_modified(ladish_dict_handle dict_handle)
+{
+  return dict_ptr->modified;
+}
+
 #undef dict_ptr
 
 static bool dup_key(void * context, const char * key, const char * value)
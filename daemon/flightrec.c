@@ -0,0 +1,262 @@
+/* -*- Mode: C ; c-basic-offset: 2 -*- */
+/*
+ * LADI Session Handler (ladish)
+ *
+ * Copyright (C) 2026 ladish authors, see the AUTHORS file
+ *
+ **************************************************************************
+ * This file contains implementation of the flight recorder
+ **************************************************************************
+ *
+ * LADI Session Handler is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * LADI Session Handler is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LADI Session Handler. If not, see <http://www.gnu.org/licenses/>
+ * or write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "flightrec.h"
+
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <limits.h>
+
+#define LADISH_FLIGHTREC_SIZE 4096 /* entries, power of two */
+
+struct ladish_flightrec_entry
+{
+  uint64_t timestamp;           /* CLOCK_MONOTONIC, nanoseconds */
+  uint32_t event;
+  uint64_t a;
+  uint64_t b;
+  uint64_t c;
+};
+
+static struct ladish_flightrec_entry g_flightrec[LADISH_FLIGHTREC_SIZE];
+static uint64_t g_flightrec_next;
+static char g_flightrec_path[PATH_MAX];
+
+static const char * g_flightrec_event_names[LADISH_FLIGHTREC_EVENT_MAX] =
+{
+  [LADISH_FLIGHTREC_GRAPH_CLIENT_ADDED] = "graph client added",
+  [LADISH_FLIGHTREC_GRAPH_CLIENT_REMOVED] = "graph client removed",
+  [LADISH_FLIGHTREC_GRAPH_CLIENT_RENAMED] = "graph client renamed",
+  [LADISH_FLIGHTREC_GRAPH_PORT_ADDED] = "graph port added",
+  [LADISH_FLIGHTREC_GRAPH_PORT_REMOVED] = "graph port removed",
+  [LADISH_FLIGHTREC_GRAPH_PORT_RENAMED] = "graph port renamed",
+  [LADISH_FLIGHTREC_GRAPH_CONNECTION_ADDED] = "graph connection added",
+  [LADISH_FLIGHTREC_GRAPH_CONNECTION_REMOVED] = "graph connection removed",
+  [LADISH_FLIGHTREC_JACK_CLIENT_APPEARED] = "JACK client appeared",
+  [LADISH_FLIGHTREC_JACK_CLIENT_DISAPPEARED] = "JACK client disappeared",
+  [LADISH_FLIGHTREC_JACK_PORT_APPEARED] = "JACK port appeared",
+  [LADISH_FLIGHTREC_JACK_PORT_DISAPPEARED] = "JACK port disappeared",
+  [LADISH_FLIGHTREC_JACK_PORTS_CONNECTED] = "JACK ports connected",
+  [LADISH_FLIGHTREC_JACK_PORTS_DISCONNECTED] = "JACK ports disconnected",
+  [LADISH_FLIGHTREC_CMD_RUN] = "command run",
+  [LADISH_FLIGHTREC_CMD_FAILED] = "command failed",
+  [LADISH_FLIGHTREC_CMD_DONE] = "command done",
+  [LADISH_FLIGHTREC_CMD_CLEARED] = "command cleared",
+  [LADISH_FLIGHTREC_DBUS_METHOD] = "D-Bus method",
+};
+
+static uint64_t ladish_flightrec_now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+void ladish_flightrec_init(const char * dump_path)
+{
+  size_t len;
+
+  len = strlen(dump_path);
+  if (len >= sizeof(g_flightrec_path))
+  {
+    log_error("flight recorder dump path too long");
+    return;
+  }
+
+  memcpy(g_flightrec_path, dump_path, len + 1);
+}
+
+void ladish_flightrec_record(enum ladish_flightrec_event event, uint64_t a, uint64_t b, uint64_t c)
+{
+  struct ladish_flightrec_entry * entry_ptr;
+
+  entry_ptr = g_flightrec + (__atomic_fetch_add(&g_flightrec_next, 1, __ATOMIC_RELAXED) & (LADISH_FLIGHTREC_SIZE - 1));
+  entry_ptr->timestamp = ladish_flightrec_now();
+  entry_ptr->event = event;
+  entry_ptr->a = a;
+  entry_ptr->b = b;
+  entry_ptr->c = c;
+}
+
+void ladish_flightrec_dbus_method(const char * UNUSED(iface), const char * method)
+{
+  uint64_t name[3];
+
+  memset(name, 0, sizeof(name));
+  strncpy((char *)name, method, sizeof(name));
+  ladish_flightrec_record(LADISH_FLIGHTREC_DBUS_METHOD, name[0], name[1], name[2]);
+}
+
+/* snprintf() is not async-signal-safe */
+
+struct ladish_flightrec_line
+{
+  char buffer[256];
+  size_t len;
+};
+
+static void ladish_flightrec_put_str(struct ladish_flightrec_line * line_ptr, const char * str, size_t max)
+{
+  while (*str != 0 && max-- > 0 && line_ptr->len < sizeof(line_ptr->buffer) - 1)
+  {
+    line_ptr->buffer[line_ptr->len++] = *str++;
+  }
+}
+
+static void ladish_flightrec_put_uint(struct ladish_flightrec_line * line_ptr, uint64_t value, unsigned int base, unsigned int min_digits)
+{
+  char digits[24];
+  unsigned int count;
+
+  count = 0;
+  do
+  {
+    digits[count++] = "0123456789abcdef"[value % base];
+    value /= base;
+  }
+  while (value != 0 || count < min_digits);
+
+  while (count > 0 && line_ptr->len < sizeof(line_ptr->buffer) - 1)
+  {
+    line_ptr->buffer[line_ptr->len++] = digits[--count];
+  }
+}
+
+static void ladish_flightrec_put_arg(struct ladish_flightrec_line * line_ptr, const char * name, uint64_t value)
+{
+  ladish_flightrec_put_str(line_ptr, name, SIZE_MAX);
+  ladish_flightrec_put_str(line_ptr, "0x", SIZE_MAX);
+  ladish_flightrec_put_uint(line_ptr, value, 16, 1);
+}
+
+static void ladish_flightrec_put_time(struct ladish_flightrec_line * line_ptr, uint64_t timestamp)
+{
+  ladish_flightrec_put_uint(line_ptr, timestamp / 1000000000, 10, 1);
+  ladish_flightrec_put_str(line_ptr, ".", SIZE_MAX);
+  ladish_flightrec_put_uint(line_ptr, timestamp % 1000000000 / 1000, 10, 6);
+}
+
+static bool ladish_flightrec_write_line(int fd, struct ladish_flightrec_line * line_ptr)
+{
+  ssize_t ret;
+  size_t offset;
+
+  line_ptr->buffer[line_ptr->len++] = '\n';
+
+  offset = 0;
+  while (offset < line_ptr->len)
+  {
+    ret = write(fd, line_ptr->buffer + offset, line_ptr->len - offset);
+    if (ret < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+
+      return false;
+    }
+
+    offset += ret;
+  }
+
+  line_ptr->len = 0;
+  return true;
+}
+
+const char * ladish_flightrec_dump(void)
+{
+  int fd;
+  uint64_t next;
+  uint64_t index;
+  struct ladish_flightrec_entry * entry_ptr;
+  struct ladish_flightrec_line line;
+  const char * name;
+  bool ret;
+
+  if (g_flightrec_path[0] == 0)
+  {
+    return NULL;
+  }
+
+  fd = open(g_flightrec_path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+  if (fd == -1)
+  {
+    return NULL;
+  }
+
+  next = __atomic_load_n(&g_flightrec_next, __ATOMIC_RELAXED);
+
+  line.len = 0;
+  ladish_flightrec_put_str(&line, "flight recorder, now ", SIZE_MAX);
+  ladish_flightrec_put_time(&line, ladish_flightrec_now());
+  ladish_flightrec_put_str(&line, ", ", SIZE_MAX);
+  ladish_flightrec_put_uint(&line, next, 10, 1);
+  ladish_flightrec_put_str(&line, " events recorded", SIZE_MAX);
+  ret = ladish_flightrec_write_line(fd, &line);
+
+  index = next > LADISH_FLIGHTREC_SIZE ? next - LADISH_FLIGHTREC_SIZE : 0;
+  for (; ret && index < next; index++)
+  {
+    entry_ptr = g_flightrec + (index & (LADISH_FLIGHTREC_SIZE - 1));
+
+    ladish_flightrec_put_time(&line, entry_ptr->timestamp);
+    ladish_flightrec_put_str(&line, " ", SIZE_MAX);
+
+    name = entry_ptr->event < LADISH_FLIGHTREC_EVENT_MAX ? g_flightrec_event_names[entry_ptr->event] : NULL;
+    if (name == NULL)
+    {
+      ladish_flightrec_put_str(&line, "event ", SIZE_MAX);
+      ladish_flightrec_put_uint(&line, entry_ptr->event, 10, 1);
+    }
+    else
+    {
+      ladish_flightrec_put_str(&line, name, SIZE_MAX);
+    }
+
+    if (entry_ptr->event == LADISH_FLIGHTREC_DBUS_METHOD)
+    {
+      ladish_flightrec_put_str(&line, " ", SIZE_MAX);
+      ladish_flightrec_put_str(&line, (const char *)&entry_ptr->a, sizeof(uint64_t));
+      ladish_flightrec_put_str(&line, (const char *)&entry_ptr->b, sizeof(uint64_t));
+      ladish_flightrec_put_str(&line, (const char *)&entry_ptr->c, sizeof(uint64_t));
+    }
+    else
+    {
+      ladish_flightrec_put_arg(&line, " a=", entry_ptr->a);
+      ladish_flightrec_put_arg(&line, " b=", entry_ptr->b);
+      ladish_flightrec_put_arg(&line, " c=", entry_ptr->c);
+    }
+
+    ret = ladish_flightrec_write_line(fd, &line);
+  }
+
+  close(fd);
+
+  return ret ? g_flightrec_path : NULL;
+}
@@ -0,0 +1,82 @@
+/* -*- Mode: C ; c-basic-offset: 2 -*- */
+/*
+ * LADI Session Handler (ladish)
+ *
+ * Copyright (C) 2026 ladish authors, see the AUTHORS file
+ *
+ **************************************************************************
+ * This file contains interface of the flight recorder
+ **************************************************************************
+ *
+ * LADI Session Handler is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * LADI Session Handler is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LADI Session Handler. If not, see <http://www.gnu.org/licenses/>
+ * or write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef FLIGHTREC_H__0134EF87_D53E_4B4D_9579_C680829D9E18__INCLUDED
+#define FLIGHTREC_H__0134EF87_D53E_4B4D_9579_C680829D9E18__INCLUDED
+
+#include "common.h"
+
+/* The flight recorder keeps the last events in a fixed size in-memory
+ * ring. It is always on and is dumped to a file when the daemon crashes.
+ * Meaning of the event arguments is documented next to the event types. */
+
+enum ladish_flightrec_event
+{
+  /* a = graph, b = client id */
+  LADISH_FLIGHTREC_GRAPH_CLIENT_ADDED = 1,
+  LADISH_FLIGHTREC_GRAPH_CLIENT_REMOVED,
+  LADISH_FLIGHTREC_GRAPH_CLIENT_RENAMED,
+  /* a = graph, b = client id, c = port id */
+  LADISH_FLIGHTREC_GRAPH_PORT_ADDED,
+  LADISH_FLIGHTREC_GRAPH_PORT_REMOVED,
+  LADISH_FLIGHTREC_GRAPH_PORT_RENAMED,
+  /* a = graph, b = connection id, c = port1 id << 32 | port2 id */
+  LADISH_FLIGHTREC_GRAPH_CONNECTION_ADDED,
+  LADISH_FLIGHTREC_GRAPH_CONNECTION_REMOVED,
+
+  /* a = JACK client id */
+  LADISH_FLIGHTREC_JACK_CLIENT_APPEARED,
+  LADISH_FLIGHTREC_JACK_CLIENT_DISAPPEARED,
+  /* a = JACK client id, b = JACK port id */
+  LADISH_FLIGHTREC_JACK_PORT_APPEARED,
+  LADISH_FLIGHTREC_JACK_PORT_DISAPPEARED,
+  /* a = JACK port1 id, b = JACK port2 id */
+  LADISH_FLIGHTREC_JACK_PORTS_CONNECTED,
+  LADISH_FLIGHTREC_JACK_PORTS_DISCONNECTED,
+
+  /* a = command, b = run function, c = command state */
+  LADISH_FLIGHTREC_CMD_RUN,
+  LADISH_FLIGHTREC_CMD_FAILED,
+  LADISH_FLIGHTREC_CMD_DONE,
+  LADISH_FLIGHTREC_CMD_CLEARED,
+
+  /* a, b, c = first 24 chars of method name */
+  LADISH_FLIGHTREC_DBUS_METHOD,
+
+  LADISH_FLIGHTREC_EVENT_MAX
+};
+
+void ladish_flightrec_init(const char * dump_path);
+void ladish_flightrec_record(enum ladish_flightrec_event event, uint64_t a, uint64_t b, uint64_t c);
+
+/* D-Bus method call hook, records the method name */
+void ladish_flightrec_dbus_method(const char * iface, const char * method);
+
+/* Write the ring to the dump file. Async-signal-safe,
+ * returns the dump file path or NULL on failure. */
+const char * ladish_flightrec_dump(void);
+
+#endif /* #ifndef FLIGHTREC_H__0134EF87_D53E_4B4D_9579_C680829D9E18__INCLUDED */
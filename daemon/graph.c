@@ -29,13 +29,26 @@
 #include "graph.h"
 #include "../dbus_constants.h"
 #include "virtualizer.h"
+#include "../common/hash.h"
+#include "../common/slab.h"
+#include "../common/intern.h"
+#include "flightrec.h"
 
 struct ladish_graph_port
 {
   struct list_head siblings_client;
   struct list_head siblings_graph;
+  struct ladish_hash_node id_node;              /* link for the graph::ports_by_id hash */
+  struct ladish_hash_node handle_node;          /* link for the graph::ports_by_handle hash */
+  struct ladish_hash_node name_node;            /* link for the graph::ports_by_name hash, keyed by client and interned port name */
+  struct ladish_hash_node jack_id_node;         /* link for the graph::ports_by_jack_id hash, not hashed when jack id is 0 */
+  struct ladish_hash_node jack_id_room_node;    /* link for the graph::ports_by_jack_id_room hash, only link ports */
+  struct ladish_hash_node uuid_node;            /* link for the graph::ports_by_uuid hash */
+  struct ladish_hash_node link_uuid_node;       /* link for the graph::ports_by_link_uuid hash, only link ports */
+  struct list_head port1_connections;           /* connections where this port is port1 */
+  struct list_head port2_connections;           /* connections where this port is port2 */
   struct ladish_graph_client * client_ptr;
-  char * name;
+  const char * name;                            /* interned */
   uint32_t type;
   uint32_t flags;
   uint64_t id;
@@ -48,7 +61,11 @@ struct ladish_graph_port
 struct ladish_graph_client
 {
   struct list_head siblings;
-  char * name;
+  struct ladish_hash_node id_node;              /* link for the graph::clients_by_id hash */
+  struct ladish_hash_node handle_node;          /* link for the graph::clients_by_handle hash */
+  struct ladish_hash_node name_node;            /* link for the graph::clients_by_name hash, keyed by interned name */
+  struct ladish_hash_node jack_id_node;         /* link for the graph::clients_by_jack_id hash, not hashed when jack id is 0 */
+  const char * name;                            /* interned */
   uint64_t id;
   ladish_client_handle client;
   struct list_head ports;
@@ -58,6 +75,10 @@ struct ladish_graph_client
 struct ladish_graph_connection
 {
   struct list_head siblings;
+  struct ladish_hash_node id_node;              /* link for the graph::connections_by_id hash */
+  struct ladish_hash_node ports_node;           /* link for the graph::connections_by_ports hash */
+  struct list_head siblings_port1;              /* link for the port1::port1_connections list */
+  struct list_head siblings_port2;              /* link for the port2::port2_connections list */
   uint64_t id;
   bool hidden;
   struct ladish_graph_port * port1_ptr;
@@ -66,14 +87,80 @@ struct ladish_graph_connection
   bool changing;
 };
 
+/* Number of graph objects in one slab chunk */
+#define LADISH_GRAPH_SLAB_CHUNK_OBJECTS 64
+
+/* Number of changes remembered by graphs that are published on D-Bus */
+#define LADISH_GRAPH_JOURNAL_SIZE 1024
+
+/* A visible graph change, as announced by the patchbay signals.
+ * For renames, the old name is in the "1" name field and
+ * the new one is in the "2" name field. */
+struct ladish_graph_change
+{
+  uint64_t version;
+  uint32_t type;                /* one of GRAPH_CHANGE_XXX */
+  uint64_t client1_id;
+  const char * client1_name;    /* interned */
+  uint64_t port1_id;
+  const char * port1_name;      /* interned */
+  uint64_t client2_id;
+  const char * client2_name;    /* interned */
+  uint64_t port2_id;
+  const char * port2_name;      /* interned */
+  uint64_t connection_id;
+  uint32_t port_flags;
+  uint32_t port_type;
+};
+
 struct ladish_graph
 {
+  struct list_head siblings;                    /* link for the g_graphs list */
   char * opath;
   ladish_dict_handle dict;
   struct list_head clients;
   struct list_head ports;
   struct list_head connections;
+
+  /* graph objects are allocated from these */
+  struct ladish_slab client_slab;
+  struct ladish_slab port_slab;
+  struct ladish_slab connection_slab;
+
+  /* Lookup indexes, maintained alongside the lists above.
+   * When several objects match a key, the one with the lowest id,
+   * i.e. the first one in the list, is returned */
+  struct ladish_hash clients_by_id;
+  struct ladish_hash clients_by_handle;
+  struct ladish_hash clients_by_name;
+  struct ladish_hash clients_by_jack_id;
+  struct ladish_hash ports_by_id;
+  struct ladish_hash ports_by_handle;
+  struct ladish_hash ports_by_name;
+  struct ladish_hash ports_by_jack_id;
+  struct ladish_hash ports_by_jack_id_room;
+  struct ladish_hash ports_by_uuid;
+  struct ladish_hash ports_by_link_uuid;          /* keyed by link_uuid_override */
+  struct ladish_hash connections_by_id;
+  struct ladish_hash connections_by_ports;
+
+  /* Ring of the last visible changes, NULL for graphs without opath.
+   * All visible changes newer than journal_base_version are in the journal. */
+  struct ladish_graph_change * journal;
+  unsigned int journal_head;    /* index of the oldest entry */
+  unsigned int journal_count;
+  uint64_t journal_base_version;
+  unsigned int journal_unflushed; /* number of newest entries not sent with GraphChangesBatch yet */
+  uint64_t flushed_version;       /* graph version at the time of the last GraphChangesBatch */
+  uint64_t served_version;        /* newest graph version reported by GetGraph or GetGraphDelta */
+  unsigned int batch_subscribers; /* GraphChangesBatch is emitted only when nonzero */
+
+  /* Last full GetGraph reply, valid while graph_version is get_graph_reply_version */
+  DBusMessage * get_graph_reply;
+  uint64_t get_graph_reply_version;
+
   uint64_t graph_version;
+  uint64_t modified;            /* modification clock value of the last structural change */
   uint64_t next_client_id;
   uint64_t next_port_id;
   uint64_t next_connection_id;
@@ -82,12 +169,485 @@ struct ladish_graph
   void * context;
   ladish_graph_connect_request_handler connect_handler;
   ladish_graph_disconnect_request_handler disconnect_handler;
+  ladish_graph_connect_batch_request_handler connect_batch_handler;
+  ladish_graph_disconnect_batch_request_handler disconnect_batch_handler;
 };
 
+/* All graphs, used to keep the jack id indexes in sync when jack id of client or port changes */
+static LIST_HEAD(g_graphs);
+
+/* D-Bus client that asked for the GraphChangesBatch signal of a graph.
+ * Subscriptions of clients that disconnect are dropped. */
+struct ladish_graph_batch_subscription
+{
+  struct list_head siblings;    /* link for the g_batch_subscriptions list */
+  struct ladish_graph * graph;
+  const char * sender;          /* interned unique bus name */
+};
+
+static LIST_HEAD(g_batch_subscriptions);
+
+/* names are interned, so they are hashed and compared by pointer */
+static inline uint32_t ladish_graph_port_name_hash(struct ladish_graph_client * client_ptr, const char * name)
+{
+  return ladish_hash_combine(ladish_hash_ptr(client_ptr), ladish_hash_ptr(name));
+}
+
+/* order independent, connection between port A and port B is the same as between port B and port A */
+static inline uint32_t ladish_graph_connection_ports_hash(struct ladish_graph_port * port1_ptr, struct ladish_graph_port * port2_ptr)
+{
+  if ((uintptr_t)port1_ptr > (uintptr_t)port2_ptr)
+  {
+    return ladish_hash_combine(ladish_hash_ptr(port2_ptr), ladish_hash_ptr(port1_ptr));
+  }
+
+  return ladish_hash_combine(ladish_hash_ptr(port1_ptr), ladish_hash_ptr(port2_ptr));
+}
+
+static void ladish_graph_index_client_jack_id(struct ladish_graph * graph_ptr, struct ladish_graph_client * client_ptr)
+{
+  uint64_t jack_id;
+
+  jack_id = ladish_client_get_jack_id(client_ptr->client);
+  if (jack_id != 0)
+  {
+    ladish_hash_rehash(&graph_ptr->clients_by_jack_id, &client_ptr->jack_id_node, ladish_hash_u64(jack_id));
+  }
+  else
+  {
+    ladish_hash_del(&graph_ptr->clients_by_jack_id, &client_ptr->jack_id_node);
+  }
+}
+
+static void ladish_graph_index_port_jack_ids(struct ladish_graph * graph_ptr, struct ladish_graph_port * port_ptr)
+{
+  uint64_t jack_id;
+
+  jack_id = ladish_port_get_jack_id(port_ptr->port);
+  if (jack_id != 0)
+  {
+    ladish_hash_rehash(&graph_ptr->ports_by_jack_id, &port_ptr->jack_id_node, ladish_hash_u64(jack_id));
+  }
+  else
+  {
+    ladish_hash_del(&graph_ptr->ports_by_jack_id, &port_ptr->jack_id_node);
+  }
+
+  if (!port_ptr->link)
+  {
+    return;
+  }
+
+  jack_id = ladish_port_get_jack_id_room(port_ptr->port);
+  if (jack_id != 0)
+  {
+    ladish_hash_rehash(&graph_ptr->ports_by_jack_id_room, &port_ptr->jack_id_room_node, ladish_hash_u64(jack_id));
+  }
+  else
+  {
+    ladish_hash_del(&graph_ptr->ports_by_jack_id_room, &port_ptr->jack_id_room_node);
+  }
+}
+
+static void ladish_graph_index_client(struct ladish_graph * graph_ptr, struct ladish_graph_client * client_ptr)
+{
+  ladish_hash_add(&graph_ptr->clients_by_id, &client_ptr->id_node, ladish_hash_u64(client_ptr->id));
+  ladish_hash_add(&graph_ptr->clients_by_handle, &client_ptr->handle_node, ladish_hash_ptr(client_ptr->client));
+  ladish_hash_add(&graph_ptr->clients_by_name, &client_ptr->name_node, ladish_hash_ptr(client_ptr->name));
+  ladish_hash_node_init(&client_ptr->jack_id_node);
+  ladish_graph_index_client_jack_id(graph_ptr, client_ptr);
+}
+
+static void ladish_graph_unindex_client(struct ladish_graph * graph_ptr, struct ladish_graph_client * client_ptr)
+{
+  ladish_hash_del(&graph_ptr->clients_by_id, &client_ptr->id_node);
+  ladish_hash_del(&graph_ptr->clients_by_handle, &client_ptr->handle_node);
+  ladish_hash_del(&graph_ptr->clients_by_name, &client_ptr->name_node);
+  ladish_hash_del(&graph_ptr->clients_by_jack_id, &client_ptr->jack_id_node);
+}
+
+static inline uint32_t ladish_graph_uuid_hash(const uuid_t uuid)
+{
+  return ladish_hash_bytes(uuid, sizeof(uuid_t));
+}
+
+static void ladish_graph_index_port(struct ladish_graph * graph_ptr, struct ladish_graph_port * port_ptr)
+{
+  uuid_t uuid;
+
+  ladish_hash_add(&graph_ptr->ports_by_id, &port_ptr->id_node, ladish_hash_u64(port_ptr->id));
+  ladish_hash_add(&graph_ptr->ports_by_handle, &port_ptr->handle_node, ladish_hash_ptr(port_ptr->port));
+  ladish_hash_add(&graph_ptr->ports_by_name, &port_ptr->name_node, ladish_graph_port_name_hash(port_ptr->client_ptr, port_ptr->name));
+  ladish_hash_node_init(&port_ptr->jack_id_node);
+  ladish_hash_node_init(&port_ptr->jack_id_room_node);
+  ladish_graph_index_port_jack_ids(graph_ptr, port_ptr);
+
+  ladish_port_get_uuid(port_ptr->port, uuid);
+  ladish_hash_add(&graph_ptr->ports_by_uuid, &port_ptr->uuid_node, ladish_graph_uuid_hash(uuid));
+
+  ladish_hash_node_init(&port_ptr->link_uuid_node);
+  if (port_ptr->link)
+  {
+    ladish_hash_add(&graph_ptr->ports_by_link_uuid, &port_ptr->link_uuid_node, ladish_graph_uuid_hash(port_ptr->link_uuid_override));
+  }
+}
+
+static void ladish_graph_unindex_port(struct ladish_graph * graph_ptr, struct ladish_graph_port * port_ptr)
+{
+  ladish_hash_del(&graph_ptr->ports_by_id, &port_ptr->id_node);
+  ladish_hash_del(&graph_ptr->ports_by_handle, &port_ptr->handle_node);
+  ladish_hash_del(&graph_ptr->ports_by_name, &port_ptr->name_node);
+  ladish_hash_del(&graph_ptr->ports_by_jack_id, &port_ptr->jack_id_node);
+  ladish_hash_del(&graph_ptr->ports_by_jack_id_room, &port_ptr->jack_id_room_node);
+  ladish_hash_del(&graph_ptr->ports_by_uuid, &port_ptr->uuid_node);
+  ladish_hash_del(&graph_ptr->ports_by_link_uuid, &port_ptr->link_uuid_node);
+}
+
+static bool ladish_graph_init_indexes(struct ladish_graph * graph_ptr)
+{
+  struct ladish_hash * hashes[] =
+    {
+      &graph_ptr->clients_by_id,
+      &graph_ptr->clients_by_handle,
+      &graph_ptr->clients_by_name,
+      &graph_ptr->clients_by_jack_id,
+      &graph_ptr->ports_by_id,
+      &graph_ptr->ports_by_handle,
+      &graph_ptr->ports_by_name,
+      &graph_ptr->ports_by_jack_id,
+      &graph_ptr->ports_by_jack_id_room,
+      &graph_ptr->ports_by_uuid,
+      &graph_ptr->ports_by_link_uuid,
+      &graph_ptr->connections_by_id,
+      &graph_ptr->connections_by_ports,
+    };
+  size_t i;
+
+  for (i = 0; i < sizeof(hashes) / sizeof(hashes[0]); i++)
+  {
+    if (!ladish_hash_init(hashes[i]))
+    {
+      while (i > 0)
+      {
+        ladish_hash_uninit(hashes[--i]);
+      }
+
+      return false;
+    }
+  }
+
+  return true;
+}
+
+static void ladish_graph_uninit_indexes(struct ladish_graph * graph_ptr)
+{
+  ladish_hash_uninit(&graph_ptr->clients_by_id);
+  ladish_hash_uninit(&graph_ptr->clients_by_handle);
+  ladish_hash_uninit(&graph_ptr->clients_by_name);
+  ladish_hash_uninit(&graph_ptr->clients_by_jack_id);
+  ladish_hash_uninit(&graph_ptr->ports_by_id);
+  ladish_hash_uninit(&graph_ptr->ports_by_handle);
+  ladish_hash_uninit(&graph_ptr->ports_by_name);
+  ladish_hash_uninit(&graph_ptr->ports_by_jack_id);
+  ladish_hash_uninit(&graph_ptr->ports_by_jack_id_room);
+  ladish_hash_uninit(&graph_ptr->ports_by_uuid);
+  ladish_hash_uninit(&graph_ptr->ports_by_link_uuid);
+  ladish_hash_uninit(&graph_ptr->connections_by_id);
+  ladish_hash_uninit(&graph_ptr->connections_by_ports);
+}
+
+static void ladish_graph_drop_get_graph_reply(struct ladish_graph * graph_ptr)
+{
+  if (graph_ptr->get_graph_reply != NULL)
+  {
+    dbus_message_unref(graph_ptr->get_graph_reply);
+    graph_ptr->get_graph_reply = NULL;
+  }
+}
+
+/* Must be called for every change visible in GetGraph, before it is signalled */
+static inline void ladish_graph_changed(struct ladish_graph * graph_ptr)
+{
+  graph_ptr->graph_version++;
+  graph_ptr->modified = ladish_modified_now();
+  ladish_graph_drop_get_graph_reply(graph_ptr);
+}
+
+static void ladish_graph_change_release_names(struct ladish_graph_change * change_ptr)
+{
+  ladish_intern_release(change_ptr->client1_name);
+  ladish_intern_release(change_ptr->port1_name);
+  ladish_intern_release(change_ptr->client2_name);
+  ladish_intern_release(change_ptr->port2_name);
+}
+
+static void ladish_graph_journal_reset(struct ladish_graph * graph_ptr)
+{
+  unsigned int i;
+
+  for (i = 0; i < graph_ptr->journal_count; i++)
+  {
+    ladish_graph_change_release_names(graph_ptr->journal + (graph_ptr->journal_head + i) % LADISH_GRAPH_JOURNAL_SIZE);
+  }
+
+  graph_ptr->journal_head = 0;
+  graph_ptr->journal_count = 0;
+  graph_ptr->journal_unflushed = 0;
+  graph_ptr->journal_base_version = graph_ptr->graph_version;
+}
+
+static const char * ladish_graph_change_ref_name(const char * name)
+{
+  return name != NULL ? ladish_intern_ref(name) : NULL;
+}
+
+static bool ladish_graph_append_change(DBusMessageIter * array_iter_ptr, const struct ladish_graph_change * change_ptr)
+{
+  DBusMessageIter struct_iter;
+  const char * client1_name;
+  const char * port1_name;
+  const char * client2_name;
+  const char * port2_name;
+
+  client1_name = change_ptr->client1_name != NULL ? change_ptr->client1_name : "";
+  port1_name = change_ptr->port1_name != NULL ? change_ptr->port1_name : "";
+  client2_name = change_ptr->client2_name != NULL ? change_ptr->client2_name : "";
+  port2_name = change_ptr->port2_name != NULL ? change_ptr->port2_name : "";
+
+  if (!dbus_message_iter_open_container(array_iter_ptr, DBUS_TYPE_STRUCT, NULL, &struct_iter))
+  {
+    return false;
+  }
+
+  if (!dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_UINT64, &change_ptr->version) ||
+      !dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_UINT32, &change_ptr->type) ||
+      !dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_UINT64, &change_ptr->client1_id) ||
+      !dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_STRING, &client1_name) ||
+      !dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_UINT64, &change_ptr->port1_id) ||
+      !dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_STRING, &port1_name) ||
+      !dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_UINT64, &change_ptr->client2_id) ||
+      !dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_STRING, &client2_name) ||
+      !dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_UINT64, &change_ptr->port2_id) ||
+      !dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_STRING, &port2_name) ||
+      !dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_UINT64, &change_ptr->connection_id) ||
+      !dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_UINT32, &change_ptr->port_flags) ||
+      !dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_UINT32, &change_ptr->port_type))
+  {
+    dbus_message_iter_close_container(array_iter_ptr, &struct_iter);
+    return false;
+  }
+
+  return dbus_message_iter_close_container(array_iter_ptr, &struct_iter);
+}
+
+/* Emit the changes recorded since the previous flush as single signal */
+static void ladish_graph_emit_changes_batch(struct ladish_graph * graph_ptr)
+{
+  DBusMessage * message_ptr;
+  DBusMessageIter iter;
+  DBusMessageIter changes_array_iter;
+  unsigned int i;
+  struct ladish_graph_change * change_ptr;
+  dbus_uint64_t new_version;
+
+  ASSERT(graph_ptr->opath != NULL);
+  ASSERT(graph_ptr->journal_unflushed <= graph_ptr->journal_count);
+
+  new_version = graph_ptr->graph_version;
+
+  if (graph_ptr->batch_subscribers == 0)
+  {
+    /* nobody listens, the per change signals are always emitted */
+    goto exit;
+  }
+
+  message_ptr = dbus_message_new_signal(graph_ptr->opath, JACKDBUS_IFACE_PATCHBAY, "GraphChangesBatch");
+  if (message_ptr == NULL)
+  {
+    log_error("dbus_message_new_signal() failed.");
+    goto exit;
+  }
+
+  dbus_message_iter_init_append(message_ptr, &iter);
+
+  if (!dbus_message_iter_append_basic(&iter, DBUS_TYPE_UINT64, &graph_ptr->flushed_version) ||
+      !dbus_message_iter_append_basic(&iter, DBUS_TYPE_UINT64, &new_version) ||
+      !dbus_message_iter_open_container(&iter, DBUS_TYPE_ARRAY, "(tutststststuu)", &changes_array_iter))
+  {
+    goto nomem;
+  }
+
+  for (i = graph_ptr->journal_count - graph_ptr->journal_unflushed; i < graph_ptr->journal_count; i++)
+  {
+    change_ptr = graph_ptr->journal + (graph_ptr->journal_head + i) % LADISH_GRAPH_JOURNAL_SIZE;
+    if (!ladish_graph_append_change(&changes_array_iter, change_ptr))
+    {
+      dbus_message_iter_close_container(&iter, &changes_array_iter);
+      goto nomem;
+    }
+  }
+
+  if (!dbus_message_iter_close_container(&iter, &changes_array_iter))
+  {
+    goto nomem;
+  }
+
+  cdbus_signal_send(cdbus_g_dbus_connection, message_ptr);
+  goto unref;
+
+nomem:
+  log_error("Ran out of memory trying to construct GraphChangesBatch signal");
+unref:
+  dbus_message_unref(message_ptr);
+exit:
+  graph_ptr->journal_unflushed = 0;
+  graph_ptr->flushed_version = new_version;
+}
+
+static
+void
+ladish_graph_journal_record(
+  struct ladish_graph * graph_ptr,
+  const struct ladish_graph_change * change_ptr)
+{
+  struct ladish_graph_change * entry_ptr;
+
+  if (graph_ptr->journal == NULL)
+  {
+    return;
+  }
+
+  /* GetGraphDelta skips changes not newer than the version the client knows,
+   * so a change stamped with an already reported version would be lost */
+  ASSERT(change_ptr->version > graph_ptr->served_version);
+
+  if (graph_ptr->journal_count == LADISH_GRAPH_JOURNAL_SIZE)
+  {
+    if (graph_ptr->journal_unflushed == LADISH_GRAPH_JOURNAL_SIZE)
+    {
+      /* the oldest change was not signalled yet */
+      ladish_graph_emit_changes_batch(graph_ptr);
+    }
+
+    /* drop the oldest change */
+    entry_ptr = graph_ptr->journal + graph_ptr->journal_head;
+    graph_ptr->journal_base_version = entry_ptr->version;
+    ladish_graph_change_release_names(entry_ptr);
+    graph_ptr->journal_head = (graph_ptr->journal_head + 1) % LADISH_GRAPH_JOURNAL_SIZE;
+    graph_ptr->journal_count--;
+  }
+
+  entry_ptr = graph_ptr->journal + (graph_ptr->journal_head + graph_ptr->journal_count) % LADISH_GRAPH_JOURNAL_SIZE;
+  *entry_ptr = *change_ptr;
+  entry_ptr->client1_name = ladish_graph_change_ref_name(change_ptr->client1_name);
+  entry_ptr->port1_name = ladish_graph_change_ref_name(change_ptr->port1_name);
+  entry_ptr->client2_name = ladish_graph_change_ref_name(change_ptr->client2_name);
+  entry_ptr->port2_name = ladish_graph_change_ref_name(change_ptr->port2_name);
+
+  graph_ptr->journal_count++;
+  graph_ptr->journal_unflushed++;
+}
+
+static
+void
+ladish_graph_change_init_client(
+  struct ladish_graph_change * change_ptr,
+  uint64_t version,
+  uint32_t type,
+  struct ladish_graph_client * client_ptr)
+{
+  memset(change_ptr, 0, sizeof(struct ladish_graph_change));
+  change_ptr->version = version;
+  change_ptr->type = type;
+  change_ptr->client1_id = client_ptr->id;
+  change_ptr->client1_name = client_ptr->name;
+}
+
+static
+void
+ladish_graph_change_init_port(
+  struct ladish_graph_change * change_ptr,
+  uint64_t version,
+  uint32_t type,
+  struct ladish_graph_port * port_ptr)
+{
+  memset(change_ptr, 0, sizeof(struct ladish_graph_change));
+  change_ptr->version = version;
+  change_ptr->type = type;
+  change_ptr->client1_id = port_ptr->client_ptr->id;
+  change_ptr->client1_name = port_ptr->client_ptr->name;
+  change_ptr->port1_id = port_ptr->id;
+  change_ptr->port1_name = port_ptr->name;
+  change_ptr->port_flags = port_ptr->flags;
+  change_ptr->port_type = port_ptr->type;
+}
+
+static
+void
+ladish_graph_change_init_connection(
+  struct ladish_graph_change * change_ptr,
+  uint64_t version,
+  uint32_t type,
+  struct ladish_graph_connection * connection_ptr)
+{
+  memset(change_ptr, 0, sizeof(struct ladish_graph_change));
+  change_ptr->version = version;
+  change_ptr->type = type;
+  change_ptr->client1_id = connection_ptr->port1_ptr->client_ptr->id;
+  change_ptr->client1_name = connection_ptr->port1_ptr->client_ptr->name;
+  change_ptr->port1_id = connection_ptr->port1_ptr->id;
+  change_ptr->port1_name = connection_ptr->port1_ptr->name;
+  change_ptr->client2_id = connection_ptr->port2_ptr->client_ptr->id;
+  change_ptr->client2_name = connection_ptr->port2_ptr->client_ptr->name;
+  change_ptr->port2_id = connection_ptr->port2_ptr->id;
+  change_ptr->port2_name = connection_ptr->port2_ptr->name;
+  change_ptr->connection_id = connection_ptr->id;
+}
+
+static
+void
+ladish_graph_flightrec_connection(
+  enum ladish_flightrec_event event,
+  struct ladish_graph * graph_ptr,
+  struct ladish_graph_connection * connection_ptr)
+{
+  ladish_flightrec_record(
+    event,
+    (uintptr_t)graph_ptr,
+    connection_ptr->id,
+    connection_ptr->port1_ptr->id << 32 | (connection_ptr->port2_ptr->id & 0xFFFFFFFF));
+}
+
+static void ladish_graph_journal_client(struct ladish_graph * graph_ptr, uint32_t type, struct ladish_graph_client * client_ptr)
+{
+  struct ladish_graph_change change;
+
+  ladish_graph_change_init_client(&change, graph_ptr->graph_version, type, client_ptr);
+  ladish_graph_journal_record(graph_ptr, &change);
+}
+
+static void ladish_graph_journal_port(struct ladish_graph * graph_ptr, uint32_t type, struct ladish_graph_port * port_ptr)
+{
+  struct ladish_graph_change change;
+
+  ladish_graph_change_init_port(&change, graph_ptr->graph_version, type, port_ptr);
+  ladish_graph_journal_record(graph_ptr, &change);
+}
+
+static void ladish_graph_journal_connection(struct ladish_graph * graph_ptr, uint32_t type, struct ladish_graph_connection * connection_ptr)
+{
+  struct ladish_graph_change change;
+
+  ladish_graph_change_init_connection(&change, graph_ptr->graph_version, type, connection_ptr);
+  ladish_graph_journal_record(graph_ptr, &change);
+}
+
 static void ladish_graph_emit_ports_disconnected(struct ladish_graph * graph_ptr, struct ladish_graph_connection * connection_ptr)
 {
   ASSERT(graph_ptr->opath != NULL);
 
+  ladish_graph_journal_connection(graph_ptr, GRAPH_CHANGE_PORTS_DISCONNECTED, connection_ptr);
+
   cdbus_signal_emit(
     cdbus_g_dbus_connection,
     graph_ptr->opath,
@@ -110,6 +670,8 @@ static void ladish_graph_emit_ports_connected(struct ladish_graph * graph_ptr, s
 {
   ASSERT(graph_ptr->opath != NULL);
 
+  ladish_graph_journal_connection(graph_ptr, GRAPH_CHANGE_PORTS_CONNECTED, connection_ptr);
+
   cdbus_signal_emit(
     cdbus_g_dbus_connection,
     graph_ptr->opath,
@@ -132,6 +694,8 @@ static void ladish_graph_emit_client_appeared(struct ladish_graph * graph_ptr, s
 {
   ASSERT(graph_ptr->opath != NULL);
 
+  ladish_graph_journal_client(graph_ptr, GRAPH_CHANGE_CLIENT_APPEARED, client_ptr);
+
   cdbus_signal_emit(
     cdbus_g_dbus_connection,
     graph_ptr->opath,
@@ -147,6 +711,8 @@ static void ladish_graph_emit_client_disappeared(struct ladish_graph * graph_ptr
 {
   ASSERT(graph_ptr->opath != NULL);
 
+  ladish_graph_journal_client(graph_ptr, GRAPH_CHANGE_CLIENT_DISAPPEARED, client_ptr);
+
   cdbus_signal_emit(
     cdbus_g_dbus_connection,
     graph_ptr->opath,
@@ -162,6 +728,8 @@ static void ladish_graph_emit_port_appeared(struct ladish_graph * graph_ptr, str
 {
   ASSERT(graph_ptr->opath != NULL);
 
+  ladish_graph_journal_port(graph_ptr, GRAPH_CHANGE_PORT_APPEARED, port_ptr);
+
   cdbus_signal_emit(
     cdbus_g_dbus_connection,
     graph_ptr->opath,
@@ -181,6 +749,8 @@ static void ladish_graph_emit_port_disappeared(struct ladish_graph * graph_ptr,
 {
   ASSERT(graph_ptr->opath != NULL);
 
+  ladish_graph_journal_port(graph_ptr, GRAPH_CHANGE_PORT_DISAPPEARED, port_ptr);
+
   cdbus_signal_emit(
     cdbus_g_dbus_connection,
     graph_ptr->opath,
@@ -302,12 +872,13 @@ ladish_graph_find_connection_ports_by_name(
 
 static struct ladish_graph_port * ladish_graph_find_port_by_id_internal(struct ladish_graph * graph_ptr, uint64_t port_id)
 {
-  struct list_head * node_ptr;
+  struct hlist_node * node_ptr;
   struct ladish_graph_port * port_ptr;
+  uint32_t hash;
 
-  list_for_each(node_ptr, &graph_ptr->ports)
+  hash = ladish_hash_u64(port_id);
+  ladish_hash_for_each_possible(port_ptr, node_ptr, &graph_ptr->ports_by_id, id_node, hash)
   {
-    port_ptr = list_entry(node_ptr, struct ladish_graph_port, siblings_graph);
     if (port_ptr->id == port_id)
     {
       return port_ptr;
@@ -319,6 +890,27 @@ static struct ladish_graph_port * ladish_graph_find_port_by_id_internal(struct l
 
 //#define LOG_PORT_LOOKUP
 
+static
+bool
+ladish_graph_port_matches_uuid_filters(
+  struct ladish_graph_port * port_ptr,
+  struct ladish_graph_client * client_ptr,
+  void * vgraph_filter)
+{
+  if (client_ptr != NULL && port_ptr->client_ptr != client_ptr)
+  {
+    return false;
+  }
+
+  if (vgraph_filter != NULL && ladish_port_get_vgraph(port_ptr->port) != vgraph_filter)
+  {
+    return false;
+  }
+
+  return true;
+}
+
+/* When several ports match, the one with lowest id (the first one in the ports list) is returned */
 static struct ladish_graph_port *
 ladish_graph_find_port_by_uuid_internal(
   struct ladish_graph * graph_ptr,
@@ -327,72 +919,68 @@ ladish_graph_find_port_by_uuid_internal(
   bool use_link_override_uuids,
   void * vgraph_filter)
 {
-  struct list_head * node_ptr;
+  struct hlist_node * node_ptr;
   struct ladish_graph_port * port_ptr;
+  struct ladish_graph_port * found_port_ptr;
   uuid_t current_uuid;
+  uint32_t hash;
 #if defined(LOG_PORT_LOOKUP)
-  char uuid1_str[37];
-  char uuid2_str[37];
+  char uuid_str[37];
 
-  log_info("searching by uuid for port in graph %s", ladish_graph_get_description((ladish_graph_handle)graph_ptr));
-  uuid_unparse(uuid, uuid1_str);
+  uuid_unparse(uuid, uuid_str);
+  log_info("searching by uuid %s for port in graph %s", uuid_str, ladish_graph_get_description((ladish_graph_handle)graph_ptr));
 #endif
 
-  list_for_each(node_ptr, &graph_ptr->ports)
-  {
-    port_ptr = list_entry(node_ptr, struct ladish_graph_port, siblings_graph);
+  found_port_ptr = NULL;
+  hash = ladish_graph_uuid_hash(uuid);
 
-    if (client_ptr != NULL && port_ptr->client_ptr != client_ptr)
+  if (use_link_override_uuids)
+  {
+    ladish_hash_for_each_possible(port_ptr, node_ptr, &graph_ptr->ports_by_link_uuid, link_uuid_node, hash)
     {
-      continue;
+      if (uuid_compare(port_ptr->link_uuid_override, uuid) == 0 &&
+          ladish_graph_port_matches_uuid_filters(port_ptr, client_ptr, vgraph_filter) &&
+          (found_port_ptr == NULL || port_ptr->id < found_port_ptr->id))
+      {
+        found_port_ptr = port_ptr;
+      }
     }
+  }
 
-    if (vgraph_filter != NULL && ladish_port_get_vgraph(port_ptr->port) != vgraph_filter)
+  ladish_hash_for_each_possible(port_ptr, node_ptr, &graph_ptr->ports_by_uuid, uuid_node, hash)
+  {
+    if (found_port_ptr != NULL && port_ptr->id > found_port_ptr->id)
     {
       continue;
     }
 
-#if defined(LOG_PORT_LOOKUP)
-    if (port_ptr->link)
+    ladish_port_get_uuid(port_ptr->port, current_uuid);
+    if (uuid_compare(current_uuid, uuid) == 0 &&
+        ladish_graph_port_matches_uuid_filters(port_ptr, client_ptr, vgraph_filter))
     {
-      uuid_unparse(port_ptr->link_uuid_override, uuid2_str);
-      log_info("comparing link uuid %s with %s", uuid2_str, uuid1_str);
-    }
-#endif
-
-    if (use_link_override_uuids && port_ptr->link && uuid_compare(port_ptr->link_uuid_override, uuid) == 0)
-    {
-#if defined(LOG_PORT_LOOKUP)
-      log_info("found link port %p of client '%s'", port_ptr->port, port_ptr->client_ptr->name);
-#endif
-      return port_ptr;
+      found_port_ptr = port_ptr;
     }
+  }
 
-    ladish_port_get_uuid(port_ptr->port, current_uuid);
 #if defined(LOG_PORT_LOOKUP)
-    uuid_unparse(current_uuid, uuid2_str);
-    log_info("comparing port uuid %s with %s", uuid2_str, uuid1_str);
-#endif
-    if (uuid_compare(current_uuid, uuid) == 0)
-    {
-#if defined(LOG_PORT_LOOKUP)
-      log_info("found port %p of client '%s'", port_ptr->port, port_ptr->client_ptr->name);
-#endif
-      return port_ptr;
-    }
+  if (found_port_ptr != NULL)
+  {
+    log_info("found port %p of client '%s'", found_port_ptr->port, found_port_ptr->client_ptr->name);
   }
+#endif
 
-  return NULL;
+  return found_port_ptr;
 }
 
 static struct ladish_graph_connection * ladish_graph_find_connection_by_id(struct ladish_graph * graph_ptr, uint64_t connection_id)
 {
-  struct list_head * node_ptr;
+  struct hlist_node * node_ptr;
   struct ladish_graph_connection * connection_ptr;
+  uint32_t hash;
 
-  list_for_each(node_ptr, &graph_ptr->connections)
+  hash = ladish_hash_u64(connection_id);
+  ladish_hash_for_each_possible(connection_ptr, node_ptr, &graph_ptr->connections_by_id, id_node, hash)
   {
-    connection_ptr = list_entry(node_ptr, struct ladish_graph_connection, siblings);
     if (connection_ptr->id == connection_id)
     {
       return connection_ptr;
@@ -409,12 +997,13 @@ ladish_graph_find_connection_by_ports(
   struct ladish_graph_port * port1_ptr,
   struct ladish_graph_port * port2_ptr)
 {
-  struct list_head * node_ptr;
+  struct hlist_node * node_ptr;
   struct ladish_graph_connection * connection_ptr;
+  uint32_t hash;
 
-  list_for_each(node_ptr, &graph_ptr->connections)
+  hash = ladish_graph_connection_ports_hash(port1_ptr, port2_ptr);
+  ladish_hash_for_each_possible(connection_ptr, node_ptr, &graph_ptr->connections_by_ports, ports_node, hash)
   {
-    connection_ptr = list_entry(node_ptr, struct ladish_graph_connection, siblings);
     if ((connection_ptr->port1_ptr == port1_ptr && connection_ptr->port2_ptr == port2_ptr) ||
         (connection_ptr->port1_ptr == port2_ptr && connection_ptr->port2_ptr == port1_ptr))
     {
@@ -425,6 +1014,167 @@ ladish_graph_find_connection_by_ports(
   return NULL;
 }
 
+/* Describe the visible part of the graph as a sequence of "appeared" changes */
+static bool ladish_graph_append_full_dump(struct ladish_graph * graph_ptr, DBusMessageIter * array_iter_ptr)
+{
+  struct list_head * client_node_ptr;
+  struct ladish_graph_client * client_ptr;
+  struct list_head * port_node_ptr;
+  struct ladish_graph_port * port_ptr;
+  struct list_head * connection_node_ptr;
+  struct ladish_graph_connection * connection_ptr;
+  struct ladish_graph_change change;
+
+  list_for_each(client_node_ptr, &graph_ptr->clients)
+  {
+    client_ptr = list_entry(client_node_ptr, struct ladish_graph_client, siblings);
+    if (client_ptr->hidden)
+    {
+      continue;
+    }
+
+    ladish_graph_change_init_client(&change, graph_ptr->graph_version, GRAPH_CHANGE_CLIENT_APPEARED, client_ptr);
+    if (!ladish_graph_append_change(array_iter_ptr, &change))
+    {
+      return false;
+    }
+
+    list_for_each(port_node_ptr, &client_ptr->ports)
+    {
+      port_ptr = list_entry(port_node_ptr, struct ladish_graph_port, siblings_client);
+      if (port_ptr->hidden)
+      {
+        continue;
+      }
+
+      ladish_graph_change_init_port(&change, graph_ptr->graph_version, GRAPH_CHANGE_PORT_APPEARED, port_ptr);
+      if (!ladish_graph_append_change(array_iter_ptr, &change))
+      {
+        return false;
+      }
+    }
+  }
+
+  list_for_each(connection_node_ptr, &graph_ptr->connections)
+  {
+    connection_ptr = list_entry(connection_node_ptr, struct ladish_graph_connection, siblings);
+    if (connection_ptr->hidden)
+    {
+      continue;
+    }
+
+    ladish_graph_change_init_connection(&change, graph_ptr->graph_version, GRAPH_CHANGE_PORTS_CONNECTED, connection_ptr);
+    if (!ladish_graph_append_change(array_iter_ptr, &change))
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+static const char * ladish_graph_compose_name_lost_match(const char * name)
+{
+  static char rule[1024];
+  snprintf(rule, sizeof(rule), "type='signal',sender='"DBUS_SERVICE_DBUS"',interface='"DBUS_INTERFACE_DBUS"',member='NameOwnerChanged',arg0='%s',arg2=''", name);
+  return rule;
+}
+
+static
+struct ladish_graph_batch_subscription *
+ladish_graph_find_batch_subscription(
+  struct ladish_graph * graph_ptr,
+  const char * sender)
+{
+  struct list_head * node_ptr;
+  struct ladish_graph_batch_subscription * subscription_ptr;
+
+  list_for_each(node_ptr, &g_batch_subscriptions)
+  {
+    subscription_ptr = list_entry(node_ptr, struct ladish_graph_batch_subscription, siblings);
+    if ((graph_ptr == NULL || subscription_ptr->graph == graph_ptr) &&
+        (sender == NULL || subscription_ptr->sender == sender))
+    {
+      return subscription_ptr;
+    }
+  }
+
+  return NULL;
+}
+
+static DBusHandlerResult ladish_graph_name_lost_filter(DBusConnection * connection, DBusMessage * message_ptr, void * data);
+
+static void ladish_graph_batch_subscription_destroy(struct ladish_graph_batch_subscription * subscription_ptr)
+{
+  list_del(&subscription_ptr->siblings);
+  subscription_ptr->graph->batch_subscribers--;
+
+  if (ladish_graph_find_batch_subscription(NULL, subscription_ptr->sender) == NULL)
+  {
+    dbus_bus_remove_match(cdbus_g_dbus_connection, ladish_graph_compose_name_lost_match(subscription_ptr->sender), NULL);
+  }
+
+  if (list_empty(&g_batch_subscriptions))
+  {
+    dbus_connection_remove_filter(cdbus_g_dbus_connection, ladish_graph_name_lost_filter, NULL);
+  }
+
+  ladish_intern_release(subscription_ptr->sender);
+  free(subscription_ptr);
+}
+
+static void ladish_graph_drop_batch_subscriptions(struct ladish_graph * graph_ptr, const char * sender)
+{
+  struct ladish_graph_batch_subscription * subscription_ptr;
+
+  /* keep the name alive until the last matching subscription is gone */
+  if (sender != NULL)
+  {
+    ladish_intern_ref(sender);
+  }
+
+  while ((subscription_ptr = ladish_graph_find_batch_subscription(graph_ptr, sender)) != NULL)
+  {
+    ladish_graph_batch_subscription_destroy(subscription_ptr);
+  }
+
+  if (sender != NULL)
+  {
+    ladish_intern_release(sender);
+  }
+}
+
+static DBusHandlerResult ladish_graph_name_lost_filter(DBusConnection * UNUSED(connection), DBusMessage * message_ptr, void * UNUSED(data))
+{
+  const char * name;
+  const char * old_owner;
+  const char * new_owner;
+  const char * sender;
+
+  if (!dbus_message_is_signal(message_ptr, DBUS_INTERFACE_DBUS, "NameOwnerChanged") ||
+      !dbus_message_get_args(
+        message_ptr,
+        NULL,
+        DBUS_TYPE_STRING, &name,
+        DBUS_TYPE_STRING, &old_owner,
+        DBUS_TYPE_STRING, &new_owner,
+        DBUS_TYPE_INVALID) ||
+      new_owner[0] != 0)
+  {
+    return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+  }
+
+  sender = ladish_intern_find(name);
+  if (sender != NULL && ladish_graph_find_batch_subscription(NULL, sender) != NULL)
+  {
+    log_info("Dropping GraphChangesBatch subscriptions of disconnected client %s", name);
+    ladish_graph_drop_batch_subscriptions(NULL, sender);
+  }
+
+  /* other filters may be interested in the signal too */
+  return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+}
+
 #define graph_ptr ((struct ladish_graph *)call_ptr->iface_context)
 
 static void get_all_ports(struct cdbus_method_call * call_ptr)
@@ -488,15 +1238,6 @@ static void get_graph(struct cdbus_method_call * call_ptr)
 
   //log_info("Getting graph, known version is %" PRIu64, known_version);
 
-  call_ptr->reply = dbus_message_new_method_return(call_ptr->message);
-  if (call_ptr->reply == NULL)
-  {
-    log_error("Ran out of memory trying to construct method return");
-    goto exit;
-  }
-
-  dbus_message_iter_init_append(call_ptr->reply, &iter);
-
   current_version = graph_ptr->graph_version;
   if (known_version > current_version)
   {
@@ -509,6 +1250,38 @@ static void get_graph(struct cdbus_method_call * call_ptr)
     goto exit;
   }
 
+  graph_ptr->served_version = current_version;
+
+  /* full replies do not depend on the known version, so reuse the last one if graph did not change since then */
+  if (known_version < current_version &&
+      graph_ptr->get_graph_reply != NULL &&
+      graph_ptr->get_graph_reply_version == current_version)
+  {
+    call_ptr->reply = dbus_message_copy(graph_ptr->get_graph_reply);
+    if (call_ptr->reply == NULL)
+    {
+      log_error("Ran out of memory trying to copy cached method return");
+      goto exit;
+    }
+
+    if (!dbus_message_set_reply_serial(call_ptr->reply, dbus_message_get_serial(call_ptr->message)) ||
+        !dbus_message_set_destination(call_ptr->reply, dbus_message_get_sender(call_ptr->message)))
+    {
+      goto nomem;
+    }
+
+    return;
+  }
+
+  call_ptr->reply = dbus_message_new_method_return(call_ptr->message);
+  if (call_ptr->reply == NULL)
+  {
+    log_error("Ran out of memory trying to construct method return");
+    goto exit;
+  }
+
+  dbus_message_iter_init_append(call_ptr->reply, &iter);
+
   if (!dbus_message_iter_append_basic(&iter, DBUS_TYPE_UINT64, &current_version))
   {
     goto nomem;
@@ -686,6 +1459,13 @@ static void get_graph(struct cdbus_method_call * call_ptr)
     goto nomem;
   }
 
+  if (known_version < current_version)
+  {
+    ladish_graph_drop_get_graph_reply(graph_ptr);
+    graph_ptr->get_graph_reply = dbus_message_copy(call_ptr->reply);
+    graph_ptr->get_graph_reply_version = current_version;
+  }
+
   return;
 
 nomem_close_connection_struct:
@@ -716,6 +1496,101 @@ exit:
   return;
 }
 
+static void get_graph_delta(struct cdbus_method_call * call_ptr)
+{
+  dbus_uint64_t known_version;
+  dbus_uint64_t current_version;
+  dbus_bool_t full_dump;
+  DBusMessageIter iter;
+  DBusMessageIter changes_array_iter;
+  unsigned int i;
+  struct ladish_graph_change * change_ptr;
+
+  if (!dbus_message_get_args(call_ptr->message, &cdbus_g_dbus_error, DBUS_TYPE_UINT64, &known_version, DBUS_TYPE_INVALID))
+  {
+    cdbus_error(call_ptr, DBUS_ERROR_INVALID_ARGS, "Invalid arguments to method \"%s\": %s",  call_ptr->method_name, cdbus_g_dbus_error.message);
+    dbus_error_free(&cdbus_g_dbus_error);
+    return;
+  }
+
+  current_version = graph_ptr->graph_version;
+  if (known_version > current_version)
+  {
+    cdbus_error(
+      call_ptr,
+      DBUS_ERROR_INVALID_ARGS,
+      "known graph version %" PRIu64 " is newer than actual version %" PRIu64,
+      known_version,
+      current_version);
+    return;
+  }
+
+  graph_ptr->served_version = current_version;
+
+  /* the journal cannot tell what happened before its base version */
+  full_dump = graph_ptr->journal == NULL || known_version < graph_ptr->journal_base_version;
+
+  call_ptr->reply = dbus_message_new_method_return(call_ptr->message);
+  if (call_ptr->reply == NULL)
+  {
+    goto fail;
+  }
+
+  dbus_message_iter_init_append(call_ptr->reply, &iter);
+
+  if (!dbus_message_iter_append_basic(&iter, DBUS_TYPE_UINT64, &current_version) ||
+      !dbus_message_iter_append_basic(&iter, DBUS_TYPE_BOOLEAN, &full_dump))
+  {
+    goto fail_unref;
+  }
+
+  if (!dbus_message_iter_open_container(&iter, DBUS_TYPE_ARRAY, "(tutststststuu)", &changes_array_iter))
+  {
+    goto fail_unref;
+  }
+
+  if (full_dump)
+  {
+    if (!ladish_graph_append_full_dump(graph_ptr, &changes_array_iter))
+    {
+      goto fail_close_array;
+    }
+  }
+  else
+  {
+    for (i = 0; i < graph_ptr->journal_count; i++)
+    {
+      change_ptr = graph_ptr->journal + (graph_ptr->journal_head + i) % LADISH_GRAPH_JOURNAL_SIZE;
+      if (change_ptr->version <= known_version)
+      {
+        continue;
+      }
+
+      if (!ladish_graph_append_change(&changes_array_iter, change_ptr))
+      {
+        goto fail_close_array;
+      }
+    }
+  }
+
+  if (!dbus_message_iter_close_container(&iter, &changes_array_iter))
+  {
+    goto fail_unref;
+  }
+
+  return;
+
+fail_close_array:
+  dbus_message_iter_close_container(&iter, &changes_array_iter);
+
+fail_unref:
+  dbus_message_unref(call_ptr->reply);
+  call_ptr->reply = NULL;
+
+fail:
+  log_error("Ran out of memory trying to construct method return");
+}
+
 static void connect_ports_by_name(struct cdbus_method_call * call_ptr)
 {
   const char * client1_name;
@@ -939,10 +1814,322 @@ static void disconnect_ports_by_connection_id(struct cdbus_method_call * call_pt
   disconnect_ports(call_ptr, connection_ptr);
 }
 
+/* Parse the a(tt) argument of the batch methods. On success, *port_ids_ptr has to be freed by the caller. */
+static bool get_port_id_pairs(struct cdbus_method_call * call_ptr, unsigned int * count_ptr, dbus_uint64_t ** port_ids_ptr)
+{
+  DBusMessageIter iter;
+  DBusMessageIter array_iter;
+  DBusMessageIter struct_iter;
+  unsigned int count;
+  dbus_uint64_t * port_ids;
+
+  if (!dbus_message_has_signature(call_ptr->message, "a(tt)"))
+  {
+    cdbus_error(call_ptr, DBUS_ERROR_INVALID_ARGS, "Invalid arguments to method \"%s\": expected a(tt), got %s", call_ptr->method_name, dbus_message_get_signature(call_ptr->message));
+    return false;
+  }
+
+  dbus_message_iter_init(call_ptr->message, &iter);
+
+  count = 0;
+  dbus_message_iter_recurse(&iter, &array_iter);
+  while (dbus_message_iter_get_arg_type(&array_iter) != DBUS_TYPE_INVALID)
+  {
+    count++;
+    dbus_message_iter_next(&array_iter);
+  }
+
+  port_ids = malloc((count > 0 ? count : 1) * 2 * sizeof(dbus_uint64_t));
+  if (port_ids == NULL)
+  {
+    cdbus_error(call_ptr, DBUS_ERROR_NO_MEMORY, "malloc() failed for %u port pairs", count);
+    return false;
+  }
+
+  count = 0;
+  dbus_message_iter_recurse(&iter, &array_iter);
+  while (dbus_message_iter_get_arg_type(&array_iter) != DBUS_TYPE_INVALID)
+  {
+    dbus_message_iter_recurse(&array_iter, &struct_iter);
+    dbus_message_iter_get_basic(&struct_iter, port_ids + count * 2);
+    dbus_message_iter_next(&struct_iter);
+    dbus_message_iter_get_basic(&struct_iter, port_ids + count * 2 + 1);
+    count++;
+    dbus_message_iter_next(&array_iter);
+  }
+
+  *count_ptr = count;
+  *port_ids_ptr = port_ids;
+  return true;
+}
+
+static void return_batch_results(struct cdbus_method_call * call_ptr, unsigned int count, const bool * results)
+{
+  DBusMessageIter iter;
+  DBusMessageIter array_iter;
+  unsigned int i;
+  dbus_bool_t result;
+
+  call_ptr->reply = dbus_message_new_method_return(call_ptr->message);
+  if (call_ptr->reply == NULL)
+  {
+    goto fail;
+  }
+
+  dbus_message_iter_init_append(call_ptr->reply, &iter);
+
+  if (!dbus_message_iter_open_container(&iter, DBUS_TYPE_ARRAY, DBUS_TYPE_BOOLEAN_AS_STRING, &array_iter))
+  {
+    goto fail_unref;
+  }
+
+  for (i = 0; i < count; i++)
+  {
+    result = results[i];
+    if (!dbus_message_iter_append_basic(&array_iter, DBUS_TYPE_BOOLEAN, &result))
+    {
+      dbus_message_iter_close_container(&iter, &array_iter);
+      goto fail_unref;
+    }
+  }
+
+  if (!dbus_message_iter_close_container(&iter, &array_iter))
+  {
+    goto fail_unref;
+  }
+
+  return;
+
+fail_unref:
+  dbus_message_unref(call_ptr->reply);
+  call_ptr->reply = NULL;
+
+fail:
+  log_error("Ran out of memory trying to construct method return");
+}
+
+static void connect_ports_batch(struct cdbus_method_call * call_ptr)
+{
+  unsigned int count;
+  dbus_uint64_t * port_ids;
+  ladish_port_handle * ports;
+  bool * results;
+  unsigned int i;
+  struct ladish_graph_port * port_ptr;
+
+  if (graph_ptr->connect_handler == NULL)
+  {
+    cdbus_error(call_ptr, DBUS_ERROR_FAILED, "connect requests on graph %s cannot be handlined", graph_ptr->opath != NULL ? graph_ptr->opath : "JACK");
+    return;
+  }
+
+  if (!get_port_id_pairs(call_ptr, &count, &port_ids))
+  {
+    return;
+  }
+
+  log_info("connect_ports_batch() called for %u port pairs.", count);
+
+  ports = malloc((count > 0 ? count : 1) * 2 * sizeof(ladish_port_handle));
+  results = malloc((count > 0 ? count : 1) * sizeof(bool));
+  if (ports == NULL || results == NULL)
+  {
+    cdbus_error(call_ptr, DBUS_ERROR_NO_MEMORY, "malloc() failed for %u port pairs", count);
+    goto exit;
+  }
+
+  /* validate everything before issuing any request */
+  for (i = 0; i < count * 2; i++)
+  {
+    port_ptr = ladish_graph_find_port_by_id_internal(graph_ptr, port_ids[i]);
+    if (port_ptr == NULL)
+    {
+      cdbus_error(call_ptr, DBUS_ERROR_INVALID_ARGS, "Cannot connect unknown port with id %"PRIu64, port_ids[i]);
+      goto exit;
+    }
+
+    ports[i] = port_ptr->port;
+  }
+
+  if (graph_ptr->connect_batch_handler != NULL)
+  {
+    graph_ptr->connect_batch_handler(graph_ptr->context, (ladish_graph_handle)graph_ptr, count, ports, results);
+  }
+  else
+  {
+    for (i = 0; i < count; i++)
+    {
+      results[i] = graph_ptr->connect_handler(graph_ptr->context, (ladish_graph_handle)graph_ptr, ports[i * 2], ports[i * 2 + 1]);
+    }
+  }
+
+  return_batch_results(call_ptr, count, results);
+
+exit:
+  free(results);
+  free(ports);
+  free(port_ids);
+}
+
+static void disconnect_ports_batch(struct cdbus_method_call * call_ptr)
+{
+  unsigned int count;
+  dbus_uint64_t * port_ids;
+  uint64_t * connection_ids;
+  bool * results;
+  unsigned int i;
+  struct ladish_graph_port * port1_ptr;
+  struct ladish_graph_port * port2_ptr;
+  struct ladish_graph_connection * connection_ptr;
+
+  if (graph_ptr->disconnect_handler == NULL)
+  {
+    cdbus_error(call_ptr, DBUS_ERROR_FAILED, "disconnect requests on graph %s cannot be handlined", graph_ptr->opath != NULL ? graph_ptr->opath : "JACK");
+    return;
+  }
+
+  if (!get_port_id_pairs(call_ptr, &count, &port_ids))
+  {
+    return;
+  }
+
+  log_info("disconnect_ports_batch() called for %u port pairs.", count);
+
+  connection_ids = malloc((count > 0 ? count : 1) * sizeof(uint64_t));
+  results = malloc((count > 0 ? count : 1) * sizeof(bool));
+  if (connection_ids == NULL || results == NULL)
+  {
+    cdbus_error(call_ptr, DBUS_ERROR_NO_MEMORY, "malloc() failed for %u port pairs", count);
+    goto exit;
+  }
+
+  /* validate everything before issuing any request */
+  for (i = 0; i < count; i++)
+  {
+    port1_ptr = ladish_graph_find_port_by_id_internal(graph_ptr, port_ids[i * 2]);
+    port2_ptr = ladish_graph_find_port_by_id_internal(graph_ptr, port_ids[i * 2 + 1]);
+    if (port1_ptr == NULL || port2_ptr == NULL)
+    {
+      cdbus_error(call_ptr, DBUS_ERROR_INVALID_ARGS, "Cannot disconnect unknown port with id %"PRIu64, port1_ptr == NULL ? port_ids[i * 2] : port_ids[i * 2 + 1]);
+      goto exit;
+    }
+
+    connection_ptr = ladish_graph_find_connection_by_ports(graph_ptr, port1_ptr, port2_ptr);
+    if (connection_ptr == NULL)
+    {
+      cdbus_error(call_ptr, DBUS_ERROR_INVALID_ARGS, "Cannot disconnect not connected ports %"PRIu64" and %"PRIu64, port_ids[i * 2], port_ids[i * 2 + 1]);
+      goto exit;
+    }
+
+    connection_ids[i] = connection_ptr->id;
+  }
+
+  for (i = 0; i < count; i++)
+  {
+    connection_ptr = ladish_graph_find_connection_by_id(graph_ptr, connection_ids[i]);
+    connection_ptr->changing = true;
+  }
+
+  if (graph_ptr->disconnect_batch_handler != NULL)
+  {
+    graph_ptr->disconnect_batch_handler(graph_ptr->context, (ladish_graph_handle)graph_ptr, count, connection_ids, results);
+  }
+  else
+  {
+    for (i = 0; i < count; i++)
+    {
+      results[i] = graph_ptr->disconnect_handler(graph_ptr->context, (ladish_graph_handle)graph_ptr, connection_ids[i]);
+    }
+  }
+
+  for (i = 0; i < count; i++)
+  {
+    if (!results[i])
+    {
+      connection_ptr = ladish_graph_find_connection_by_id(graph_ptr, connection_ids[i]);
+      if (connection_ptr != NULL)
+      {
+        connection_ptr->changing = false;
+      }
+    }
+  }
+
+  return_batch_results(call_ptr, count, results);
+
+exit:
+  free(results);
+  free(connection_ids);
+  free(port_ids);
+}
+
 static void get_client_pid(struct cdbus_method_call * call_ptr)
 {
-  int64_t pid = 0;
-  cdbus_method_return_new_single(call_ptr, DBUS_TYPE_INT64, &pid);
+  int64_t pid = 0;
+  cdbus_method_return_new_single(call_ptr, DBUS_TYPE_INT64, &pid);
+}
+
+static void subscribe_changes_batch(struct cdbus_method_call * call_ptr)
+{
+  const char * sender;
+  struct ladish_graph_batch_subscription * subscription_ptr;
+
+  sender = ladish_intern(dbus_message_get_sender(call_ptr->message));
+  if (sender == NULL)
+  {
+    cdbus_error(call_ptr, DBUS_ERROR_NO_MEMORY, "Cannot intern sender name");
+    return;
+  }
+
+  if (ladish_graph_find_batch_subscription(graph_ptr, sender) != NULL)
+  {
+    /* already subscribed */
+    ladish_intern_release(sender);
+    cdbus_method_return_new_void(call_ptr);
+    return;
+  }
+
+  subscription_ptr = malloc(sizeof(struct ladish_graph_batch_subscription));
+  if (subscription_ptr == NULL)
+  {
+    ladish_intern_release(sender);
+    cdbus_error(call_ptr, DBUS_ERROR_NO_MEMORY, "malloc() failed to allocate struct ladish_graph_batch_subscription");
+    return;
+  }
+
+  if (list_empty(&g_batch_subscriptions) &&
+      !dbus_connection_add_filter(cdbus_g_dbus_connection, ladish_graph_name_lost_filter, NULL, NULL))
+  {
+    free(subscription_ptr);
+    ladish_intern_release(sender);
+    cdbus_error(call_ptr, DBUS_ERROR_NO_MEMORY, "dbus_connection_add_filter() failed");
+    return;
+  }
+
+  /* the reply of the bus is not waited for, the filter is already installed */
+  if (ladish_graph_find_batch_subscription(NULL, sender) == NULL)
+  {
+    dbus_bus_add_match(cdbus_g_dbus_connection, ladish_graph_compose_name_lost_match(sender), NULL);
+  }
+
+  subscription_ptr->graph = graph_ptr;
+  subscription_ptr->sender = sender;
+  list_add_tail(&subscription_ptr->siblings, &g_batch_subscriptions);
+  graph_ptr->batch_subscribers++;
+
+  cdbus_method_return_new_void(call_ptr);
+}
+
+static void unsubscribe_changes_batch(struct cdbus_method_call * call_ptr)
+{
+  const char * sender;
+
+  sender = ladish_intern_find(dbus_message_get_sender(call_ptr->message));
+  if (sender != NULL)
+  {
+    ladish_graph_drop_batch_subscriptions(graph_ptr, sender);
+  }
+
+  cdbus_method_return_new_void(call_ptr);
 }
 
 #undef graph_ptr
@@ -984,11 +2171,57 @@ bool ladish_graph_create(ladish_graph_handle * graph_handle_ptr, const char * op
     return false;
   }
 
+  if (!ladish_graph_init_indexes(graph_ptr))
+  {
+    log_error("ladish_graph_init_indexes() failed for graph");
+    ladish_dict_destroy(graph_ptr->dict);
+    if (graph_ptr->opath != NULL)
+    {
+      free(graph_ptr->opath);
+    }
+    free(graph_ptr);
+    return false;
+  }
+
+  if (graph_ptr->opath != NULL)
+  {
+    graph_ptr->journal = calloc(LADISH_GRAPH_JOURNAL_SIZE, sizeof(struct ladish_graph_change));
+    if (graph_ptr->journal == NULL)
+    {
+      log_error("calloc() failed for graph change journal");
+      ladish_graph_uninit_indexes(graph_ptr);
+      ladish_dict_destroy(graph_ptr->dict);
+      free(graph_ptr->opath);
+      free(graph_ptr);
+      return false;
+    }
+  }
+  else
+  {
+    graph_ptr->journal = NULL;
+  }
+
+  graph_ptr->journal_head = 0;
+  graph_ptr->journal_count = 0;
+  graph_ptr->journal_base_version = 0;
+  graph_ptr->journal_unflushed = 0;
+  graph_ptr->flushed_version = 1;
+  graph_ptr->served_version = 0;
+  graph_ptr->batch_subscribers = 0;
+
+  graph_ptr->get_graph_reply = NULL;
+  graph_ptr->get_graph_reply_version = 0;
+
   INIT_LIST_HEAD(&graph_ptr->clients);
   INIT_LIST_HEAD(&graph_ptr->ports);
   INIT_LIST_HEAD(&graph_ptr->connections);
 
+  ladish_slab_init(&graph_ptr->client_slab, sizeof(struct ladish_graph_client), LADISH_GRAPH_SLAB_CHUNK_OBJECTS);
+  ladish_slab_init(&graph_ptr->port_slab, sizeof(struct ladish_graph_port), LADISH_GRAPH_SLAB_CHUNK_OBJECTS);
+  ladish_slab_init(&graph_ptr->connection_slab, sizeof(struct ladish_graph_connection), LADISH_GRAPH_SLAB_CHUNK_OBJECTS);
+
   graph_ptr->graph_version = 1;
+  graph_ptr->modified = ladish_modified_now();
   graph_ptr->next_client_id = 1;
   graph_ptr->next_port_id = 1;
   graph_ptr->next_connection_id = 1;
@@ -996,9 +2229,13 @@ bool ladish_graph_create(ladish_graph_handle * graph_handle_ptr, const char * op
   graph_ptr->context = NULL;
   graph_ptr->connect_handler = NULL;
   graph_ptr->disconnect_handler = NULL;
+  graph_ptr->connect_batch_handler = NULL;
+  graph_ptr->disconnect_batch_handler = NULL;
 
   graph_ptr->persist = true;
 
+  list_add_tail(&graph_ptr->siblings, &g_graphs);
+
   *graph_handle_ptr = (ladish_graph_handle)graph_ptr;
   return true;
 }
@@ -1009,12 +2246,13 @@ ladish_graph_find_client(
   struct ladish_graph * graph_ptr,
   ladish_client_handle client)
 {
-  struct list_head * node_ptr;
+  struct hlist_node * node_ptr;
   struct ladish_graph_client * client_ptr;
+  uint32_t hash;
 
-  list_for_each(node_ptr, &graph_ptr->clients)
+  hash = ladish_hash_ptr(client);
+  ladish_hash_for_each_possible(client_ptr, node_ptr, &graph_ptr->clients_by_handle, handle_node, hash)
   {
-    client_ptr = list_entry(node_ptr, struct ladish_graph_client, siblings);
     if (client_ptr->client == client)
     {
       return client_ptr;
@@ -1030,14 +2268,15 @@ ladish_graph_find_port(
   struct ladish_graph * graph_ptr,
   ladish_port_handle port)
 {
-  struct list_head * node_ptr;
+  struct hlist_node * node_ptr;
   struct ladish_graph_port * port_ptr;
+  uint32_t hash;
 
   //log_info("searching port %p", port);
 
-  list_for_each(node_ptr, &graph_ptr->ports)
+  hash = ladish_hash_ptr(port);
+  ladish_hash_for_each_possible(port_ptr, node_ptr, &graph_ptr->ports_by_handle, handle_node, hash)
   {
-    port_ptr = list_entry(node_ptr, struct ladish_graph_port, siblings_graph);
     //log_info("checking port %s:%s, %p", port_ptr->client_ptr->name, port_ptr->name, port_ptr->port);
     if (port_ptr->port == port)
     {
@@ -1062,7 +2301,10 @@ ladish_graph_find_port_by_jack_id_internal(
   bool studio)
 {
   struct list_head * node_ptr;
+  struct hlist_node * hnode_ptr;
   struct ladish_graph_port * port_ptr;
+  struct ladish_graph_port * found_port_ptr;
+  uint32_t hash;
 
   ASSERT(room || studio);
 
@@ -1075,26 +2317,57 @@ ladish_graph_find_port_by_jack_id_internal(
     ladish_graph_get_description((ladish_graph_handle)graph_ptr));
 #endif
 
-  list_for_each(node_ptr, &graph_ptr->ports)
+  if (port_id == 0)
   {
-    port_ptr = list_entry(node_ptr, struct ladish_graph_port, siblings_graph);
-#if defined(LOG_PORT_LOOKUP)
-    log_info(
-      "checking jack port id of port %s:%s, %p; studio id %"PRIu64", room id %"PRIu64,
-      port_ptr->client_ptr->name,
-      port_ptr->name, port_ptr->port,
-      ladish_port_get_jack_id(port_ptr->port),
-      ladish_port_get_jack_id_room(port_ptr->port));
-#endif
-    if ((studio && ladish_port_get_jack_id(port_ptr->port) == port_id) ||
-        (room && port_ptr->link && ladish_port_get_jack_id_room(port_ptr->port) == port_id))
+    /* ports without jack id are not indexed */
+    list_for_each(node_ptr, &graph_ptr->ports)
     {
-      //log_info("found");
-      return port_ptr;
+      port_ptr = list_entry(node_ptr, struct ladish_graph_port, siblings_graph);
+      if ((studio && ladish_port_get_jack_id(port_ptr->port) == 0) ||
+          (room && port_ptr->link && ladish_port_get_jack_id_room(port_ptr->port) == 0))
+      {
+        return port_ptr;
+      }
     }
+
+    return NULL;
   }
 
-  return NULL;
+  found_port_ptr = NULL;
+  hash = ladish_hash_u64(port_id);
+
+  if (studio)
+  {
+    ladish_hash_for_each_possible(port_ptr, hnode_ptr, &graph_ptr->ports_by_jack_id, jack_id_node, hash)
+    {
+      if (ladish_port_get_jack_id(port_ptr->port) == port_id &&
+          (found_port_ptr == NULL || port_ptr->id < found_port_ptr->id))
+      {
+        found_port_ptr = port_ptr;
+      }
+    }
+  }
+
+  if (room)
+  {
+    ladish_hash_for_each_possible(port_ptr, hnode_ptr, &graph_ptr->ports_by_jack_id_room, jack_id_room_node, hash)
+    {
+      if (ladish_port_get_jack_id_room(port_ptr->port) == port_id &&
+          (found_port_ptr == NULL || port_ptr->id < found_port_ptr->id))
+      {
+        found_port_ptr = port_ptr;
+      }
+    }
+  }
+
+#if defined(LOG_PORT_LOOKUP)
+  if (found_port_ptr != NULL)
+  {
+    log_info("found port %s:%s, %p", found_port_ptr->client_ptr->name, found_port_ptr->name, found_port_ptr->port);
+  }
+#endif
+
+  return found_port_ptr;
 }
 
 #if 0
@@ -1125,7 +2398,7 @@ static void ladish_graph_hide_connection_internal(struct ladish_graph * graph_pt
 {
   ASSERT(!connection_ptr->hidden);
   connection_ptr->hidden = true;
-  graph_ptr->graph_version++;
+  ladish_graph_changed(graph_ptr);
 
   if (graph_ptr->opath != NULL)
   {
@@ -1138,7 +2411,7 @@ static void ladish_graph_show_port_internal(struct ladish_graph * graph_ptr, str
   if (port_ptr->client_ptr->hidden)
   {
     port_ptr->client_ptr->hidden = false;
-    graph_ptr->graph_version++;
+    ladish_graph_changed(graph_ptr);
     if (graph_ptr->opath != NULL)
     {
       ladish_graph_emit_client_appeared(graph_ptr, port_ptr->client_ptr);
@@ -1147,7 +2420,7 @@ static void ladish_graph_show_port_internal(struct ladish_graph * graph_ptr, str
 
   ASSERT(port_ptr->hidden);
   port_ptr->hidden = false;
-  graph_ptr->graph_version++;
+  ladish_graph_changed(graph_ptr);
   if (graph_ptr->opath != NULL)
   {
     ladish_graph_emit_port_appeared(graph_ptr, port_ptr);
@@ -1159,7 +2432,7 @@ static void ladish_graph_hide_port_internal(struct ladish_graph * graph_ptr, str
 {
   ASSERT(!port_ptr->hidden);
   port_ptr->hidden = true;
-  graph_ptr->graph_version++;
+  ladish_graph_changed(graph_ptr);
 
   if (graph_ptr->opath != NULL)
   {
@@ -1171,7 +2444,7 @@ static void ladish_graph_hide_client_internal(struct ladish_graph * graph_ptr, s
 {
   ASSERT(!client_ptr->hidden);
   client_ptr->hidden = true;
-  graph_ptr->graph_version++;
+  ladish_graph_changed(graph_ptr);
 
   if (graph_ptr->opath != NULL)
   {
@@ -1188,10 +2461,20 @@ static void ladish_hide_connections(struct ladish_graph * graph_ptr, struct ladi
 
   ASSERT(graph_ptr->opath != NULL);
 
-  list_for_each(node_ptr, &graph_ptr->connections)
+  list_for_each(node_ptr, &port_ptr->port1_connections)
   {
-    connection_ptr = list_entry(node_ptr, struct ladish_graph_connection, siblings);
-    if (!connection_ptr->hidden && (connection_ptr->port1_ptr == port_ptr || connection_ptr->port2_ptr == port_ptr))
+    connection_ptr = list_entry(node_ptr, struct ladish_graph_connection, siblings_port1);
+    if (!connection_ptr->hidden)
+    {
+      log_info("hidding connection between ports %"PRIu64" and %"PRIu64, connection_ptr->port1_ptr->id, connection_ptr->port2_ptr->id);
+      ladish_graph_hide_connection_internal(graph_ptr, connection_ptr);
+    }
+  }
+
+  list_for_each(node_ptr, &port_ptr->port2_connections)
+  {
+    connection_ptr = list_entry(node_ptr, struct ladish_graph_connection, siblings_port2);
+    if (!connection_ptr->hidden)
     {
       log_info("hidding connection between ports %"PRIu64" and %"PRIu64, connection_ptr->port1_ptr->id, connection_ptr->port2_ptr->id);
       ladish_graph_hide_connection_internal(graph_ptr, connection_ptr);
@@ -1202,7 +2485,13 @@ static void ladish_hide_connections(struct ladish_graph * graph_ptr, struct ladi
 static void ladish_graph_remove_connection_internal(struct ladish_graph * graph_ptr, struct ladish_graph_connection * connection_ptr)
 {
   list_del(&connection_ptr->siblings);
-  graph_ptr->graph_version++;
+  list_del(&connection_ptr->siblings_port1);
+  list_del(&connection_ptr->siblings_port2);
+  ladish_hash_del(&graph_ptr->connections_by_id, &connection_ptr->id_node);
+  ladish_hash_del(&graph_ptr->connections_by_ports, &connection_ptr->ports_node);
+  ladish_graph_changed(graph_ptr);
+
+  ladish_graph_flightrec_connection(LADISH_FLIGHTREC_GRAPH_CONNECTION_REMOVED, graph_ptr, connection_ptr);
 
   if (!connection_ptr->hidden && graph_ptr->opath != NULL)
   {
@@ -1210,7 +2499,7 @@ static void ladish_graph_remove_connection_internal(struct ladish_graph * graph_
   }
 
   ladish_dict_destroy(connection_ptr->dict);
-  free(connection_ptr);
+  ladish_slab_free(&graph_ptr->connection_slab, connection_ptr);
 }
 
 static void ladish_graph_remove_port_connections(struct ladish_graph * graph_ptr, struct ladish_graph_port * port_ptr)
@@ -1219,14 +2508,18 @@ static void ladish_graph_remove_port_connections(struct ladish_graph * graph_ptr
   struct list_head * temp_node_ptr;
   struct ladish_graph_connection * connection_ptr;
 
-  list_for_each_safe(node_ptr, temp_node_ptr, &graph_ptr->connections)
+  list_for_each_safe(node_ptr, temp_node_ptr, &port_ptr->port1_connections)
   {
-    connection_ptr = list_entry(node_ptr, struct ladish_graph_connection, siblings);
-    if (connection_ptr->port1_ptr == port_ptr || connection_ptr->port2_ptr == port_ptr)
-    {
-      log_info("removing connection between ports %"PRIu64" and %"PRIu64, connection_ptr->port1_ptr->id, connection_ptr->port2_ptr->id);
-      ladish_graph_remove_connection_internal(graph_ptr, connection_ptr);
-    }
+    connection_ptr = list_entry(node_ptr, struct ladish_graph_connection, siblings_port1);
+    log_info("removing connection between ports %"PRIu64" and %"PRIu64, connection_ptr->port1_ptr->id, connection_ptr->port2_ptr->id);
+    ladish_graph_remove_connection_internal(graph_ptr, connection_ptr);
+  }
+
+  list_for_each_safe(node_ptr, temp_node_ptr, &port_ptr->port2_connections)
+  {
+    connection_ptr = list_entry(node_ptr, struct ladish_graph_connection, siblings_port2);
+    log_info("removing connection between ports %"PRIu64" and %"PRIu64, connection_ptr->port1_ptr->id, connection_ptr->port2_ptr->id);
+    ladish_graph_remove_connection_internal(graph_ptr, connection_ptr);
   }
 }
 
@@ -1239,11 +2532,16 @@ ladish_graph_remove_port_internal(
 {
   ladish_graph_remove_port_connections(graph_ptr, port_ptr);
 
+  ladish_graph_unindex_port(graph_ptr, port_ptr);
   ladish_port_del_ref(port_ptr->port);
 
   list_del(&port_ptr->siblings_client);
   list_del(&port_ptr->siblings_graph);
 
+  ladish_flightrec_record(LADISH_FLIGHTREC_GRAPH_PORT_REMOVED, (uintptr_t)graph_ptr, client_ptr->id, port_ptr->id);
+
+  ladish_graph_changed(graph_ptr);
+
   log_info("removing port '%s':'%s' (%"PRIu64":%"PRIu64") from graph %s", client_ptr->name, port_ptr->name, client_ptr->id, port_ptr->id, graph_ptr->opath != NULL ? graph_ptr->opath : "JACK");
   if (graph_ptr->opath != NULL && !port_ptr->hidden)
   {
@@ -1251,8 +2549,8 @@ ladish_graph_remove_port_internal(
     ladish_graph_emit_port_disappeared(graph_ptr, port_ptr);
   }
 
-  free(port_ptr->name);
-  free(port_ptr);
+  ladish_intern_release(port_ptr->name);
+  ladish_slab_free(&graph_ptr->port_slab, port_ptr);
 }
 
 static
@@ -1275,22 +2573,24 @@ ladish_graph_remove_client_internal(
     ladish_graph_remove_port_internal(graph_ptr, client_ptr, port_ptr);
   }
 
-  graph_ptr->graph_version++;
+  ladish_graph_changed(graph_ptr);
   list_del(&client_ptr->siblings);
+  ladish_graph_unindex_client(graph_ptr, client_ptr);
+  ladish_flightrec_record(LADISH_FLIGHTREC_GRAPH_CLIENT_REMOVED, (uintptr_t)graph_ptr, client_ptr->id, 0);
   log_info("removing client '%s' (%"PRIu64") from graph %s", client_ptr->name, client_ptr->id, graph_ptr->opath != NULL ? graph_ptr->opath : "JACK");
   if (graph_ptr->opath != NULL && !client_ptr->hidden)
   {
     ladish_graph_emit_client_disappeared(graph_ptr, client_ptr);
   }
 
-  free(client_ptr->name);
+  ladish_intern_release(client_ptr->name);
 
   if (destroy_client)
   {
     ladish_client_destroy(client_ptr->client);
   }
 
-  free(client_ptr);
+  ladish_slab_free(&graph_ptr->client_slab, client_ptr);
 }
 
 bool ladish_graph_client_looks_empty_internal(struct ladish_graph * graph_ptr, struct ladish_graph_client * client_ptr)
@@ -1321,6 +2621,23 @@ bool ladish_graph_client_looks_empty_internal(struct ladish_graph * graph_ptr, s
 void ladish_graph_destroy(ladish_graph_handle graph_handle)
 {
   ladish_graph_clear(graph_handle, NULL);
+  list_del(&graph_ptr->siblings);
+  ladish_graph_uninit_indexes(graph_ptr);
+  if (graph_ptr->journal != NULL)
+  {
+    if (graph_ptr->journal_unflushed != 0)
+    {
+      /* subscribers get the removals made by the clear above */
+      ladish_graph_emit_changes_batch(graph_ptr);
+    }
+    ladish_graph_journal_reset(graph_ptr);
+    free(graph_ptr->journal);
+  }
+  ladish_graph_drop_batch_subscriptions(graph_ptr, NULL);
+  ladish_graph_drop_get_graph_reply(graph_ptr);
+  ladish_slab_uninit(&graph_ptr->connection_slab);
+  ladish_slab_uninit(&graph_ptr->port_slab);
+  ladish_slab_uninit(&graph_ptr->client_slab);
   ladish_dict_destroy(graph_ptr->dict);
   if (graph_ptr->opath != NULL)
   {
@@ -1339,6 +2656,42 @@ const char * ladish_graph_get_description(ladish_graph_handle graph_handle)
   return graph_ptr->opath != NULL ? graph_ptr->opath : "JACK";
 }
 
+void
+ladish_graph_get_size(
+  ladish_graph_handle graph_handle,
+  uint32_t * clients_count_ptr,
+  uint32_t * ports_count_ptr,
+  uint32_t * connections_count_ptr)
+{
+  *clients_count_ptr = graph_ptr->clients_by_id.count;
+  *ports_count_ptr = graph_ptr->ports_by_id.count;
+  *connections_count_ptr = graph_ptr->connections_by_id.count;
+}
+
+uint64_t ladish_graph_get_modified(ladish_graph_handle graph_handle)
+{
+  uint64_t modified;
+  struct list_head * node_ptr;
+  struct ladish_graph_client * client_ptr;
+  struct ladish_graph_port * port_ptr;
+
+  modified = ladish_max(graph_ptr->modified, ladish_dict_get_modified(graph_ptr->dict));
+
+  list_for_each(node_ptr, &graph_ptr->clients)
+  {
+    client_ptr = list_entry(node_ptr, struct ladish_graph_client, siblings);
+    modified = ladish_max(modified, ladish_dict_get_modified(ladish_client_get_dict(client_ptr->client)));
+  }
+
+  list_for_each(node_ptr, &graph_ptr->ports)
+  {
+    port_ptr = list_entry(node_ptr, struct ladish_graph_port, siblings_graph);
+    modified = ladish_max(modified, ladish_dict_get_modified(ladish_port_get_dict(port_ptr->port)));
+  }
+
+  return modified;
+}
+
 void
 ladish_graph_set_connection_handlers(
   ladish_graph_handle graph_handle,
@@ -1352,6 +2705,16 @@ ladish_graph_set_connection_handlers(
   graph_ptr->disconnect_handler = disconnect_handler;
 }
 
+void
+ladish_graph_set_batch_connection_handlers(
+  ladish_graph_handle graph_handle,
+  ladish_graph_connect_batch_request_handler connect_batch_handler,
+  ladish_graph_disconnect_batch_request_handler disconnect_batch_handler)
+{
+  graph_ptr->connect_batch_handler = connect_batch_handler;
+  graph_ptr->disconnect_batch_handler = disconnect_batch_handler;
+}
+
 void ladish_graph_clear(ladish_graph_handle graph_handle, ladish_graph_simple_port_callback port_callback)
 {
   struct ladish_graph_client * client_ptr;
@@ -1399,7 +2762,7 @@ void ladish_graph_show_connection(ladish_graph_handle graph_handle, uint64_t con
   ASSERT(connection_ptr->hidden);
   connection_ptr->hidden = false;
   connection_ptr->changing = false;
-  graph_ptr->graph_version++;
+  ladish_graph_changed(graph_ptr);
 
   ladish_graph_emit_ports_connected(graph_ptr, connection_ptr);
 }
@@ -1478,7 +2841,7 @@ void ladish_graph_show_client(ladish_graph_handle graph_handle, ladish_client_ha
 
   ASSERT(client_ptr->hidden);
   client_ptr->hidden = false;
-  graph_ptr->graph_version++;
+  ladish_graph_changed(graph_ptr);
 
   if (graph_ptr->opath != NULL)
   {
@@ -1501,6 +2864,9 @@ void ladish_graph_adjust_port(ladish_graph_handle graph_handle, ladish_port_hand
 
   port_ptr->type = type;
   port_ptr->flags = flags;
+
+  /* type and flags are part of the GetGraph reply but changing them does not bump the graph version */
+  ladish_graph_drop_get_graph_reply(graph_ptr);
 }
 
 bool ladish_graph_add_client(ladish_graph_handle graph_handle, ladish_client_handle client_handle, const char * name, bool hidden)
@@ -1509,29 +2875,31 @@ bool ladish_graph_add_client(ladish_graph_handle graph_handle, ladish_client_han
 
   log_info("adding client '%s' (%p) to graph %s", name, client_handle, graph_ptr->opath != NULL ? graph_ptr->opath : "JACK");
 
-  client_ptr = malloc(sizeof(struct ladish_graph_client));
+  client_ptr = ladish_slab_alloc(&graph_ptr->client_slab);
   if (client_ptr == NULL)
   {
-    log_error("malloc() failed for struct ladish_graph_client");
+    log_error("ladish_slab_alloc() failed for struct ladish_graph_client");
     return false;
   }
 
-  client_ptr->name = strdup(name);
+  client_ptr->name = ladish_intern(name);
   if (client_ptr->name == NULL)
   {
-    log_error("strdup() failed for graph client name");
-    free(client_ptr);
+    log_error("ladish_intern() failed for graph client name");
+    ladish_slab_free(&graph_ptr->client_slab, client_ptr);
     return false;
   }
 
   client_ptr->id = graph_ptr->next_client_id++;
   client_ptr->client = client_handle;
   client_ptr->hidden = hidden;
-  graph_ptr->graph_version++;
+  ladish_graph_changed(graph_ptr);
 
   INIT_LIST_HEAD(&client_ptr->ports);
 
   list_add_tail(&client_ptr->siblings, &graph_ptr->clients);
+  ladish_graph_index_client(graph_ptr, client_ptr);
+  ladish_flightrec_record(LADISH_FLIGHTREC_GRAPH_CLIENT_ADDED, (uintptr_t)graph_ptr, client_ptr->id, 0);
 
   if (!hidden && graph_ptr->opath != NULL)
   {
@@ -1605,18 +2973,18 @@ ladish_graph_add_port(
 
   log_info("adding port '%s' (%p) to client '%s' in graph %s", name, port_handle, client_ptr->name, graph_ptr->opath != NULL ? graph_ptr->opath : "JACK");
 
-  port_ptr = malloc(sizeof(struct ladish_graph_port));
+  port_ptr = ladish_slab_alloc(&graph_ptr->port_slab);
   if (port_ptr == NULL)
   {
-    log_error("malloc() failed for struct ladish_graph_port");
+    log_error("ladish_slab_alloc() failed for struct ladish_graph_port");
     return false;
   }
 
-  port_ptr->name = strdup(name);
+  port_ptr->name = ladish_intern(name);
   if (port_ptr->name == NULL)
   {
-    log_error("strdup() failed for graph port name");
-    free(port_ptr);
+    log_error("ladish_intern() failed for graph port name");
+    ladish_slab_free(&graph_ptr->port_slab, port_ptr);
     return false;
   }
 
@@ -1635,8 +3003,12 @@ ladish_graph_add_port(
   }
 
   port_ptr->client_ptr = client_ptr;
+  INIT_LIST_HEAD(&port_ptr->port1_connections);
+  INIT_LIST_HEAD(&port_ptr->port2_connections);
   list_add_tail(&port_ptr->siblings_client, &client_ptr->ports);
   list_add_tail(&port_ptr->siblings_graph, &graph_ptr->ports);
+  ladish_graph_index_port(graph_ptr, port_ptr);
+  ladish_flightrec_record(LADISH_FLIGHTREC_GRAPH_PORT_ADDED, (uintptr_t)graph_ptr, client_ptr->id, port_ptr->id);
 
   if (!hidden)
   {
@@ -1662,17 +3034,17 @@ ladish_graph_add_connection(
   port2_ptr = ladish_graph_find_port(graph_ptr, port2_handle);
   ASSERT(port2_ptr != NULL);
 
-  connection_ptr = malloc(sizeof(struct ladish_graph_connection));
+  connection_ptr = ladish_slab_alloc(&graph_ptr->connection_slab);
   if (connection_ptr == NULL)
   {
-    log_error("malloc() failed for struct ladish_graph_connection");
+    log_error("ladish_slab_alloc() failed for struct ladish_graph_connection");
     return 0;
   }
 
   if (!ladish_dict_create(&connection_ptr->dict))
   {
     log_error("ladish_dict_create() failed for connection");
-    free(connection_ptr);
+    ladish_slab_free(&graph_ptr->connection_slab, connection_ptr);
     return 0;
   }
 
@@ -1681,9 +3053,14 @@ ladish_graph_add_connection(
   connection_ptr->port2_ptr = port2_ptr;
   connection_ptr->hidden = hidden;
   connection_ptr->changing = false;
-  graph_ptr->graph_version++;
+  ladish_graph_changed(graph_ptr);
 
   list_add_tail(&connection_ptr->siblings, &graph_ptr->connections);
+  list_add_tail(&connection_ptr->siblings_port1, &port1_ptr->port1_connections);
+  list_add_tail(&connection_ptr->siblings_port2, &port2_ptr->port2_connections);
+  ladish_hash_add(&graph_ptr->connections_by_id, &connection_ptr->id_node, ladish_hash_u64(connection_ptr->id));
+  ladish_hash_add(&graph_ptr->connections_by_ports, &connection_ptr->ports_node, ladish_graph_connection_ports_hash(port1_ptr, port2_ptr));
+  ladish_graph_flightrec_connection(LADISH_FLIGHTREC_GRAPH_CONNECTION_ADDED, graph_ptr, connection_ptr);
 
   /* log_info( */
   /*   "new connection %"PRIu64" between '%s':'%s' and '%s':'%s'", */
@@ -1810,20 +3187,31 @@ ladish_graph_find_connection(
 
 ladish_client_handle ladish_graph_find_client_by_name(ladish_graph_handle graph_handle, const char * name, bool appless)
 {
-  struct list_head * node_ptr;
+  struct hlist_node * node_ptr;
   struct ladish_graph_client * client_ptr;
+  struct ladish_graph_client * found_client_ptr;
+  uint32_t hash;
 
-  list_for_each(node_ptr, &graph_ptr->clients)
+  /* no client can have a name that is not interned */
+  name = ladish_intern_find(name);
+  if (name == NULL)
   {
-    client_ptr = list_entry(node_ptr, struct ladish_graph_client, siblings);
-    if (strcmp(client_ptr->name, name) == 0 &&
-        (!appless || !ladish_client_has_app(client_ptr->client))) /* if appless is true, then an appless client is being searched */
+    return NULL;
+  }
+
+  found_client_ptr = NULL;
+  hash = ladish_hash_ptr(name);
+  ladish_hash_for_each_possible(client_ptr, node_ptr, &graph_ptr->clients_by_name, name_node, hash)
+  {
+    if (client_ptr->name == name &&
+        (!appless || !ladish_client_has_app(client_ptr->client)) && /* if appless is true, then an appless client is being searched */
+        (found_client_ptr == NULL || client_ptr->id < found_client_ptr->id))
     {
-      return client_ptr->client;
+      found_client_ptr = client_ptr;
     }
   }
 
-  return NULL;
+  return found_client_ptr != NULL ? found_client_ptr->client : NULL;
 }
 
 ladish_client_handle ladish_graph_find_client_by_app(ladish_graph_handle graph_handle, const uuid_t app_uuid)
@@ -1855,33 +3243,47 @@ ladish_graph_find_port_by_name(
   void * vgraph_filter)
 {
   struct ladish_graph_client * client_ptr;
-  struct list_head * node_ptr;
+  struct hlist_node * node_ptr;
   struct ladish_graph_port * port_ptr;
+  struct ladish_graph_port * found_port_ptr;
+  uint32_t hash;
 
   client_ptr = ladish_graph_find_client(graph_ptr, client_handle);
-  if (client_ptr != NULL)
+  if (client_ptr == NULL)
+  {
+    ASSERT_NO_PASS;
+    return NULL;
+  }
+
+  /* no port can have a name that is not interned */
+  name = ladish_intern_find(name);
+  if (name == NULL)
+  {
+    return NULL;
+  }
+
+  found_port_ptr = NULL;
+  hash = ladish_graph_port_name_hash(client_ptr, name);
+  ladish_hash_for_each_possible(port_ptr, node_ptr, &graph_ptr->ports_by_name, name_node, hash)
   {
-    list_for_each(node_ptr, &client_ptr->ports)
+    if (port_ptr->client_ptr != client_ptr)
     {
-      port_ptr = list_entry(node_ptr, struct ladish_graph_port, siblings_client);
+      continue;
+    }
 
-      if (vgraph_filter != NULL && ladish_port_get_vgraph(port_ptr->port) != vgraph_filter)
-      {
-        continue;
-      }
+    if (vgraph_filter != NULL && ladish_port_get_vgraph(port_ptr->port) != vgraph_filter)
+    {
+      continue;
+    }
 
-      if (strcmp(port_ptr->name, name) == 0)
-      {
-        return port_ptr->port;
-      }
+    if (port_ptr->name == name &&
+        (found_port_ptr == NULL || port_ptr->id < found_port_ptr->id))
+    {
+      found_port_ptr = port_ptr;
     }
   }
-  else
-  {
-    ASSERT_NO_PASS;
-  }
 
-  return NULL;
+  return found_port_ptr != NULL ? found_port_ptr->port : NULL;
 }
 
 ladish_client_handle ladish_graph_find_client_by_uuid(ladish_graph_handle graph_handle, const uuid_t uuid)
@@ -1936,12 +3338,13 @@ bool ladish_graph_is_port_present(ladish_graph_handle graph_handle, ladish_port_
 
 ladish_client_handle ladish_graph_find_client_by_id(ladish_graph_handle graph_handle, uint64_t client_id)
 {
-  struct list_head * node_ptr;
+  struct hlist_node * node_ptr;
   struct ladish_graph_client * client_ptr;
+  uint32_t hash;
 
-  list_for_each(node_ptr, &graph_ptr->clients)
+  hash = ladish_hash_u64(client_id);
+  ladish_hash_for_each_possible(client_ptr, node_ptr, &graph_ptr->clients_by_id, id_node, hash)
   {
-    client_ptr = list_entry(node_ptr, struct ladish_graph_client, siblings);
     if (client_ptr->id == client_id)
     {
       return client_ptr->client;
@@ -1967,18 +3370,38 @@ ladish_port_handle ladish_graph_find_port_by_id(ladish_graph_handle graph_handle
 ladish_client_handle ladish_graph_find_client_by_jack_id(ladish_graph_handle graph_handle, uint64_t client_id)
 {
   struct list_head * node_ptr;
+  struct hlist_node * hnode_ptr;
   struct ladish_graph_client * client_ptr;
+  struct ladish_graph_client * found_client_ptr;
+  uint32_t hash;
 
-  list_for_each(node_ptr, &graph_ptr->clients)
+  if (client_id == 0)
   {
-    client_ptr = list_entry(node_ptr, struct ladish_graph_client, siblings);
-    if (ladish_client_get_jack_id(client_ptr->client) == client_id)
+    /* clients without jack id are not indexed */
+    list_for_each(node_ptr, &graph_ptr->clients)
     {
-      return client_ptr->client;
+      client_ptr = list_entry(node_ptr, struct ladish_graph_client, siblings);
+      if (ladish_client_get_jack_id(client_ptr->client) == 0)
+      {
+        return client_ptr->client;
+      }
+    }
+
+    return NULL;
+  }
+
+  found_client_ptr = NULL;
+  hash = ladish_hash_u64(client_id);
+  ladish_hash_for_each_possible(client_ptr, hnode_ptr, &graph_ptr->clients_by_jack_id, jack_id_node, hash)
+  {
+    if (ladish_client_get_jack_id(client_ptr->client) == client_id &&
+        (found_client_ptr == NULL || client_ptr->id < found_client_ptr->id))
+    {
+      found_client_ptr = client_ptr;
     }
   }
 
-  return NULL;
+  return found_client_ptr != NULL ? found_client_ptr->client : NULL;
 }
 
 ladish_port_handle ladish_graph_find_port_by_jack_id(ladish_graph_handle graph_handle, uint64_t port_id, bool room, bool studio)
@@ -2117,17 +3540,27 @@ ladish_graph_move_port(
 
   list_del(&port_ptr->siblings_client);
   list_del(&port_ptr->siblings_graph);
-  graph_ptr->graph_version++;
+  ladish_graph_changed(graph_ptr);
 
   if (graph_ptr->opath != NULL && !port_ptr->hidden)
   {
-    list_for_each(node_ptr, &graph_ptr->connections)
+    list_for_each(node_ptr, &port_ptr->port1_connections)
+    {
+      connection_ptr = list_entry(node_ptr, struct ladish_graph_connection, siblings_port1);
+      if (!connection_ptr->hidden)
+      {
+        ladish_graph_emit_ports_disconnected(graph_ptr, connection_ptr);
+        ladish_graph_changed(graph_ptr);
+      }
+    }
+
+    list_for_each(node_ptr, &port_ptr->port2_connections)
     {
-      connection_ptr = list_entry(node_ptr, struct ladish_graph_connection, siblings);
-      if (!connection_ptr->hidden && (connection_ptr->port1_ptr == port_ptr || connection_ptr->port2_ptr == port_ptr))
+      connection_ptr = list_entry(node_ptr, struct ladish_graph_connection, siblings_port2);
+      if (!connection_ptr->hidden)
       {
         ladish_graph_emit_ports_disconnected(graph_ptr, connection_ptr);
-        graph_ptr->graph_version++;
+        ladish_graph_changed(graph_ptr);
       }
     }
 
@@ -2138,19 +3571,32 @@ ladish_graph_move_port(
   port_ptr->client_ptr = client_ptr;
   list_add_tail(&port_ptr->siblings_client, &client_ptr->ports);
   list_add_tail(&port_ptr->siblings_graph, &graph_ptr->ports);
-  graph_ptr->graph_version++;
+  ladish_hash_rehash(&graph_ptr->ports_by_id, &port_ptr->id_node, ladish_hash_u64(port_ptr->id));
+  ladish_hash_rehash(&graph_ptr->ports_by_name, &port_ptr->name_node, ladish_graph_port_name_hash(client_ptr, port_ptr->name));
+  ladish_graph_changed(graph_ptr);
 
   if (graph_ptr->opath != NULL && !port_ptr->hidden)
   {
     ladish_graph_emit_port_appeared(graph_ptr, port_ptr);
 
-    list_for_each(node_ptr, &graph_ptr->connections)
+    list_for_each(node_ptr, &port_ptr->port1_connections)
+    {
+      connection_ptr = list_entry(node_ptr, struct ladish_graph_connection, siblings_port1);
+      if (!connection_ptr->hidden)
+      {
+        graph_ptr->next_connection_id++;
+        ladish_graph_changed(graph_ptr);
+        ladish_graph_emit_ports_connected(graph_ptr, connection_ptr);
+      }
+    }
+
+    list_for_each(node_ptr, &port_ptr->port2_connections)
     {
-      connection_ptr = list_entry(node_ptr, struct ladish_graph_connection, siblings);
-      if (!connection_ptr->hidden && (connection_ptr->port1_ptr == port_ptr || connection_ptr->port2_ptr == port_ptr))
+      connection_ptr = list_entry(node_ptr, struct ladish_graph_connection, siblings_port2);
+      if (!connection_ptr->hidden)
       {
         graph_ptr->next_connection_id++;
-        graph_ptr->graph_version++;
+        ladish_graph_changed(graph_ptr);
         ladish_graph_emit_ports_connected(graph_ptr, connection_ptr);
       }
     }
@@ -2163,32 +3609,40 @@ ladish_graph_rename_client(
   ladish_client_handle client_handle,
   const char * new_client_name)
 {
-  char * name;
+  const char * name;
   struct ladish_graph_client * client_ptr;
-  char * old_name;
+  const char * old_name;
+  struct ladish_graph_change change;
 
-  name = strdup(new_client_name);
+  name = ladish_intern(new_client_name);
   if (name == NULL)
   {
-    log_error("strdup('%s') failed.", new_client_name);
+    log_error("ladish_intern('%s') failed.", new_client_name);
     return false;
   }
 
   client_ptr = ladish_graph_find_client(graph_ptr, client_handle);
   if (client_ptr == NULL)
   {
-    free(name);
+    ladish_intern_release(name);
     ASSERT_NO_PASS;
     return false;
   }
 
   old_name = client_ptr->name;
   client_ptr->name = name;
+  ladish_hash_rehash(&graph_ptr->clients_by_name, &client_ptr->name_node, ladish_hash_ptr(name));
+  ladish_flightrec_record(LADISH_FLIGHTREC_GRAPH_CLIENT_RENAMED, (uintptr_t)graph_ptr, client_ptr->id, 0);
 
-  graph_ptr->graph_version++;
+  ladish_graph_changed(graph_ptr);
 
   if (!client_ptr->hidden && graph_ptr->opath != NULL)
   {
+    ladish_graph_change_init_client(&change, graph_ptr->graph_version, GRAPH_CHANGE_CLIENT_RENAMED, client_ptr);
+    change.client1_name = old_name;
+    change.client2_name = client_ptr->name;
+    ladish_graph_journal_record(graph_ptr, &change);
+
     cdbus_signal_emit(
       cdbus_g_dbus_connection,
       graph_ptr->opath,
@@ -2201,7 +3655,7 @@ ladish_graph_rename_client(
       &client_ptr->name);
   }
 
-  free(old_name);
+  ladish_intern_release(old_name);
 
   return true;
 }
@@ -2212,14 +3666,15 @@ ladish_graph_rename_port(
   ladish_port_handle port_handle,
   const char * new_port_name)
 {
-  char * name;
+  const char * name;
   struct ladish_graph_port * port_ptr;
-  char * old_name;
+  const char * old_name;
+  struct ladish_graph_change change;
 
-  name = strdup(new_port_name);
+  name = ladish_intern(new_port_name);
   if (name == NULL)
   {
-    log_error("strdup('%s') failed.", new_port_name);
+    log_error("ladish_intern('%s') failed.", new_port_name);
     return false;
   }
 
@@ -2227,17 +3682,24 @@ ladish_graph_rename_port(
   if (port_ptr == NULL)
   {
     ASSERT_NO_PASS;
-    free(name);
+    ladish_intern_release(name);
     return false;
   }
 
   old_name = port_ptr->name;
   port_ptr->name = name;
+  ladish_hash_rehash(&graph_ptr->ports_by_name, &port_ptr->name_node, ladish_graph_port_name_hash(port_ptr->client_ptr, name));
+  ladish_flightrec_record(LADISH_FLIGHTREC_GRAPH_PORT_RENAMED, (uintptr_t)graph_ptr, port_ptr->client_ptr->id, port_ptr->id);
 
-  graph_ptr->graph_version++;
+  ladish_graph_changed(graph_ptr);
 
   if (!port_ptr->hidden && graph_ptr->opath != NULL)
   {
+    ladish_graph_change_init_port(&change, graph_ptr->graph_version, GRAPH_CHANGE_PORT_RENAMED, port_ptr);
+    change.port1_name = old_name;
+    change.port2_name = port_ptr->name;
+    ladish_graph_journal_record(graph_ptr, &change);
+
     cdbus_signal_emit(
       cdbus_g_dbus_connection,
       graph_ptr->opath,
@@ -2252,7 +3714,7 @@ ladish_graph_rename_port(
       &port_ptr->name);
   }
 
-  free(old_name);
+  ladish_intern_release(old_name);
 
   return true;
 }
@@ -2515,6 +3977,7 @@ ladish_graph_set_link_port_override_uuid(
   ASSERT(port_ptr != NULL && ladish_port_is_link(port_ptr->port));
 
   uuid_copy(port_ptr->link_uuid_override, override_uuid);
+  ladish_hash_rehash(&graph_ptr->ports_by_link_uuid, &port_ptr->link_uuid_node, ladish_graph_uuid_hash(override_uuid));
 }
 
 bool
@@ -2918,7 +4381,7 @@ void ladish_graph_trick_dicts(ladish_graph_handle graph_handle)
     connection_ptr = list_entry(node_ptr, struct ladish_graph_connection, siblings);
     if (!connection_ptr->hidden)
     {
-      graph_ptr->graph_version++;
+      ladish_graph_changed(graph_ptr);
       ladish_graph_emit_ports_disconnected(graph_ptr, connection_ptr);
     }
   }
@@ -2929,7 +4392,7 @@ void ladish_graph_trick_dicts(ladish_graph_handle graph_handle)
 
     if (!port_ptr->hidden)
     {
-      graph_ptr->graph_version++;
+      ladish_graph_changed(graph_ptr);
       ladish_graph_emit_port_disappeared(graph_ptr, port_ptr);
     }
   }
@@ -2940,9 +4403,9 @@ void ladish_graph_trick_dicts(ladish_graph_handle graph_handle)
 
     if (!client_ptr->hidden)
     {
-      graph_ptr->graph_version++;
+      ladish_graph_changed(graph_ptr);
       ladish_graph_emit_client_disappeared(graph_ptr, client_ptr);
-      graph_ptr->graph_version++;
+      ladish_graph_changed(graph_ptr);
       ladish_graph_emit_client_appeared(graph_ptr, client_ptr);
     }
   }
@@ -2953,7 +4416,7 @@ void ladish_graph_trick_dicts(ladish_graph_handle graph_handle)
 
     if (!port_ptr->hidden)
     {
-      graph_ptr->graph_version++;
+      ladish_graph_changed(graph_ptr);
       ladish_graph_emit_port_appeared(graph_ptr, port_ptr);
     }
   }
@@ -2963,13 +4426,63 @@ void ladish_graph_trick_dicts(ladish_graph_handle graph_handle)
     connection_ptr = list_entry(node_ptr, struct ladish_graph_connection, siblings);
     if (!connection_ptr->hidden)
     {
-      graph_ptr->graph_version++;
+      ladish_graph_changed(graph_ptr);
       ladish_graph_emit_ports_connected(graph_ptr, connection_ptr);
     }
   }
 }
 
 #undef graph_ptr
+
+void ladish_graph_client_jack_id_changed(ladish_client_handle client_handle)
+{
+  struct list_head * node_ptr;
+  struct ladish_graph * graph_ptr;
+  struct ladish_graph_client * client_ptr;
+
+  list_for_each(node_ptr, &g_graphs)
+  {
+    graph_ptr = list_entry(node_ptr, struct ladish_graph, siblings);
+    client_ptr = ladish_graph_find_client(graph_ptr, client_handle);
+    if (client_ptr != NULL)
+    {
+      ladish_graph_index_client_jack_id(graph_ptr, client_ptr);
+    }
+  }
+}
+
+void ladish_graph_flush_changes(void)
+{
+  struct list_head * node_ptr;
+  struct ladish_graph * graph_ptr;
+
+  list_for_each(node_ptr, &g_graphs)
+  {
+    graph_ptr = list_entry(node_ptr, struct ladish_graph, siblings);
+    if (graph_ptr->journal_unflushed != 0)
+    {
+      ladish_graph_emit_changes_batch(graph_ptr);
+    }
+  }
+}
+
+void ladish_graph_port_jack_id_changed(ladish_port_handle port_handle)
+{
+  struct list_head * node_ptr;
+  struct ladish_graph * graph_ptr;
+  struct ladish_graph_port * port_ptr;
+
+  list_for_each(node_ptr, &g_graphs)
+  {
+    graph_ptr = list_entry(node_ptr, struct ladish_graph, siblings);
+    port_ptr = ladish_graph_find_port(graph_ptr, port_handle);
+    if (port_ptr != NULL)
+    {
+      ladish_graph_index_port_jack_ids(graph_ptr, port_ptr);
+    }
+  }
+}
+
 #define graph_ptr ((struct ladish_graph *)context)
 
 static
@@ -3053,6 +4566,13 @@ CDBUS_METHOD_ARG_DESCRIBE_IN("known_graph_version", DBUS_TYPE_UINT64_AS_STRING,
   CDBUS_METHOD_ARG_DESCRIBE_OUT("connections", "a(tstststst)", "Connections array")
 CDBUS_METHOD_ARGS_END
 
+CDBUS_METHOD_ARGS_BEGIN(GetGraphDelta, "Get graph changes since known version")
+  CDBUS_METHOD_ARG_DESCRIBE_IN("known_graph_version", DBUS_TYPE_UINT64_AS_STRING, "Known graph version")
+  CDBUS_METHOD_ARG_DESCRIBE_OUT("current_graph_version", DBUS_TYPE_UINT64_AS_STRING, "Current graph version")
+  CDBUS_METHOD_ARG_DESCRIBE_OUT("full_dump", DBUS_TYPE_BOOLEAN_AS_STRING, "Whether changes describe the whole graph instead of changes since known version")
+  CDBUS_METHOD_ARG_DESCRIBE_OUT("changes", "a(tutststststuu)", "Changes array")
+CDBUS_METHOD_ARGS_END
+
 CDBUS_METHOD_ARGS_BEGIN(ConnectPortsByName, "Connect ports")
   CDBUS_METHOD_ARG_DESCRIBE_IN("client1_name", DBUS_TYPE_STRING_AS_STRING, "name first port client")
   CDBUS_METHOD_ARG_DESCRIBE_IN("port1_name", DBUS_TYPE_STRING_AS_STRING, "name of first port")
@@ -3081,26 +4601,53 @@ CDBUS_METHOD_ARGS_BEGIN(DisconnectPortsByConnectionID, "Disconnect ports")
   CDBUS_METHOD_ARG_DESCRIBE_IN("connection_id", DBUS_TYPE_UINT64_AS_STRING, "id of connection to disconnect")
 CDBUS_METHOD_ARGS_END
 
+CDBUS_METHOD_ARGS_BEGIN(ConnectPortsBatch, "Connect multiple port pairs")
+  CDBUS_METHOD_ARG_DESCRIBE_IN("port_pairs", "a(tt)", "ids of ports to connect")
+  CDBUS_METHOD_ARG_DESCRIBE_OUT("results", "ab", "whether connect request succeeded, for each port pair")
+CDBUS_METHOD_ARGS_END
+
+CDBUS_METHOD_ARGS_BEGIN(DisconnectPortsBatch, "Disconnect multiple port pairs")
+  CDBUS_METHOD_ARG_DESCRIBE_IN("port_pairs", "a(tt)", "ids of ports to disconnect")
+  CDBUS_METHOD_ARG_DESCRIBE_OUT("results", "ab", "whether disconnect request succeeded, for each port pair")
+CDBUS_METHOD_ARGS_END
+
 CDBUS_METHOD_ARGS_BEGIN(GetClientPID, "get process id of client")
   CDBUS_METHOD_ARG_DESCRIBE_IN("client_id", DBUS_TYPE_UINT64_AS_STRING, "id of client")
   CDBUS_METHOD_ARG_DESCRIBE_OUT("process_id", DBUS_TYPE_INT64_AS_STRING, "pid of client")
 CDBUS_METHOD_ARGS_END
 
+CDBUS_METHOD_ARGS_BEGIN(SubscribeChangesBatch, "Start receiving GraphChangesBatch signals of the graph")
+CDBUS_METHOD_ARGS_END
+
+CDBUS_METHOD_ARGS_BEGIN(UnsubscribeChangesBatch, "Stop receiving GraphChangesBatch signals of the graph")
+CDBUS_METHOD_ARGS_END
+
 CDBUS_METHODS_BEGIN
   CDBUS_METHOD_DESCRIBE(GetAllPorts, get_all_ports)
   CDBUS_METHOD_DESCRIBE(GetGraph, get_graph)
+  CDBUS_METHOD_DESCRIBE(GetGraphDelta, get_graph_delta)
   CDBUS_METHOD_DESCRIBE(ConnectPortsByName, connect_ports_by_name)
   CDBUS_METHOD_DESCRIBE(ConnectPortsByID, connect_ports_by_id)
   CDBUS_METHOD_DESCRIBE(DisconnectPortsByName, disconnect_ports_by_name)
   CDBUS_METHOD_DESCRIBE(DisconnectPortsByID, disconnect_ports_by_id)
   CDBUS_METHOD_DESCRIBE(DisconnectPortsByConnectionID, disconnect_ports_by_connection_id)
+  CDBUS_METHOD_DESCRIBE(ConnectPortsBatch, connect_ports_batch)
+  CDBUS_METHOD_DESCRIBE(DisconnectPortsBatch, disconnect_ports_batch)
   CDBUS_METHOD_DESCRIBE(GetClientPID, get_client_pid)
+  CDBUS_METHOD_DESCRIBE(SubscribeChangesBatch, subscribe_changes_batch)
+  CDBUS_METHOD_DESCRIBE(UnsubscribeChangesBatch, unsubscribe_changes_batch)
 CDBUS_METHODS_END
 
 CDBUS_SIGNAL_ARGS_BEGIN(GraphChanged, "")
   CDBUS_SIGNAL_ARG_DESCRIBE("new_graph_version", DBUS_TYPE_UINT64_AS_STRING, "")
 CDBUS_SIGNAL_ARGS_END
 
+CDBUS_SIGNAL_ARGS_BEGIN(GraphChangesBatch, "")
+  CDBUS_SIGNAL_ARG_DESCRIBE("old_graph_version", DBUS_TYPE_UINT64_AS_STRING, "")
+  CDBUS_SIGNAL_ARG_DESCRIBE("new_graph_version", DBUS_TYPE_UINT64_AS_STRING, "")
+  CDBUS_SIGNAL_ARG_DESCRIBE("changes", "a(tutststststuu)", "")
+CDBUS_SIGNAL_ARGS_END
+
 CDBUS_SIGNAL_ARGS_BEGIN(ClientAppeared, "")
   CDBUS_SIGNAL_ARG_DESCRIBE("new_graph_version", DBUS_TYPE_UINT64_AS_STRING, "")
   CDBUS_SIGNAL_ARG_DESCRIBE("client_id", DBUS_TYPE_UINT64_AS_STRING, "")
@@ -3175,6 +4722,7 @@ CDBUS_SIGNAL_ARGS_END
 
 CDBUS_SIGNALS_BEGIN
   CDBUS_SIGNAL_DESCRIBE(GraphChanged)
+  CDBUS_SIGNAL_DESCRIBE(GraphChangesBatch)
   CDBUS_SIGNAL_DESCRIBE(ClientAppeared)
   CDBUS_SIGNAL_DESCRIBE(ClientDisappeared)
   CDBUS_SIGNAL_DESCRIBE(ClientRenamed)
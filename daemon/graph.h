@@ -47,6 +47,25 @@ bool
   ladish_graph_handle graph_handle,
   uint64_t connection_id);
 
+/* ports contains count pairs of ports, results receives status of each request */
+typedef
+void
+(* ladish_graph_connect_batch_request_handler)(
+  void * context,
+  ladish_graph_handle graph_handle,
+  unsigned int count,
+  const ladish_port_handle * ports,
+  bool * results);
+
+typedef
+void
+(* ladish_graph_disconnect_batch_request_handler)(
+  void * context,
+  ladish_graph_handle graph_handle,
+  unsigned int count,
+  const uint64_t * connection_ids,
+  bool * results);
+
 typedef void (* ladish_graph_simple_port_callback)(ladish_port_handle port_handle);
 
 bool ladish_graph_create(ladish_graph_handle * graph_handle_ptr, const char * opath);
@@ -56,6 +75,17 @@ void ladish_graph_destroy(ladish_graph_handle graph_handle);
 const char * ladish_graph_get_opath(ladish_graph_handle graph_handle);
 const char * ladish_graph_get_description(ladish_graph_handle graph_handle);
 
+/* Count clients, ports and connections, hidden ones included */
+void
+ladish_graph_get_size(
+  ladish_graph_handle graph_handle,
+  uint32_t * clients_count_ptr,
+  uint32_t * ports_count_ptr,
+  uint32_t * connections_count_ptr);
+
+/* Modification clock value of the last change of the graph, its clients, ports and their dicts */
+uint64_t ladish_graph_get_modified(ladish_graph_handle graph_handle);
+
 void
 ladish_graph_set_connection_handlers(
   ladish_graph_handle graph_handle,
@@ -63,6 +93,13 @@ ladish_graph_set_connection_handlers(
   ladish_graph_connect_request_handler connect_handler,
   ladish_graph_disconnect_request_handler disconnect_handler);
 
+/* optional, when not set the batch methods use the single pair handlers */
+void
+ladish_graph_set_batch_connection_handlers(
+  ladish_graph_handle graph_handle,
+  ladish_graph_connect_batch_request_handler connect_batch_handler,
+  ladish_graph_disconnect_batch_request_handler disconnect_batch_handler);
+
 void ladish_graph_clear(ladish_graph_handle graph_handle, ladish_graph_simple_port_callback port_callback);
 void * ladish_graph_get_dbus_context(ladish_graph_handle graph_handle);
 ladish_dict_handle ladish_graph_get_dict(ladish_graph_handle graph_handle);
@@ -187,6 +224,13 @@ bool ladish_graph_client_has_visible_ports(ladish_graph_handle graph, ladish_cli
 
 void ladish_graph_dump(ladish_graph_handle graph_handle);
 
+/* emit the GraphChangesBatch signals for changes made since the previous call */
+void ladish_graph_flush_changes(void);
+
+/* called by client and port objects so graphs can update their jack id indexes */
+void ladish_graph_client_jack_id_changed(ladish_client_handle client_handle);
+void ladish_graph_port_jack_id_changed(ladish_port_handle port_handle);
+
 bool
 ladish_graph_iterate_nodes(
   ladish_graph_handle graph_handle,
@@ -24,6 +24,8 @@
  * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+#include <unistd.h>
+
 #include "load.h"
 #include "limits.h"
 #include "studio.h"
@@ -429,3 +431,62 @@ void ladish_interlink(ladish_graph_handle vgraph, ladish_app_supervisor_handle a
   ladish_graph_iterate_nodes(ladish_studio_get_jack_graph(), &ctx, interlink_client, NULL, NULL);
   ladish_graph_iterate_nodes(vgraph, &ctx, NULL, interlink_port, NULL);
 }
+
+bool ladish_parse_fd(XML_Parser parser, int fd, const char * path, XML_Bool * error_ptr)
+{
+  void * buffer;
+  ssize_t bytes_read;
+  enum XML_Status xmls;
+
+  do
+  {
+    buffer = XML_GetBuffer(parser, LADISH_LOAD_CHUNK_SIZE);
+    if (buffer == NULL)
+    {
+      log_error("XML_GetBuffer() failed.");
+      return false;
+    }
+
+    bytes_read = read(fd, buffer, LADISH_LOAD_CHUNK_SIZE);
+    if (bytes_read == -1)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+
+      log_error("failed to read '%s': %d (%s)", path, errno, strerror(errno));
+      return false;
+    }
+
+    /* zero bytes read means end of file, tell parser that this is the final chunk */
+    xmls = XML_ParseBuffer(parser, (int)bytes_read, bytes_read == 0);
+    if (xmls == XML_STATUS_ERROR)
+    {
+      if (error_ptr == NULL || !*error_ptr)
+      {
+        log_error(
+          "XML_ParseBuffer() failed for '%s' at line %lu: %s",
+          path,
+          (unsigned long)XML_GetCurrentLineNumber(parser),
+          XML_ErrorString(XML_GetErrorCode(parser)));
+      }
+
+      return false;
+    }
+
+    if (error_ptr != NULL && *error_ptr)
+    {
+      /* the callback already logged the problem, there is no point in parsing the rest */
+      return false;
+    }
+
+    if (xmls == XML_STATUS_SUSPENDED)
+    {
+      return true;
+    }
+  }
+  while (bytes_read != 0);
+
+  return true;
+}
@@ -57,6 +57,8 @@
 #define MAX_STACK_DEPTH       10
 #define MAX_DATA_SIZE         10240
 
+#define LADISH_LOAD_CHUNK_SIZE (64 * 1024) /* size of file chunks fed to the parser */
+
 struct ladish_parse_context
 {
   XML_Bool error;
@@ -100,4 +102,9 @@ ladish_parse_port_type_and_direction_attributes(
 
 void ladish_interlink(ladish_graph_handle vgraph, ladish_app_supervisor_handle app_supervisor);
 
+/* Feed file contents to the parser in LADISH_LOAD_CHUNK_SIZE chunks, so memory use does not depend on file size.
+ * Parsing stops early if a callback suspends the parser (success) or sets *error_ptr (failure).
+ * error_ptr can be NULL if the callbacks do not report errors. */
+bool ladish_parse_fd(XML_Parser parser, int fd, const char * path, XML_Bool * error_ptr);
+
 #endif /* #ifndef LOAD_H__43B1ECB8_247F_4868_AE95_563DD968D7B0__INCLUDED */
@@ -34,16 +34,53 @@
 #include <sys/wait.h>
 #include <sys/time.h>
 #include <sys/resource.h>
+#include <signal.h>
 
 #include "loader.h"
+#include "proctree.h"
+#include "loop.h"
+#include "app_log.h"
 #include "../proxies/conf_proxy.h"
 #include "conf.h"
 #include "../common/catdup.h"
+#include "../common/hash.h"
 
 #define XTERM_COMMAND_EXTENSION "&& sh || sh"
 
+/* max length of output line, longer lines are split */
 #define CLIENT_OUTPUT_BUFFER_SIZE 2048
 
+/* initial size of the recent output ring, it grows up to the configured limit */
+#define CLIENT_OUTPUT_RING_MIN_SIZE 1024
+
+/* Recent output lines of a child, each one terminated by a newline.
+ * Storage is allocated when the child writes its first line.
+ * Referenced by the child until it is buried and by the loader_execute()
+ * caller until it calls loader_output_release(). */
+struct loader_output_ring
+{
+  unsigned int refcount;
+  char * data;
+  size_t size;                  /* allocated bytes */
+  size_t limit;                 /* max bytes, 0 disables the ring */
+  size_t head;                  /* offset of the oldest byte */
+  size_t used;
+};
+
+struct loader_stream
+{
+  int fd;
+  struct ladish_loop_fd loop_fd;
+  bool error;                   /* stderr */
+  char * partial;               /* incomplete last line, allocated on demand */
+  size_t partial_len;
+  char * last_line;             /* copy of the last line, for repeat detection */
+  size_t last_line_size;        /* allocated bytes */
+  uint32_t last_line_hash;
+  size_t last_line_len;
+  unsigned int last_line_repeat_count;
+};
+
 struct loader_child
 {
   struct list_head  siblings;
@@ -58,22 +95,19 @@ struct loader_child
 
   bool terminal;
 
-  int stdout;
-  char stdout_buffer[CLIENT_OUTPUT_BUFFER_SIZE];
-  char stdout_last_line[CLIENT_OUTPUT_BUFFER_SIZE];
-  unsigned int stdout_last_line_repeat_count;
-  char * stdout_buffer_ptr;
-
-  int stderr;
-  char stderr_buffer[CLIENT_OUTPUT_BUFFER_SIZE];
-  char stderr_last_line[CLIENT_OUTPUT_BUFFER_SIZE];
-  unsigned int stderr_last_line_repeat_count;
-  char * stderr_buffer_ptr;
+  struct loader_stream stdout_stream;
+  struct loader_stream stderr_stream;
+  struct loader_output_ring * output;
+  struct ladish_app_log log;
+  bool log_valid;
 };
 
 static void (* g_on_child_exit)(pid_t pid, int exit_status);
 static struct list_head g_childs_list;
 
+/* all reads go through here, data is consumed before the next read */
+static char g_read_buffer[CLIENT_OUTPUT_BUFFER_SIZE];
+
 static struct loader_child *
 loader_child_find(pid_t pid)
 {
@@ -92,25 +126,519 @@ loader_child_find(pid_t pid)
   return NULL;
 }
 
+static struct loader_output_ring * loader_output_ring_new(size_t limit)
+{
+  struct loader_output_ring * ring_ptr;
+
+  ring_ptr = malloc(sizeof(struct loader_output_ring));
+  if (ring_ptr == NULL)
+  {
+    log_error("malloc() failed to allocate struct loader_output_ring");
+    return NULL;
+  }
+
+  ring_ptr->refcount = 1;
+  ring_ptr->data = NULL;
+  ring_ptr->size = 0;
+  ring_ptr->limit = limit;
+  ring_ptr->head = 0;
+  ring_ptr->used = 0;
+
+  return ring_ptr;
+}
+
+static void loader_output_ring_unref(struct loader_output_ring * ring_ptr)
+{
+  ASSERT(ring_ptr->refcount > 0);
+
+  ring_ptr->refcount--;
+  if (ring_ptr->refcount > 0)
+  {
+    return;
+  }
+
+  free(ring_ptr->data);
+  free(ring_ptr);
+}
+
+/* copy ring contents to linear buffer */
+static void loader_output_ring_copy(struct loader_output_ring * ring_ptr, char * buffer)
+{
+  size_t first;
+
+  first = ladish_min(ring_ptr->used, ring_ptr->size - ring_ptr->head);
+  memcpy(buffer, ring_ptr->data + ring_ptr->head, first);
+  memcpy(buffer + first, ring_ptr->data, ring_ptr->used - first);
+}
+
+static bool loader_output_ring_grow(struct loader_output_ring * ring_ptr, size_t needed)
+{
+  size_t size;
+  char * data;
+
+  if (ring_ptr->size >= ring_ptr->limit)
+  {
+    return false;
+  }
+
+  size = ring_ptr->size != 0 ? ring_ptr->size : CLIENT_OUTPUT_RING_MIN_SIZE;
+  while (size < needed && size < ring_ptr->limit)
+  {
+    size *= 2;
+  }
+
+  size = ladish_min(size, ring_ptr->limit);
+  if (size <= ring_ptr->size)
+  {
+    return false;
+  }
+
+  data = malloc(size);
+  if (data == NULL)
+  {
+    log_error("malloc() failed to allocate output ring with size %zu", size);
+    return false;
+  }
+
+  if (ring_ptr->data != NULL)
+  {
+    loader_output_ring_copy(ring_ptr, data);
+    free(ring_ptr->data);
+  }
+
+  ring_ptr->data = data;
+  ring_ptr->size = size;
+  ring_ptr->head = 0;
+
+  return true;
+}
+
+static void loader_output_ring_put(struct loader_output_ring * ring_ptr, const char * line, size_t len)
+{
+  size_t tail;
+  size_t first;
+  bool eol;
+
+  if (ring_ptr->limit < 2)
+  {
+    return;
+  }
+
+  /* keep the end of lines that would not fit at all */
+  if (len + 1 > ring_ptr->limit)
+  {
+    line += len + 1 - ring_ptr->limit;
+    len = ring_ptr->limit - 1;
+  }
+
+  if (ring_ptr->used + len + 1 > ring_ptr->size)
+  {
+    loader_output_ring_grow(ring_ptr, ring_ptr->used + len + 1);
+  }
+
+  if (ring_ptr->size < len + 1)
+  {                             /* initial allocation failed */
+    return;
+  }
+
+  /* drop oldest lines until the new one fits */
+  while (ring_ptr->used + len + 1 > ring_ptr->size)
+  {
+    while (ring_ptr->used > 0)
+    {
+      eol = ring_ptr->data[ring_ptr->head] == '\n';
+      ring_ptr->head = (ring_ptr->head + 1) % ring_ptr->size;
+      ring_ptr->used--;
+      if (eol)
+      {
+        break;
+      }
+    }
+  }
+
+  tail = (ring_ptr->head + ring_ptr->used) % ring_ptr->size;
+  first = ladish_min(len, ring_ptr->size - tail);
+  memcpy(ring_ptr->data + tail, line, first);
+  memcpy(ring_ptr->data, line + first, len - first);
+  ring_ptr->data[(tail + len) % ring_ptr->size] = '\n';
+  ring_ptr->used += len + 1;
+}
+
+static
+bool
+loader_output_ring_get_lines(
+  struct loader_output_ring * ring_ptr,
+  unsigned int max_lines,
+  void * context,
+  bool (* callback)(void * context, const char * line))
+{
+  char * buffer;
+  char * line;
+  char * eol;
+  size_t offset;
+  unsigned int count;
+  bool ret;
+
+  if (ring_ptr->used == 0)
+  {
+    return true;
+  }
+
+  buffer = malloc(ring_ptr->used);
+  if (buffer == NULL)
+  {
+    log_error("malloc() failed to allocate %zu bytes for output lines", ring_ptr->used);
+    return false;
+  }
+
+  loader_output_ring_copy(ring_ptr, buffer);
+  ASSERT(buffer[ring_ptr->used - 1] == '\n');
+
+  /* find where the last max_lines lines begin */
+  count = 0;
+  offset = ring_ptr->used - 1;
+  while (offset > 0 && (max_lines == 0 || count < max_lines))
+  {
+    if (buffer[offset - 1] == '\n')
+    {
+      count++;
+      if (max_lines != 0 && count == max_lines)
+      {
+        break;
+      }
+    }
+
+    offset--;
+  }
+
+  ret = true;
+  for (line = buffer + offset; line < buffer + ring_ptr->used; line = eol + 1)
+  {
+    eol = memchr(line, '\n', buffer + ring_ptr->used - line);
+    ASSERT(eol != NULL);
+    *eol = 0;
+
+    if (!callback(context, line))
+    {
+      ret = false;
+      break;
+    }
+  }
+
+  free(buffer);
+  return ret;
+}
+
+static void loader_stream_init(struct loader_stream * stream_ptr, bool error)
+{
+  stream_ptr->fd = -1;
+  ladish_loop_fd_init(&stream_ptr->loop_fd);
+  stream_ptr->error = error;
+  stream_ptr->partial = NULL;
+  stream_ptr->partial_len = 0;
+  stream_ptr->last_line = NULL;
+  stream_ptr->last_line_size = 0;
+  stream_ptr->last_line_hash = 0;
+  stream_ptr->last_line_len = 0;
+  stream_ptr->last_line_repeat_count = 0;
+}
+
+/* child output goes to the app log file, daemon log is used only when that fails */
 static
 void
-loader_check_line_repeat_end(
-  char * vgraph_name,
-  char * app_name,
+loader_child_log_line(
+  struct loader_child * child_ptr,
   bool error,
-  unsigned int last_line_repeat_count)
+  const char * line,
+  size_t len,
+  const char * suffix)
 {
-  if (last_line_repeat_count >= 2)
+  if (child_ptr->log_valid)
   {
-    if (error)
+    if (suffix == NULL)
     {
-      log_error_plain("%s:%s: stderr line repeated %u times", vgraph_name, app_name, last_line_repeat_count);
+      if (ladish_app_log_line(&child_ptr->log, error, line, len))
+      {
+        return;
+      }
     }
     else
     {
-      log_info("%s:%s: stdout line repeated %u times", vgraph_name, app_name, last_line_repeat_count);
+      char buffer[len + strlen(suffix) + 1];
+
+      memcpy(buffer, line, len);
+      strcpy(buffer + len, suffix);
+      if (ladish_app_log_line(&child_ptr->log, error, buffer, len + strlen(suffix)))
+      {
+        return;
+      }
+    }
+  }
+
+  if (suffix == NULL)
+  {
+    suffix = "";
+  }
+
+  if (error)
+  {
+    log_error_plain("%s:%s: %.*s%s", child_ptr->vgraph_name, child_ptr->app_name, (int)len, line, suffix);
+  }
+  else
+  {
+    log_info("%s:%s: %.*s%s", child_ptr->vgraph_name, child_ptr->app_name, (int)len, line, suffix);
+  }
+}
+
+static void loader_check_line_repeat_end(struct loader_child * child_ptr, struct loader_stream * stream_ptr)
+{
+  char buffer[100];
+  int len;
+
+  if (stream_ptr->last_line_repeat_count >= 2)
+  {
+    len = snprintf(
+      buffer,
+      sizeof(buffer),
+      "%s line repeated %u times",
+      stream_ptr->error ? "stderr" : "stdout",
+      stream_ptr->last_line_repeat_count);
+    loader_child_log_line(child_ptr, stream_ptr->error, buffer, len, NULL);
+  }
+}
+
+static
+void
+loader_child_output_line(
+  struct loader_child * child_ptr,
+  struct loader_stream * stream_ptr,
+  const char * line,
+  size_t len,
+  bool truncated)
+{
+  uint32_t hash;
+  const char * msg;
+  char * buffer;
+
+  hash = ladish_hash_bytes(line, len);
+
+  if (!truncated &&
+      stream_ptr->last_line_repeat_count > 0 &&
+      stream_ptr->last_line_len == len &&
+      stream_ptr->last_line_hash == hash &&
+      memcmp(stream_ptr->last_line, line, len) == 0)
+  {
+    if (stream_ptr->last_line_repeat_count == 1)
+    {
+      msg = stream_ptr->error ? "last stderr line repeating..." : "last stdout line repeating...";
+      loader_child_log_line(child_ptr, stream_ptr->error, msg, strlen(msg), NULL);
+    }
+
+    stream_ptr->last_line_repeat_count++;
+    return;
+  }
+
+  loader_check_line_repeat_end(child_ptr, stream_ptr);
+
+  stream_ptr->last_line_repeat_count = 0;
+
+  if (len > stream_ptr->last_line_size)
+  {
+    buffer = realloc(stream_ptr->last_line, len);
+    if (buffer == NULL)
+    {
+      /* repeats of this line will not be detected */
+      log_error("realloc() failed to allocate %zu bytes for the last child output line", len);
+    }
+    else
+    {
+      stream_ptr->last_line = buffer;
+      stream_ptr->last_line_size = len;
+    }
+  }
+
+  if (len <= stream_ptr->last_line_size)
+  {
+    memcpy(stream_ptr->last_line, line, len);
+    stream_ptr->last_line_hash = hash;
+    stream_ptr->last_line_len = len;
+    stream_ptr->last_line_repeat_count = 1;
+  }
+
+  loader_output_ring_put(child_ptr->output, line, len);
+
+  loader_child_log_line(child_ptr, stream_ptr->error, line, len, truncated ? " (truncated)" : NULL);
+}
+
+/* Append to the incomplete line. Lines too long to fit are logged
+ * like they are, rest (or more) of them will be logged next time. */
+static
+void
+loader_child_output_partial(
+  struct loader_child * child_ptr,
+  struct loader_stream * stream_ptr,
+  const char * data,
+  size_t len)
+{
+  size_t chunk;
+
+  while (len > 0)
+  {
+    if (stream_ptr->partial == NULL)
+    {
+      stream_ptr->partial = malloc(CLIENT_OUTPUT_BUFFER_SIZE);
+      if (stream_ptr->partial == NULL)
+      {
+        log_error("malloc() failed to allocate child output line buffer");
+        loader_child_output_line(child_ptr, stream_ptr, data, len, true);
+        return;
+      }
+    }
+
+    chunk = ladish_min(len, CLIENT_OUTPUT_BUFFER_SIZE - stream_ptr->partial_len);
+    memcpy(stream_ptr->partial + stream_ptr->partial_len, data, chunk);
+    stream_ptr->partial_len += chunk;
+    data += chunk;
+    len -= chunk;
+
+    if (stream_ptr->partial_len == CLIENT_OUTPUT_BUFFER_SIZE)
+    {
+      loader_child_output_line(child_ptr, stream_ptr, stream_ptr->partial, stream_ptr->partial_len, true);
+      stream_ptr->partial_len = 0;
+    }
+  }
+}
+
+/* returns false when the fd reached end of file or failed */
+static bool loader_read_child_output(struct loader_child * child_ptr, struct loader_stream * stream_ptr)
+{
+  ssize_t ret;
+  char * char_ptr;
+  char * eol_ptr;
+  char * end_ptr;
+
+  do
+  {
+    ret = read(stream_ptr->fd, g_read_buffer, sizeof(g_read_buffer));
+    if (ret <= 0)
+    {
+      break;
+    }
+
+    char_ptr = g_read_buffer;
+    end_ptr = g_read_buffer + ret;
+
+    while ((eol_ptr = memchr(char_ptr, '\n', end_ptr - char_ptr)) != NULL)
+    {
+      if (stream_ptr->partial != NULL)
+      {
+        loader_child_output_partial(child_ptr, stream_ptr, char_ptr, eol_ptr - char_ptr);
+        if (stream_ptr->partial_len != 0)
+        {
+          loader_child_output_line(child_ptr, stream_ptr, stream_ptr->partial, stream_ptr->partial_len, false);
+          stream_ptr->partial_len = 0;
+        }
+
+        /* the line is complete, most children write whole lines */
+        free(stream_ptr->partial);
+        stream_ptr->partial = NULL;
+      }
+      else
+      {
+        loader_child_output_line(child_ptr, stream_ptr, char_ptr, eol_ptr - char_ptr, false);
+      }
+
+      char_ptr = eol_ptr + 1;
     }
+
+    /* last line does not end with newline */
+    loader_child_output_partial(child_ptr, stream_ptr, char_ptr, end_ptr - char_ptr);
   }
+  while ((size_t)ret == sizeof(g_read_buffer)); /* if we have read everything as much as we can, then maybe there is more to read */
+
+  /* pty master fails with EIO when the slave side is closed */
+  return ret > 0 || (ret == -1 && (errno == EAGAIN || errno == EINTR));
+}
+
+static void loader_stream_read(struct loader_child * child_ptr, struct loader_stream * stream_ptr)
+{
+  if (!loader_read_child_output(child_ptr, stream_ptr))
+  {
+    ladish_loop_fd_remove(&stream_ptr->loop_fd);
+  }
+
+  if (child_ptr->log_valid)
+  {
+    ladish_app_log_flush(&child_ptr->log);
+  }
+}
+
+static void loader_on_child_stdout(struct ladish_loop_fd * loop_fd_ptr, uint32_t UNUSED(events))
+{
+  struct loader_child * child_ptr;
+
+  child_ptr = container_of(loop_fd_ptr, struct loader_child, stdout_stream.loop_fd);
+  loader_stream_read(child_ptr, &child_ptr->stdout_stream);
+}
+
+static void loader_on_child_stderr(struct ladish_loop_fd * loop_fd_ptr, uint32_t UNUSED(events))
+{
+  struct loader_child * child_ptr;
+
+  child_ptr = container_of(loop_fd_ptr, struct loader_child, stderr_stream.loop_fd);
+  loader_stream_read(child_ptr, &child_ptr->stderr_stream);
+}
+
+static
+void
+loader_stream_watch(
+  struct loader_child * child_ptr,
+  struct loader_stream * stream_ptr,
+  void (* callback)(struct ladish_loop_fd * loop_fd_ptr, uint32_t events))
+{
+  if (stream_ptr->fd == -1)
+  {
+    return;
+  }
+
+  if (!ladish_loop_fd_add(&stream_ptr->loop_fd, stream_ptr->fd, EPOLLIN, callback))
+  {
+    /* nobody would read it, don't let the child block once the buffer fills */
+    log_error("Cannot watch %s of %s:%s, closing it", stream_ptr->error ? "stderr" : "stdout", child_ptr->vgraph_name, child_ptr->app_name);
+    close(stream_ptr->fd);
+    stream_ptr->fd = -1;
+  }
+}
+
+static void loader_stream_close(struct loader_child * child_ptr, struct loader_stream * stream_ptr)
+{
+  /* log what the child has written just before its death */
+  if (stream_ptr->loop_fd.registered)
+  {
+    loader_stream_read(child_ptr, stream_ptr);
+  }
+
+  if (stream_ptr->partial_len != 0)
+  {
+    loader_child_output_line(child_ptr, stream_ptr, stream_ptr->partial, stream_ptr->partial_len, false);
+    stream_ptr->partial_len = 0;
+  }
+
+  loader_check_line_repeat_end(child_ptr, stream_ptr);
+
+  ladish_loop_fd_remove(&stream_ptr->loop_fd);
+  if (stream_ptr->fd != -1)
+  {
+    close(stream_ptr->fd);
+    stream_ptr->fd = -1;
+  }
+
+  free(stream_ptr->partial);
+  stream_ptr->partial = NULL;
+
+  free(stream_ptr->last_line);
+  stream_ptr->last_line = NULL;
+  stream_ptr->last_line_size = 0;
 }
 
 static void
@@ -125,17 +653,11 @@ loader_childs_bury(void)
     child_ptr = list_entry(node_ptr, struct loader_child, siblings);
     if (child_ptr->dead)
     {
-      loader_check_line_repeat_end(
-        child_ptr->vgraph_name,
-        child_ptr->app_name,
-        false,
-        child_ptr->stdout_last_line_repeat_count);
-
-      loader_check_line_repeat_end(
-        child_ptr->vgraph_name,
-        child_ptr->app_name,
-        true,
-        child_ptr->stderr_last_line_repeat_count);
+      if (!child_ptr->terminal)
+      {
+        loader_stream_close(child_ptr, &child_ptr->stdout_stream);
+        loader_stream_close(child_ptr, &child_ptr->stderr_stream);
+      }
 
       log_debug("Bury child '%s' with PID %llu", child_ptr->app_name, (unsigned long long)child_ptr->pid);
 
@@ -145,26 +667,29 @@ loader_childs_bury(void)
       free(child_ptr->vgraph_name);
       free(child_ptr->app_name);
 
-      if (!child_ptr->terminal)
+      /* the loader_execute() caller keeps the output until it releases it */
+      loader_output_ring_unref(child_ptr->output);
+      if (child_ptr->log_valid)
       {
-        close(child_ptr->stdout);
-        close(child_ptr->stderr);
+        ladish_app_log_uninit(&child_ptr->log);
       }
 
+      ladish_proctree_remove_root(child_ptr->pid);
       g_on_child_exit(child_ptr->pid, child_ptr->exit_status);
       free(child_ptr);
     }
   }
 }
 
-static void loader_sigchld_handler(int signum)
+void loader_on_sigchld(void)
 {
   int status;
   pid_t pid;
   struct loader_child *child_ptr;
   int signal;
 
-  ASSERT(signum == SIGCHLD);
+  /* exited processes free their pids for reuse */
+  ladish_proctree_forget_unowned();
 
   while ((pid = waitpid(-1, &status, WNOHANG)) > 0)
   {
@@ -210,13 +735,19 @@ static void loader_sigchld_handler(int signum)
 void loader_init(void (* on_child_exit)(pid_t pid, int exit_status))
 {
   g_on_child_exit = on_child_exit;
-  signal(SIGCHLD, loader_sigchld_handler);
   INIT_LIST_HEAD(&g_childs_list);
+
+  if (!ladish_proctree_init())
+  {
+    /* not fatal, app lookups by pid will not find anything */
+    log_error("ladish_proctree_init() failed");
+  }
 }
 
 void loader_uninit(void)
 {
   loader_childs_bury();
+  ladish_proctree_uninit();
 }
 
 #if 0
@@ -349,145 +880,9 @@ loader_exec_program(
   exit(1);
 }
 
-static
-void
-loader_read_child_output(
-  char * vgraph_name,
-  char * app_name,
-  int fd,
-  bool error,
-  char * buffer_ptr,
-  char ** buffer_ptr_ptr,
-  char * last_line,
-  unsigned int * last_line_repeat_count)
-{
-  ssize_t ret;
-  char *char_ptr;
-  char *eol_ptr;
-  size_t left;
-  size_t max_read;
-
-  do
-  {
-    max_read = CLIENT_OUTPUT_BUFFER_SIZE - 1 - (*buffer_ptr_ptr - buffer_ptr);
-    ret = read(fd, *buffer_ptr_ptr, max_read);
-    if (ret > 0)
-    {
-      (*buffer_ptr_ptr)[ret] = 0;
-      char_ptr = buffer_ptr;
-
-      while ((eol_ptr = strchr(char_ptr, '\n')) != NULL)
-      {
-        *eol_ptr = 0;
-
-        if (*last_line_repeat_count > 0 && strcmp(last_line, char_ptr) == 0)
-        {
-          if (*last_line_repeat_count == 1)
-          {
-            if (error)
-            {
-              log_error_plain("%s:%s: last stderr line repeating..", vgraph_name, app_name);
-            }
-            else
-            {
-              log_info("%s:%s: last stdout line repeating...", vgraph_name, app_name);
-            }
-          }
-
-          (*last_line_repeat_count)++;
-        }
-        else
-        {
-          loader_check_line_repeat_end(vgraph_name, app_name, error, *last_line_repeat_count);
-
-          strcpy(last_line, char_ptr);
-          *last_line_repeat_count = 1;
-
-          if (error)
-          {
-            log_error_plain("%s:%s: %s", vgraph_name, app_name, char_ptr);
-          }
-          else
-          {
-            log_info("%s:%s: %s", vgraph_name, app_name, char_ptr);
-          }
-        }
-
-        char_ptr = eol_ptr + 1;
-      }
-
-      left = ret - (char_ptr - *buffer_ptr_ptr);
-      if (left != 0)
-      {
-        /* last line does not end with newline */
-
-        if (left == CLIENT_OUTPUT_BUFFER_SIZE - 1)
-        {
-          /* line is too long to fit in buffer */
-          /* print it like it is, rest (or more) of it will be logged on next interation */
-
-          if (error)
-          {
-            log_error_plain("%s:%s: %s " ANSI_RESET ANSI_COLOR_RED "(truncated) " ANSI_RESET, vgraph_name, app_name, char_ptr);
-          }
-          else
-          {
-            log_info("%s:%s: %s " ANSI_RESET ANSI_COLOR_RED "(truncated) " ANSI_RESET, vgraph_name, app_name, char_ptr);
-          }
-
-          left = 0;
-        }
-        else
-        {
-          memmove(buffer_ptr, char_ptr, left);
-        }
-      }
-
-      *buffer_ptr_ptr = buffer_ptr + left;
-    }
-  }
-  while ((size_t)ret == max_read);      /* if we have read everything as much as we can, then maybe there is more to read */
-}
-
-static void
-loader_read_childs_output(void)
-{
-  struct list_head * node_ptr;
-  struct loader_child * child_ptr;
-
-  list_for_each (node_ptr, &g_childs_list)
-  {
-    child_ptr = list_entry(node_ptr, struct loader_child, siblings);
-
-    if (!child_ptr->terminal)
-    {
-      loader_read_child_output(
-        child_ptr->vgraph_name,
-        child_ptr->app_name,
-        child_ptr->stdout,
-        false,
-        child_ptr->stdout_buffer,
-        &child_ptr->stdout_buffer_ptr,
-        child_ptr->stdout_last_line,
-        &child_ptr->stdout_last_line_repeat_count);
-
-      loader_read_child_output(
-        child_ptr->vgraph_name,
-        child_ptr->app_name,
-        child_ptr->stderr,
-        true,
-        child_ptr->stderr_buffer,
-        &child_ptr->stderr_buffer_ptr,
-        child_ptr->stderr_last_line,
-        &child_ptr->stderr_last_line_repeat_count);
-    }
-  }
-}
-
 void
 loader_run(void)
 {
-  loader_read_childs_output();
   loader_childs_bury();
 }
 
@@ -529,13 +924,17 @@ loader_execute(
   const char * app_name,
   const char * working_dir,
   const char * session_dir,
+  const char * log_dir,
   bool run_in_terminal,
   const char * commandline,
-  pid_t * pid_ptr)
+  pid_t * pid_ptr,
+  loader_output_handle * output_ptr)
 {
   pid_t pid;
   struct loader_child * child_ptr;
   int stderr_pipe[2];
+  unsigned int output_buffer_size;
+  unsigned int log_size;
 
   child_ptr = malloc(sizeof(struct loader_child));
   if (child_ptr == NULL)
@@ -574,10 +973,29 @@ loader_execute(
 
   child_ptr->dead = false;
   child_ptr->terminal = run_in_terminal;
-  child_ptr->stdout_buffer_ptr = child_ptr->stdout_buffer;
-  child_ptr->stderr_buffer_ptr = child_ptr->stderr_buffer;
-  child_ptr->stdout_last_line_repeat_count = 0;
-  child_ptr->stderr_last_line_repeat_count = 0;
+  loader_stream_init(&child_ptr->stdout_stream, false);
+  loader_stream_init(&child_ptr->stderr_stream, true);
+
+  if (!conf_get_uint(LADISH_CONF_KEY_DAEMON_APP_OUTPUT_BUFFER, &output_buffer_size))
+  {
+    output_buffer_size = LADISH_CONF_KEY_DAEMON_APP_OUTPUT_BUFFER_DEFAULT;
+  }
+
+  child_ptr->output = loader_output_ring_new(run_in_terminal ? 0 : output_buffer_size);
+  if (child_ptr->output == NULL)
+  {
+    goto free_app_name;
+  }
+
+  if (!conf_get_uint(LADISH_CONF_KEY_DAEMON_APP_LOG_SIZE, &log_size))
+  {
+    log_size = LADISH_CONF_KEY_DAEMON_APP_LOG_SIZE_DEFAULT;
+  }
+
+  child_ptr->log_valid =
+    !run_in_terminal &&
+    log_dir != NULL &&
+    ladish_app_log_init(&child_ptr->log, log_dir, app_name, log_size);
 
   if (!run_in_terminal)
   {
@@ -587,15 +1005,16 @@ loader_execute(
     }
     else
     {
-      child_ptr->stderr = stderr_pipe[0];
+      child_ptr->stderr_stream.fd = stderr_pipe[0];
 
-      if (fcntl(child_ptr->stderr, F_SETFL, O_NONBLOCK) == -1)
+      if (fcntl(child_ptr->stderr_stream.fd, F_SETFL, O_NONBLOCK) == -1)
       {
         log_error("Failed to set nonblocking mode on "
                    "stderr reading end: %s",
                    strerror(errno));
         close(stderr_pipe[0]);
         close(stderr_pipe[1]);
+        child_ptr->stderr_stream.fd = -1;
       }
     }
   }
@@ -605,7 +1024,7 @@ loader_execute(
   if (!run_in_terminal)
   {
     /* We need pty to disable libc buffering of stdout */
-    pid = forkpty(&child_ptr->stdout, NULL, NULL, NULL);
+    pid = forkpty(&child_ptr->stdout_stream.fd, NULL, NULL, NULL);
   }
   else
   {
@@ -616,6 +1035,7 @@ loader_execute(
   {
     log_error("Could not fork to exec program %s:%s: %s", vgraph_name, app_name, strerror(errno));
     list_del(&child_ptr->siblings); /* fork failed so it is not really a child process to watch for. */
+    loader_output_ring_unref(child_ptr->output);
     return false;
   }
 
@@ -624,6 +1044,11 @@ loader_execute(
     /* Need to close all open file descriptors except the std ones */
     struct rlimit max_fds;
     rlim_t fd;
+    sigset_t sigmask;
+
+    /* the daemon blocks signals it receives through signalfd, the program should not inherit that */
+    sigemptyset(&sigmask);
+    sigprocmask(SIG_SETMASK, &sigmask, NULL);
 
     getrlimit(RLIMIT_NOFILE, &max_fds);
 
@@ -652,12 +1077,19 @@ loader_execute(
     /* In parent, close unused writing ends of pipe */
     close(stderr_pipe[1]);
 
-    if (fcntl(child_ptr->stdout, F_SETFL, O_NONBLOCK) == -1)
+    if (fcntl(child_ptr->stdout_stream.fd, F_SETFL, O_NONBLOCK) == -1)
     {
       log_error("Could not set noblocking mode on stdout "
                  "- pty: %s", strerror(errno));
-      close(stderr_pipe[0]);
-      close(child_ptr->stdout);
+      close(child_ptr->stderr_stream.fd);
+      close(child_ptr->stdout_stream.fd);
+      child_ptr->stderr_stream.fd = -1;
+      child_ptr->stdout_stream.fd = -1;
+    }
+    else
+    {
+      loader_stream_watch(child_ptr, &child_ptr->stdout_stream, loader_on_child_stdout);
+      loader_stream_watch(child_ptr, &child_ptr->stderr_stream, loader_on_child_stderr);
     }
   }
 
@@ -665,8 +1097,19 @@ loader_execute(
 
   *pid_ptr = child_ptr->pid = pid;
 
+  child_ptr->output->refcount++;
+  *output_ptr = (loader_output_handle)child_ptr->output;
+
+  if (!ladish_proctree_add_root(pid))
+  {
+    log_error("Cannot track process tree of %s:%s", vgraph_name, app_name);
+  }
+
   return true;
 
+free_app_name:
+  free(child_ptr->app_name);
+
 free_project_name:
   free(child_ptr->project_name);
 
@@ -694,3 +1137,18 @@ unsigned int loader_get_app_count(void)
 
   return count;
 }
+
+void loader_output_release(loader_output_handle output)
+{
+  loader_output_ring_unref((struct loader_output_ring *)output);
+}
+
+bool
+loader_output_get_lines(
+  loader_output_handle output,
+  unsigned int max_lines,
+  void * context,
+  bool (* callback)(void * context, const char * line))
+{
+  return loader_output_ring_get_lines((struct loader_output_ring *)output, max_lines, context, callback);
+}
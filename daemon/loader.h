@@ -27,8 +27,12 @@
 #ifndef __LASHD_LOADER_H__
 #define __LASHD_LOADER_H__
 
+typedef struct loader_output_tag { int unused; } * loader_output_handle;
+
 void loader_init(void (* on_child_exit)(pid_t pid, int exit_status));
 
+/* On success, *output_ptr is set to the recent output of the child.
+ * It stays valid after the child exits, until loader_output_release() is called. */
 bool
 loader_execute(
   const char * vgraph_name,
@@ -36,14 +40,30 @@ loader_execute(
   const char * app_name,
   const char * working_dir,
   const char * session_dir,
+  const char * log_dir,         /* where the app log file is written, NULL to use the daemon log */
   bool run_in_terminal,
   const char * commandline,
-  pid_t * pid_ptr);
+  pid_t * pid_ptr,
+  loader_output_handle * output_ptr);
 
 void loader_run(void);
 
+/* reaps exited children, called when SIGCHLD is received */
+void loader_on_sigchld(void);
+
 void loader_uninit(void);
 
 unsigned int loader_get_app_count(void);
 
+void loader_output_release(loader_output_handle output);
+
+/* calls callback for each of the last max_lines output lines of a child, oldest first.
+ * max_lines 0 means all buffered lines. */
+bool
+loader_output_get_lines(
+  loader_output_handle output,
+  unsigned int max_lines,
+  void * context,
+  bool (* callback)(void * context, const char * line));
+
 #endif /* __LASHD_LOADER_H__ */
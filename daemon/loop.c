@@ -0,0 +1,602 @@
+/* -*- Mode: C ; c-basic-offset: 2 -*- */
+/*
+ * LADI Session Handler (ladish)
+ *
+ * Copyright (C) 2026 ladish authors, see the AUTHORS file
+ *
+ **************************************************************************
+ * This file contains the epoll based daemon main loop
+ **************************************************************************
+ *
+ * LADI Session Handler is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * LADI Session Handler is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LADI Session Handler. If not, see <http://www.gnu.org/licenses/>
+ * or write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <unistd.h>
+#include <time.h>
+
+#include "loop.h"
+
+#define LADISH_LOOP_MAX_EVENTS 32
+
+/* all D-Bus watches on same fd share one epoll registration */
+struct ladish_loop_dbus_fd
+{
+  struct list_head siblings;
+  struct ladish_loop_fd loop_fd;
+  struct list_head watches;
+};
+
+struct ladish_loop_dbus_watch
+{
+  struct list_head siblings;    /* link for the ladish_loop_dbus_fd::watches list */
+  DBusWatch * watch_ptr;
+  struct ladish_loop_dbus_fd * fd_ptr;
+};
+
+struct ladish_loop_dbus_timeout
+{
+  struct list_head siblings;
+  DBusTimeout * timeout_ptr;
+  uint64_t deadline;            /* monotonic ms, valid when the timeout is enabled */
+};
+
+static int g_loop_epoll_fd = -1;
+static DBusConnection * g_loop_dbus_connection;
+static LIST_HEAD(g_loop_dbus_fds);
+static LIST_HEAD(g_loop_dbus_timeouts);
+static bool g_loop_dbus_dispatch_pending;
+
+/* events of the currently dispatched batch, see ladish_loop_fd_remove() */
+static struct epoll_event g_loop_events[LADISH_LOOP_MAX_EVENTS];
+static int g_loop_events_count;
+static int g_loop_events_index;
+
+static uint64_t ladish_loop_now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+bool ladish_loop_init(void)
+{
+  g_loop_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  if (g_loop_epoll_fd == -1)
+  {
+    log_error("epoll_create1() failed. %s (%d)", strerror(errno), errno);
+    return false;
+  }
+
+  g_loop_events_count = 0;
+  g_loop_events_index = 0;
+
+  return true;
+}
+
+void ladish_loop_uninit(void)
+{
+  ASSERT(list_empty(&g_loop_dbus_fds));
+  ASSERT(list_empty(&g_loop_dbus_timeouts));
+
+  if (g_loop_epoll_fd != -1)
+  {
+    close(g_loop_epoll_fd);
+    g_loop_epoll_fd = -1;
+  }
+}
+
+bool
+ladish_loop_fd_add(
+  struct ladish_loop_fd * loop_fd_ptr,
+  int fd,
+  uint32_t events,
+  void (* callback)(struct ladish_loop_fd * loop_fd_ptr, uint32_t events))
+{
+  struct epoll_event event;
+
+  ASSERT(!loop_fd_ptr->registered);
+
+  event.events = events;
+  event.data.ptr = loop_fd_ptr;
+
+  if (epoll_ctl(g_loop_epoll_fd, EPOLL_CTL_ADD, fd, &event) == -1)
+  {
+    log_error("epoll_ctl(EPOLL_CTL_ADD) failed for fd %d. %s (%d)", fd, strerror(errno), errno);
+    return false;
+  }
+
+  loop_fd_ptr->fd = fd;
+  loop_fd_ptr->events = events;
+  loop_fd_ptr->callback = callback;
+  loop_fd_ptr->registered = true;
+
+  return true;
+}
+
+bool ladish_loop_fd_modify(struct ladish_loop_fd * loop_fd_ptr, uint32_t events)
+{
+  struct epoll_event event;
+
+  ASSERT(loop_fd_ptr->registered);
+
+  if (loop_fd_ptr->events == events)
+  {
+    return true;
+  }
+
+  event.events = events;
+  event.data.ptr = loop_fd_ptr;
+
+  if (epoll_ctl(g_loop_epoll_fd, EPOLL_CTL_MOD, loop_fd_ptr->fd, &event) == -1)
+  {
+    log_error("epoll_ctl(EPOLL_CTL_MOD) failed for fd %d. %s (%d)", loop_fd_ptr->fd, strerror(errno), errno);
+    return false;
+  }
+
+  loop_fd_ptr->events = events;
+
+  return true;
+}
+
+void ladish_loop_fd_remove(struct ladish_loop_fd * loop_fd_ptr)
+{
+  int i;
+
+  if (!loop_fd_ptr->registered)
+  {
+    return;
+  }
+
+  if (epoll_ctl(g_loop_epoll_fd, EPOLL_CTL_DEL, loop_fd_ptr->fd, NULL) == -1)
+  {
+    log_error("epoll_ctl(EPOLL_CTL_DEL) failed for fd %d. %s (%d)", loop_fd_ptr->fd, strerror(errno), errno);
+  }
+
+  /* the owner may free the struct before the rest of current batch is dispatched */
+  for (i = g_loop_events_index; i < g_loop_events_count; i++)
+  {
+    if (g_loop_events[i].data.ptr == loop_fd_ptr)
+    {
+      g_loop_events[i].data.ptr = NULL;
+    }
+  }
+
+  loop_fd_ptr->registered = false;
+  loop_fd_ptr->fd = -1;
+}
+
+/*****************************************************************************/
+/* D-Bus integration */
+
+static uint32_t ladish_loop_dbus_fd_events(struct ladish_loop_dbus_fd * fd_ptr)
+{
+  struct list_head * node_ptr;
+  struct ladish_loop_dbus_watch * watch_ptr;
+  unsigned int flags;
+  uint32_t events;
+
+  events = 0;
+
+  list_for_each(node_ptr, &fd_ptr->watches)
+  {
+    watch_ptr = list_entry(node_ptr, struct ladish_loop_dbus_watch, siblings);
+    if (!dbus_watch_get_enabled(watch_ptr->watch_ptr))
+    {
+      continue;
+    }
+
+    flags = dbus_watch_get_flags(watch_ptr->watch_ptr);
+    if (flags & DBUS_WATCH_READABLE)
+    {
+      events |= EPOLLIN;
+    }
+
+    if (flags & DBUS_WATCH_WRITABLE)
+    {
+      events |= EPOLLOUT;
+    }
+  }
+
+  return events;
+}
+
+static void ladish_loop_dbus_fd_callback(struct ladish_loop_fd * loop_fd_ptr, uint32_t events)
+{
+  struct ladish_loop_dbus_fd * fd_ptr;
+  struct list_head * node_ptr;
+  struct list_head * next_ptr;
+  struct ladish_loop_dbus_watch * watch_ptr;
+  unsigned int flags;
+  unsigned int watch_flags;
+
+  fd_ptr = container_of(loop_fd_ptr, struct ladish_loop_dbus_fd, loop_fd);
+
+  flags = 0;
+  if (events & EPOLLIN)
+  {
+    flags |= DBUS_WATCH_READABLE;
+  }
+
+  if (events & EPOLLOUT)
+  {
+    flags |= DBUS_WATCH_WRITABLE;
+  }
+
+  if (events & EPOLLHUP)
+  {
+    flags |= DBUS_WATCH_HANGUP;
+  }
+
+  if (events & EPOLLERR)
+  {
+    flags |= DBUS_WATCH_ERROR;
+  }
+
+  /* dbus_watch_handle() may remove watches and even free fd_ptr,
+   * so only one watch is handled per call. epoll is level triggered,
+   * events left for other watches are reported again. */
+  list_for_each_safe(node_ptr, next_ptr, &fd_ptr->watches)
+  {
+    watch_ptr = list_entry(node_ptr, struct ladish_loop_dbus_watch, siblings);
+    if (!dbus_watch_get_enabled(watch_ptr->watch_ptr))
+    {
+      continue;
+    }
+
+    watch_flags = dbus_watch_get_flags(watch_ptr->watch_ptr) | DBUS_WATCH_HANGUP | DBUS_WATCH_ERROR;
+    if ((flags & watch_flags) != 0)
+    {
+      dbus_watch_handle(watch_ptr->watch_ptr, flags & watch_flags);
+      break;
+    }
+  }
+
+  g_loop_dbus_dispatch_pending = true;
+}
+
+static void ladish_loop_dbus_fd_update(struct ladish_loop_dbus_fd * fd_ptr)
+{
+  uint32_t events;
+
+  if (list_empty(&fd_ptr->watches))
+  {
+    ladish_loop_fd_remove(&fd_ptr->loop_fd);
+    list_del(&fd_ptr->siblings);
+    free(fd_ptr);
+    return;
+  }
+
+  events = ladish_loop_dbus_fd_events(fd_ptr);
+  if (fd_ptr->loop_fd.registered)
+  {
+    ladish_loop_fd_modify(&fd_ptr->loop_fd, events);
+  }
+}
+
+static dbus_bool_t ladish_loop_dbus_add_watch(DBusWatch * watch_ptr, void * UNUSED(data))
+{
+  struct list_head * node_ptr;
+  struct ladish_loop_dbus_fd * fd_ptr;
+  struct ladish_loop_dbus_watch * loop_watch_ptr;
+  int fd;
+
+  fd = dbus_watch_get_unix_fd(watch_ptr);
+
+  loop_watch_ptr = malloc(sizeof(struct ladish_loop_dbus_watch));
+  if (loop_watch_ptr == NULL)
+  {
+    log_error("malloc() failed for struct ladish_loop_dbus_watch");
+    return FALSE;
+  }
+
+  list_for_each(node_ptr, &g_loop_dbus_fds)
+  {
+    fd_ptr = list_entry(node_ptr, struct ladish_loop_dbus_fd, siblings);
+    if (fd_ptr->loop_fd.fd == fd)
+    {
+      goto add;
+    }
+  }
+
+  fd_ptr = malloc(sizeof(struct ladish_loop_dbus_fd));
+  if (fd_ptr == NULL)
+  {
+    log_error("malloc() failed for struct ladish_loop_dbus_fd");
+    free(loop_watch_ptr);
+    return FALSE;
+  }
+
+  INIT_LIST_HEAD(&fd_ptr->watches);
+  ladish_loop_fd_init(&fd_ptr->loop_fd);
+
+  if (!ladish_loop_fd_add(&fd_ptr->loop_fd, fd, 0, ladish_loop_dbus_fd_callback))
+  {
+    free(fd_ptr);
+    free(loop_watch_ptr);
+    return FALSE;
+  }
+
+  list_add_tail(&fd_ptr->siblings, &g_loop_dbus_fds);
+
+add:
+  loop_watch_ptr->watch_ptr = watch_ptr;
+  loop_watch_ptr->fd_ptr = fd_ptr;
+  list_add_tail(&loop_watch_ptr->siblings, &fd_ptr->watches);
+  dbus_watch_set_data(watch_ptr, loop_watch_ptr, NULL);
+
+  ladish_loop_dbus_fd_update(fd_ptr);
+
+  return TRUE;
+}
+
+static void ladish_loop_dbus_remove_watch(DBusWatch * watch_ptr, void * UNUSED(data))
+{
+  struct ladish_loop_dbus_watch * loop_watch_ptr;
+  struct ladish_loop_dbus_fd * fd_ptr;
+
+  loop_watch_ptr = dbus_watch_get_data(watch_ptr);
+  if (loop_watch_ptr == NULL)
+  {
+    return;
+  }
+
+  dbus_watch_set_data(watch_ptr, NULL, NULL);
+
+  fd_ptr = loop_watch_ptr->fd_ptr;
+  list_del(&loop_watch_ptr->siblings);
+  free(loop_watch_ptr);
+
+  ladish_loop_dbus_fd_update(fd_ptr);
+}
+
+static void ladish_loop_dbus_toggle_watch(DBusWatch * watch_ptr, void * UNUSED(data))
+{
+  struct ladish_loop_dbus_watch * loop_watch_ptr;
+
+  loop_watch_ptr = dbus_watch_get_data(watch_ptr);
+  if (loop_watch_ptr != NULL)
+  {
+    ladish_loop_dbus_fd_update(loop_watch_ptr->fd_ptr);
+  }
+}
+
+static void ladish_loop_dbus_timeout_schedule(struct ladish_loop_dbus_timeout * loop_timeout_ptr)
+{
+  loop_timeout_ptr->deadline = ladish_loop_now() + dbus_timeout_get_interval(loop_timeout_ptr->timeout_ptr);
+}
+
+static dbus_bool_t ladish_loop_dbus_add_timeout(DBusTimeout * timeout_ptr, void * UNUSED(data))
+{
+  struct ladish_loop_dbus_timeout * loop_timeout_ptr;
+
+  loop_timeout_ptr = malloc(sizeof(struct ladish_loop_dbus_timeout));
+  if (loop_timeout_ptr == NULL)
+  {
+    log_error("malloc() failed for struct ladish_loop_dbus_timeout");
+    return FALSE;
+  }
+
+  loop_timeout_ptr->timeout_ptr = timeout_ptr;
+  ladish_loop_dbus_timeout_schedule(loop_timeout_ptr);
+  list_add_tail(&loop_timeout_ptr->siblings, &g_loop_dbus_timeouts);
+  dbus_timeout_set_data(timeout_ptr, loop_timeout_ptr, NULL);
+
+  return TRUE;
+}
+
+static void ladish_loop_dbus_remove_timeout(DBusTimeout * timeout_ptr, void * UNUSED(data))
+{
+  struct ladish_loop_dbus_timeout * loop_timeout_ptr;
+
+  loop_timeout_ptr = dbus_timeout_get_data(timeout_ptr);
+  if (loop_timeout_ptr == NULL)
+  {
+    return;
+  }
+
+  dbus_timeout_set_data(timeout_ptr, NULL, NULL);
+  list_del(&loop_timeout_ptr->siblings);
+  free(loop_timeout_ptr);
+}
+
+static void ladish_loop_dbus_toggle_timeout(DBusTimeout * timeout_ptr, void * UNUSED(data))
+{
+  struct ladish_loop_dbus_timeout * loop_timeout_ptr;
+
+  loop_timeout_ptr = dbus_timeout_get_data(timeout_ptr);
+  if (loop_timeout_ptr != NULL && dbus_timeout_get_enabled(timeout_ptr))
+  {
+    ladish_loop_dbus_timeout_schedule(loop_timeout_ptr);
+  }
+}
+
+static void ladish_loop_dbus_dispatch_status(DBusConnection * UNUSED(connection_ptr), DBusDispatchStatus status, void * UNUSED(data))
+{
+  if (status == DBUS_DISPATCH_DATA_REMAINS)
+  {
+    g_loop_dbus_dispatch_pending = true;
+  }
+}
+
+/* returns ms till the nearest enabled timeout, -1 if there is none */
+static int ladish_loop_dbus_handle_timeouts(void)
+{
+  struct list_head * node_ptr;
+  struct list_head * next_ptr;
+  struct ladish_loop_dbus_timeout * loop_timeout_ptr;
+  uint64_t now;
+  int64_t left;
+  int min;
+
+  now = ladish_loop_now();
+  min = -1;
+
+  list_for_each_safe(node_ptr, next_ptr, &g_loop_dbus_timeouts)
+  {
+    loop_timeout_ptr = list_entry(node_ptr, struct ladish_loop_dbus_timeout, siblings);
+    if (!dbus_timeout_get_enabled(loop_timeout_ptr->timeout_ptr))
+    {
+      continue;
+    }
+
+    if (loop_timeout_ptr->deadline <= now)
+    {
+      /* reschedule first because the handler may remove the timeout */
+      ladish_loop_dbus_timeout_schedule(loop_timeout_ptr);
+      dbus_timeout_handle(loop_timeout_ptr->timeout_ptr);
+      g_loop_dbus_dispatch_pending = true;
+      /* the list may have changed, the remaining ones are checked on next iteration */
+      return 0;
+    }
+
+    left = loop_timeout_ptr->deadline - now;
+    if (min == -1 || left < min)
+    {
+      min = (int)left;
+    }
+  }
+
+  return min;
+}
+
+bool ladish_loop_attach_dbus(DBusConnection * connection_ptr)
+{
+  if (!dbus_connection_set_watch_functions(
+        connection_ptr,
+        ladish_loop_dbus_add_watch,
+        ladish_loop_dbus_remove_watch,
+        ladish_loop_dbus_toggle_watch,
+        NULL,
+        NULL))
+  {
+    log_error("dbus_connection_set_watch_functions() failed");
+    return false;
+  }
+
+  if (!dbus_connection_set_timeout_functions(
+        connection_ptr,
+        ladish_loop_dbus_add_timeout,
+        ladish_loop_dbus_remove_timeout,
+        ladish_loop_dbus_toggle_timeout,
+        NULL,
+        NULL))
+  {
+    log_error("dbus_connection_set_timeout_functions() failed");
+    dbus_connection_set_watch_functions(connection_ptr, NULL, NULL, NULL, NULL, NULL);
+    return false;
+  }
+
+  dbus_connection_set_dispatch_status_function(connection_ptr, ladish_loop_dbus_dispatch_status, NULL, NULL);
+
+  g_loop_dbus_connection = connection_ptr;
+  /* messages may have been queued before attaching */
+  g_loop_dbus_dispatch_pending = true;
+
+  return true;
+}
+
+void ladish_loop_detach_dbus(DBusConnection * connection_ptr)
+{
+  if (g_loop_dbus_connection == NULL)
+  {                             /* not attached */
+    return;
+  }
+
+  ASSERT(connection_ptr == g_loop_dbus_connection);
+
+  dbus_connection_set_dispatch_status_function(connection_ptr, NULL, NULL, NULL);
+  /* libdbus calls the remove functions for all watches and timeouts */
+  dbus_connection_set_timeout_functions(connection_ptr, NULL, NULL, NULL, NULL, NULL);
+  dbus_connection_set_watch_functions(connection_ptr, NULL, NULL, NULL, NULL, NULL);
+
+  g_loop_dbus_connection = NULL;
+}
+
+static void ladish_loop_dbus_dispatch(void)
+{
+  if (g_loop_dbus_connection == NULL)
+  {
+    return;
+  }
+
+  g_loop_dbus_dispatch_pending = false;
+
+  while (dbus_connection_dispatch(g_loop_dbus_connection) == DBUS_DISPATCH_DATA_REMAINS);
+
+  /* replies and signals emitted by the handlers */
+  if (dbus_connection_has_messages_to_send(g_loop_dbus_connection))
+  {
+    dbus_connection_flush(g_loop_dbus_connection);
+  }
+}
+
+/*****************************************************************************/
+
+void ladish_loop_iterate(int timeout_ms)
+{
+  int dbus_timeout_ms;
+  int ret;
+  struct ladish_loop_fd * loop_fd_ptr;
+
+  if (g_loop_dbus_dispatch_pending)
+  {
+    ladish_loop_dbus_dispatch();
+  }
+
+  dbus_timeout_ms = ladish_loop_dbus_handle_timeouts();
+  if (dbus_timeout_ms != -1 && (timeout_ms == -1 || dbus_timeout_ms < timeout_ms))
+  {
+    timeout_ms = dbus_timeout_ms;
+  }
+
+  if (g_loop_dbus_dispatch_pending)
+  {
+    /* timeout handlers have produced something to dispatch */
+    timeout_ms = 0;
+  }
+
+  ret = epoll_wait(g_loop_epoll_fd, g_loop_events, LADISH_LOOP_MAX_EVENTS, timeout_ms);
+  if (ret == -1)
+  {
+    if (errno != EINTR)
+    {
+      log_error("epoll_wait() failed. %s (%d)", strerror(errno), errno);
+    }
+
+    return;
+  }
+
+  g_loop_events_count = ret;
+  for (g_loop_events_index = 0; g_loop_events_index < g_loop_events_count; g_loop_events_index++)
+  {
+    loop_fd_ptr = g_loop_events[g_loop_events_index].data.ptr;
+    if (loop_fd_ptr == NULL)
+    {                           /* removed while current batch was dispatched */
+      continue;
+    }
+
+    loop_fd_ptr->callback(loop_fd_ptr, g_loop_events[g_loop_events_index].events);
+  }
+
+  g_loop_events_count = 0;
+  g_loop_events_index = 0;
+
+  if (g_loop_dbus_dispatch_pending)
+  {
+    ladish_loop_dbus_dispatch();
+  }
+}
@@ -0,0 +1,75 @@
+/* -*- Mode: C ; c-basic-offset: 2 -*- */
+/*
+ * LADI Session Handler (ladish)
+ *
+ * Copyright (C) 2026 ladish authors, see the AUTHORS file
+ *
+ **************************************************************************
+ * This file contains the interface to the daemon main loop
+ **************************************************************************
+ *
+ * LADI Session Handler is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * LADI Session Handler is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LADI Session Handler. If not, see <http://www.gnu.org/licenses/>
+ * or write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef LOOP_H__33F92867_B658_407B_BDC6_246707CFB2CD__INCLUDED
+#define LOOP_H__33F92867_B658_407B_BDC6_246707CFB2CD__INCLUDED
+
+#include "common.h"
+#include <sys/epoll.h>
+
+/* File descriptor watched by the main loop. The struct is embedded
+ * in the object that owns the fd, the callback gets it back and can
+ * use container_of() to reach the owner. */
+struct ladish_loop_fd
+{
+  int fd;
+  uint32_t events;              /* EPOLLIN, EPOLLOUT, ... */
+  bool registered;
+  void (* callback)(struct ladish_loop_fd * loop_fd_ptr, uint32_t events);
+};
+
+bool ladish_loop_init(void);
+void ladish_loop_uninit(void);
+
+static inline void ladish_loop_fd_init(struct ladish_loop_fd * loop_fd_ptr)
+{
+  loop_fd_ptr->fd = -1;
+  loop_fd_ptr->events = 0;
+  loop_fd_ptr->registered = false;
+  loop_fd_ptr->callback = NULL;
+}
+
+bool
+ladish_loop_fd_add(
+  struct ladish_loop_fd * loop_fd_ptr,
+  int fd,
+  uint32_t events,
+  void (* callback)(struct ladish_loop_fd * loop_fd_ptr, uint32_t events));
+
+bool ladish_loop_fd_modify(struct ladish_loop_fd * loop_fd_ptr, uint32_t events);
+
+/* Removing fd that is not registered is noop. Must be called before the fd is closed. */
+void ladish_loop_fd_remove(struct ladish_loop_fd * loop_fd_ptr);
+
+/* Route watches and timeouts of the connection through the loop */
+bool ladish_loop_attach_dbus(DBusConnection * connection_ptr);
+void ladish_loop_detach_dbus(DBusConnection * connection_ptr);
+
+/* Wait for events and dispatch them. timeout_ms -1 means wait forever,
+ * 0 means don't wait. D-Bus timeouts shorten the wait as needed. */
+void ladish_loop_iterate(int timeout_ms);
+
+#endif /* #ifndef LOOP_H__33F92867_B658_407B_BDC6_246707CFB2CD__INCLUDED */
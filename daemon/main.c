@@ -31,10 +31,14 @@
 #include <stdlib.h>
 #include <signal.h>
 #include <sys/stat.h>
+#include <sys/signalfd.h>
+#include <unistd.h>
 
 #include "version.h"            /* git version define */
 #include "proctitle.h"
 #include "loader.h"
+#include "loop.h"
+#include "cmd.h"
 #include "siginfo.h"
 #include "control.h"
 #include "studio.h"
@@ -48,13 +52,26 @@
 #include "conf.h"
 #include "recent_projects.h"
 #include "lash_server.h"
+#include "flightrec.h"
+#include "metrics.h"
 
 bool g_quit;
+uint64_t g_ladish_modified_clock;
 const char * g_dbus_unique_name;
 cdbus_object_path g_control_object;
 char * g_base_dir;
 static bool g_use_notify = false;
 
+/* how often waiting commands are rechecked when no events arrive */
+#define WAITING_COMMAND_POLL_INTERVAL_MS 50
+
+/* flight recorder is dumped here on crash, relative to base dir */
+#define FLIGHTREC_FILE "/flightrec.log"
+
+static sigset_t g_signalfd_mask;
+static int g_signalfd = -1;
+static struct ladish_loop_fd g_signalfd_loop_fd;
+
 #if 0
 static DBusHandlerResult lashd_client_disconnect_handler(DBusConnection * connection, DBusMessage * message, void * data)
 {
@@ -164,7 +181,7 @@ static bool connect_dbus(void)
     goto unref_connection;
   }
 
-  g_control_object = cdbus_object_path_new(CONTROL_OBJECT_PATH, &g_lashd_interface_control, NULL, NULL);
+  g_control_object = cdbus_object_path_new(CONTROL_OBJECT_PATH, &g_lashd_interface_control, NULL, &g_iface_metrics, NULL, NULL);
   if (g_control_object == NULL)
   {
     goto unref_connection;
@@ -193,34 +210,85 @@ static void disconnect_dbus(void)
   cdbus_call_last_error_cleanup();
 }
 
-void term_signal_handler(int signum)
+static void on_signalfd(struct ladish_loop_fd * UNUSED(loop_fd_ptr), uint32_t UNUSED(events))
 {
-  log_info("Caught signal %d (%s), terminating", signum, strsignal(signum));
-  g_quit = true;
+  struct signalfd_siginfo info;
+  ssize_t ret;
+
+  while ((ret = read(g_signalfd, &info, sizeof(info))) == sizeof(info))
+  {
+    if (info.ssi_signo == SIGCHLD)
+    {
+      loader_on_sigchld();
+      continue;
+    }
+
+    log_info("Caught signal %d (%s), terminating", (int)info.ssi_signo, strsignal(info.ssi_signo));
+    g_quit = true;
+  }
+}
+
+/* Signals are received through signalfd, so they are handled from the main loop
+ * and not in signal context. Must be called before any thread or child is created. */
+static void add_signalfd_signal(int signum, bool ignore_if_already_ignored)
+{
+  struct sigaction action;
+
+  if (ignore_if_already_ignored && sigaction(signum, NULL, &action) == 0 && action.sa_handler == SIG_IGN)
+  {
+    return;
+  }
+
+  /* Ignored signals are discarded even when blocked and ignored SIGCHLD
+   * makes the kernel reap the children, the disposition can be inherited */
+  if (signal(signum, SIG_DFL) == SIG_ERR)
+  {
+    log_error("signal() failed to restore default disposition of signal %d.", signum);
+  }
+
+  sigaddset(&g_signalfd_mask, signum);
 }
 
-bool install_term_signal_handler(int signum, bool ignore_if_already_ignored)
+static bool install_signalfd(void)
 {
-  sig_t sigh;
+  if (sigprocmask(SIG_BLOCK, &g_signalfd_mask, NULL) == -1)
+  {
+    log_error("sigprocmask() failed. %s (%d)", strerror(errno), errno);
+    return false;
+  }
 
-  sigh = signal(signum, term_signal_handler);
-  if (sigh == SIG_ERR)
+  g_signalfd = signalfd(-1, &g_signalfd_mask, SFD_NONBLOCK | SFD_CLOEXEC);
+  if (g_signalfd == -1)
   {
-    log_error("signal() failed to install handler function for signal %d.", signum);
+    log_error("signalfd() failed. %s (%d)", strerror(errno), errno);
     return false;
   }
 
-  if (sigh == SIG_IGN && ignore_if_already_ignored)
+  ladish_loop_fd_init(&g_signalfd_loop_fd);
+  if (!ladish_loop_fd_add(&g_signalfd_loop_fd, g_signalfd, EPOLLIN, on_signalfd))
   {
-    signal(SIGTERM, SIG_IGN);
+    close(g_signalfd);
+    g_signalfd = -1;
+    return false;
   }
 
   return true;
 }
 
+static void uninstall_signalfd(void)
+{
+  if (g_signalfd != -1)
+  {
+    ladish_loop_fd_remove(&g_signalfd_loop_fd);
+    close(g_signalfd);
+    g_signalfd = -1;
+  }
+}
+
 bool init_paths(void)
 {
   const char * home_dir;
+  char * flightrec_path;
 
   home_dir = getenv("HOME");
   if (home_dir == NULL)
@@ -242,6 +310,17 @@ bool init_paths(void)
     return false;
   }
 
+  flightrec_path = catdup(g_base_dir, FLIGHTREC_FILE);
+  if (flightrec_path == NULL)
+  {
+    log_error("catdup failed for '%s' and '%s'", g_base_dir, FLIGHTREC_FILE);
+    free(g_base_dir);
+    return false;
+  }
+
+  ladish_flightrec_init(flightrec_path);
+  free(flightrec_path);
+
   return true;
 }
 
@@ -281,6 +360,12 @@ static void on_conf_notify_changed(void * UNUSED(context), const char * UNUSED(k
   }
 }
 
+static void on_dbus_method_call(const char * iface, const char * method)
+{
+  ladish_flightrec_dbus_method(iface, method);
+  ladish_metrics_dbus_method_begin(iface, method);
+}
+
 int main(int argc, char ** argv, char ** envp)
 {
   struct stat st;
@@ -306,6 +391,33 @@ int main(int argc, char ** argv, char ** envp)
     goto exit;
   }
 
+  if (!ladish_loop_init())
+  {
+    goto uninit_paths;
+  }
+
+  /* install the signal handlers */
+  sigemptyset(&g_signalfd_mask);
+  add_signalfd_signal(SIGCHLD, false);
+  add_signalfd_signal(SIGTERM, false);
+  add_signalfd_signal(SIGINT, true);
+  add_signalfd_signal(SIGHUP, true);
+  if (!install_signalfd())
+  {
+    goto uninit_loop;
+  }
+
+  /* the writer thread inherits the blocked signal mask */
+  if (!ladish_log_async_start())
+  {
+    log_error("Logging will be synchronous");
+  }
+
+  if (signal(SIGPIPE, SIG_IGN) == SIG_ERR)
+  {
+    log_error("signal(SIGPIPE, SIG_IGN).");
+  }
+
   loader_init(ladish_studio_on_child_exit);
 
   if (!room_templates_init())
@@ -319,15 +431,14 @@ int main(int argc, char ** argv, char ** envp)
     goto uninit_room_templates;
   }
 
-  /* install the signal handlers */
-  install_term_signal_handler(SIGTERM, false);
-  install_term_signal_handler(SIGINT, true);
-  install_term_signal_handler(SIGHUP, true);
-  if (signal(SIGPIPE, SIG_IGN) == SIG_ERR)
+  if (!ladish_loop_attach_dbus(cdbus_g_dbus_connection))
   {
-    log_error("signal(SIGPIPE, SIG_IGN).");
+    goto uninit_dbus;
   }
 
+  cdbus_g_method_call_hook = on_dbus_method_call;
+  cdbus_g_method_done_hook = ladish_metrics_dbus_method_done;
+
   /* setup our SIGSEGV magic that prints nice stack in our logfile */ 
   setup_siginfo();
 
@@ -361,6 +472,16 @@ int main(int argc, char ** argv, char ** envp)
     goto uninit_conf;
   }
 
+  if (!conf_register(LADISH_CONF_KEY_DAEMON_APP_OUTPUT_BUFFER, NULL, NULL))
+  {
+    goto uninit_conf;
+  }
+
+  if (!conf_register(LADISH_CONF_KEY_DAEMON_APP_LOG_SIZE, NULL, NULL))
+  {
+    goto uninit_conf;
+  }
+
   if (!ladish_recent_projects_init())
   {
     goto uninit_conf;
@@ -390,9 +511,11 @@ int main(int argc, char ** argv, char ** envp)
 
   while (!g_quit)
   {
-    dbus_connection_read_write_dispatch(cdbus_g_dbus_connection, 50);
+    /* sleep until something happens, unless a command waits for a condition to be met */
+    ladish_loop_iterate(ladish_cqueue_is_empty(ladish_studio_get_cmd_queue()) ? -1 : WAITING_COMMAND_POLL_INTERVAL_MS);
     loader_run();
     ladish_studio_run();
+    ladish_graph_flush_changes();
     ladish_check_integrity();
   }
 
@@ -426,6 +549,7 @@ uninit_conf:
   conf_proxy_uninit();
 
 uninit_dbus:
+  ladish_loop_detach_dbus(cdbus_g_dbus_connection);
   disconnect_dbus();
 
 uninit_room_templates:
@@ -434,6 +558,14 @@ uninit_room_templates:
 uninit_loader:
   loader_uninit();
 
+  ladish_log_async_stop();
+  uninstall_signalfd();
+
+uninit_loop:
+  ladish_loop_uninit();
+  ladish_metrics_uninit();
+
+uninit_paths:
   uninit_paths();
 
 exit:
@@ -0,0 +1,376 @@
+/* -*- Mode: C ; c-basic-offset: 2 -*- */
+/*
+ * LADI Session Handler (ladish)
+ *
+ * Copyright (C) 2026 ladish authors, see the AUTHORS file
+ *
+ **************************************************************************
+ * This file contains implementation of the daemon metrics
+ **************************************************************************
+ *
+ * LADI Session Handler is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * LADI Session Handler is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LADI Session Handler. If not, see <http://www.gnu.org/licenses/>
+ * or write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <time.h>
+#include <stddef.h>
+
+#include "metrics.h"
+#include "studio.h"
+#include "../common/hash.h"
+#include "../dbus_constants.h"
+
+/* bucket 0 is for zero, bucket N is for [2^(N-1), 2^N) microseconds, last one is open ended */
+#define LADISH_METRICS_BUCKETS 32
+#define LADISH_METRICS_MAX_KEY 256
+
+struct ladish_metrics_histogram
+{
+  struct ladish_hash_node node; /* link for the g_metrics_hash hash */
+  struct list_head siblings;    /* link for the g_metrics_list list, keeps creation order */
+  uint64_t count;
+  uint64_t sum;
+  uint64_t max;
+  uint64_t buckets[LADISH_METRICS_BUCKETS];
+  char key[];
+};
+
+static struct ladish_hash g_metrics_hash;
+static bool g_metrics_hash_initialized;
+static LIST_HEAD(g_metrics_list);
+
+static uint64_t g_metrics_dbus_method_start;
+
+uint64_t ladish_metrics_now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static unsigned int ladish_metrics_bucket(uint64_t usecs)
+{
+  unsigned int bucket;
+
+  if (usecs == 0)
+  {
+    return 0;
+  }
+
+  bucket = 64 - __builtin_clzll(usecs);
+  return bucket < LADISH_METRICS_BUCKETS ? bucket : LADISH_METRICS_BUCKETS - 1;
+}
+
+static struct ladish_metrics_histogram * ladish_metrics_get(const char * key)
+{
+  struct hlist_node * node_ptr;
+  struct ladish_metrics_histogram * histogram_ptr;
+  uint32_t hash;
+  size_t len;
+
+  if (!g_metrics_hash_initialized)
+  {
+    if (!ladish_hash_init(&g_metrics_hash))
+    {
+      return NULL;
+    }
+
+    g_metrics_hash_initialized = true;
+  }
+
+  hash = ladish_hash_string(key);
+  ladish_hash_for_each_possible(histogram_ptr, node_ptr, &g_metrics_hash, node, hash)
+  {
+    if (strcmp(histogram_ptr->key, key) == 0)
+    {
+      return histogram_ptr;
+    }
+  }
+
+  len = strlen(key);
+  histogram_ptr = calloc(1, sizeof(struct ladish_metrics_histogram) + len + 1);
+  if (histogram_ptr == NULL)
+  {
+    log_error("calloc() failed to allocate histogram '%s'", key);
+    return NULL;
+  }
+
+  memcpy(histogram_ptr->key, key, len + 1);
+  ladish_hash_add(&g_metrics_hash, &histogram_ptr->node, hash);
+  list_add_tail(&histogram_ptr->siblings, &g_metrics_list);
+
+  return histogram_ptr;
+}
+
+void ladish_metrics_record(const char * group, const char * name, uint64_t usecs)
+{
+  char key[LADISH_METRICS_MAX_KEY];
+  struct ladish_metrics_histogram * histogram_ptr;
+
+  snprintf(key, sizeof(key), "%s:%s", group, name != NULL ? name : "?");
+
+  histogram_ptr = ladish_metrics_get(key);
+  if (histogram_ptr == NULL)
+  {
+    return;
+  }
+
+  histogram_ptr->count++;
+  histogram_ptr->sum += usecs;
+  if (usecs > histogram_ptr->max)
+  {
+    histogram_ptr->max = usecs;
+  }
+
+  histogram_ptr->buckets[ladish_metrics_bucket(usecs)]++;
+}
+
+void ladish_metrics_reset(void)
+{
+  struct ladish_metrics_histogram * histogram_ptr;
+
+  while (!list_empty(&g_metrics_list))
+  {
+    histogram_ptr = list_entry(g_metrics_list.next, struct ladish_metrics_histogram, siblings);
+    list_del(&histogram_ptr->siblings);
+    ladish_hash_del(&g_metrics_hash, &histogram_ptr->node);
+    free(histogram_ptr);
+  }
+}
+
+void ladish_metrics_uninit(void)
+{
+  ladish_metrics_reset();
+
+  if (g_metrics_hash_initialized)
+  {
+    ladish_hash_uninit(&g_metrics_hash);
+    g_metrics_hash_initialized = false;
+  }
+}
+
+void ladish_metrics_dbus_method_begin(const char * UNUSED(iface), const char * UNUSED(method))
+{
+  g_metrics_dbus_method_start = ladish_metrics_now();
+}
+
+void ladish_metrics_dbus_method_done(const char * iface, const char * method)
+{
+  char name[LADISH_METRICS_MAX_KEY];
+
+  snprintf(name, sizeof(name), "%s.%s", iface, method);
+  ladish_metrics_record("dbus", name, ladish_metrics_now() - g_metrics_dbus_method_start);
+}
+
+/**********************************************************************************/
+/*                                D-Bus methods                                   */
+/**********************************************************************************/
+
+static bool ladish_metrics_append_histogram(DBusMessageIter * array_iter_ptr, struct ladish_metrics_histogram * histogram_ptr)
+{
+  DBusMessageIter struct_iter;
+  DBusMessageIter buckets_iter;
+  const char * key;
+  const uint64_t * buckets;
+  bool ret;
+
+  ret = false;
+  key = histogram_ptr->key;
+  buckets = histogram_ptr->buckets;
+
+  if (!dbus_message_iter_open_container(array_iter_ptr, DBUS_TYPE_STRUCT, NULL, &struct_iter))
+    goto exit;
+
+  if (!dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_STRING, &key))
+    goto close_struct;
+
+  if (!dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_UINT64, &histogram_ptr->count))
+    goto close_struct;
+
+  if (!dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_UINT64, &histogram_ptr->sum))
+    goto close_struct;
+
+  if (!dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_UINT64, &histogram_ptr->max))
+    goto close_struct;
+
+  if (!dbus_message_iter_open_container(&struct_iter, DBUS_TYPE_ARRAY, "t", &buckets_iter))
+    goto close_struct;
+
+  if (!dbus_message_iter_append_fixed_array(&buckets_iter, DBUS_TYPE_UINT64, &buckets, LADISH_METRICS_BUCKETS))
+  {
+    dbus_message_iter_close_container(&struct_iter, &buckets_iter);
+    goto close_struct;
+  }
+
+  if (!dbus_message_iter_close_container(&struct_iter, &buckets_iter))
+    goto close_struct;
+
+  ret = true;
+
+close_struct:
+  if (!dbus_message_iter_close_container(array_iter_ptr, &struct_iter))
+    ret = false;
+
+exit:
+  return ret;
+}
+
+static void ladish_metrics_get_histograms(struct cdbus_method_call * call_ptr)
+{
+  DBusMessageIter iter, array_iter;
+  struct list_head * node_ptr;
+
+  call_ptr->reply = dbus_message_new_method_return(call_ptr->message);
+  if (call_ptr->reply == NULL)
+  {
+    goto fail;
+  }
+
+  dbus_message_iter_init_append(call_ptr->reply, &iter);
+
+  if (!dbus_message_iter_open_container(&iter, DBUS_TYPE_ARRAY, "(stttat)", &array_iter))
+  {
+    goto fail_unref;
+  }
+
+  list_for_each(node_ptr, &g_metrics_list)
+  {
+    if (!ladish_metrics_append_histogram(&array_iter, list_entry(node_ptr, struct ladish_metrics_histogram, siblings)))
+    {
+      dbus_message_iter_close_container(&iter, &array_iter);
+      goto fail_unref;
+    }
+  }
+
+  if (!dbus_message_iter_close_container(&iter, &array_iter))
+  {
+    goto fail_unref;
+  }
+
+  return;
+
+fail_unref:
+  dbus_message_unref(call_ptr->reply);
+  call_ptr->reply = NULL;
+
+fail:
+  log_error("Ran out of memory trying to construct method return");
+}
+
+static bool ladish_metrics_append_graph_size(void * context, ladish_graph_handle graph, ladish_app_supervisor_handle UNUSED(app_supervisor))
+{
+  DBusMessageIter struct_iter;
+  const char * name;
+  uint32_t clients;
+  uint32_t ports;
+  uint32_t connections;
+  bool ret;
+
+  ret = false;
+  name = ladish_graph_get_description(graph);
+  ladish_graph_get_size(graph, &clients, &ports, &connections);
+
+  if (!dbus_message_iter_open_container((DBusMessageIter *)context, DBUS_TYPE_STRUCT, NULL, &struct_iter))
+    goto exit;
+
+  if (!dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_STRING, &name))
+    goto close_struct;
+
+  if (!dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_UINT32, &clients))
+    goto close_struct;
+
+  if (!dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_UINT32, &ports))
+    goto close_struct;
+
+  if (!dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_UINT32, &connections))
+    goto close_struct;
+
+  ret = true;
+
+close_struct:
+  if (!dbus_message_iter_close_container((DBusMessageIter *)context, &struct_iter))
+    ret = false;
+
+exit:
+  return ret;
+}
+
+static void ladish_metrics_get_graph_sizes(struct cdbus_method_call * call_ptr)
+{
+  DBusMessageIter iter, array_iter;
+  ladish_graph_handle jack_graph;
+
+  call_ptr->reply = dbus_message_new_method_return(call_ptr->message);
+  if (call_ptr->reply == NULL)
+  {
+    goto fail;
+  }
+
+  dbus_message_iter_init_append(call_ptr->reply, &iter);
+
+  if (!dbus_message_iter_open_container(&iter, DBUS_TYPE_ARRAY, "(suuu)", &array_iter))
+  {
+    goto fail_unref;
+  }
+
+  jack_graph = ladish_studio_get_jack_graph();
+  if ((jack_graph != NULL && !ladish_metrics_append_graph_size(&array_iter, jack_graph, NULL)) ||
+      !ladish_studio_iterate_virtual_graphs(&array_iter, ladish_metrics_append_graph_size))
+  {
+    dbus_message_iter_close_container(&iter, &array_iter);
+    goto fail_unref;
+  }
+
+  if (!dbus_message_iter_close_container(&iter, &array_iter))
+  {
+    goto fail_unref;
+  }
+
+  return;
+
+fail_unref:
+  dbus_message_unref(call_ptr->reply);
+  call_ptr->reply = NULL;
+
+fail:
+  log_error("Ran out of memory trying to construct method return");
+}
+
+static void ladish_metrics_dbus_reset(struct cdbus_method_call * call_ptr)
+{
+  log_info("Metrics reset request");
+  ladish_metrics_reset();
+  cdbus_method_return_new_void(call_ptr);
+}
+
+CDBUS_METHOD_ARGS_BEGIN(GetHistograms, "Get latency histograms")
+  CDBUS_METHOD_ARG_DESCRIBE_OUT("histograms", "a(stttat)", "Key, count, sum and max in microseconds, log2 microsecond buckets")
+CDBUS_METHOD_ARGS_END
+
+CDBUS_METHOD_ARGS_BEGIN(GetGraphSizes, "Get graph sizes")
+  CDBUS_METHOD_ARG_DESCRIBE_OUT("graphs", "a(suuu)", "Graph name, clients, ports and connections count")
+CDBUS_METHOD_ARGS_END
+
+CDBUS_METHOD_ARGS_BEGIN(Reset, "Reset the histograms")
+CDBUS_METHOD_ARGS_END
+
+CDBUS_METHODS_BEGIN
+  CDBUS_METHOD_DESCRIBE(GetHistograms, ladish_metrics_get_histograms)
+  CDBUS_METHOD_DESCRIBE(GetGraphSizes, ladish_metrics_get_graph_sizes)
+  CDBUS_METHOD_DESCRIBE(Reset, ladish_metrics_dbus_reset)
+CDBUS_METHODS_END
+
+CDBUS_INTERFACE_DEFAULT_HANDLER_METHODS_ONLY(g_iface_metrics, IFACE_METRICS)
@@ -0,0 +1,50 @@
+/* -*- Mode: C ; c-basic-offset: 2 -*- */
+/*
+ * LADI Session Handler (ladish)
+ *
+ * Copyright (C) 2026 ladish authors, see the AUTHORS file
+ *
+ **************************************************************************
+ * This file contains interface to the daemon metrics
+ **************************************************************************
+ *
+ * LADI Session Handler is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * LADI Session Handler is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LADI Session Handler. If not, see <http://www.gnu.org/licenses/>
+ * or write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef METRICS_H__8139872D_E23C_4927_9287_E347F40233BB__INCLUDED
+#define METRICS_H__8139872D_E23C_4927_9287_E347F40233BB__INCLUDED
+
+#include "common.h"
+
+/* Latency histograms keyed by "group:name", for example "cmd:start_studio".
+ * Buckets are log2 of microseconds. The histograms, together with the
+ * current graph sizes, are exported through the org.ladish.Metrics
+ * interface of the control object. */
+
+/* monotonic time in microseconds */
+uint64_t ladish_metrics_now(void);
+
+void ladish_metrics_record(const char * group, const char * name, uint64_t usecs);
+void ladish_metrics_reset(void);
+void ladish_metrics_uninit(void);
+
+/* D-Bus method call hooks, time the method handlers */
+void ladish_metrics_dbus_method_begin(const char * iface, const char * method);
+void ladish_metrics_dbus_method_done(const char * iface, const char * method);
+
+extern const struct cdbus_interface_descriptor g_iface_metrics;
+
+#endif /* #ifndef METRICS_H__8139872D_E23C_4927_9287_E347F40233BB__INCLUDED */
@@ -25,6 +25,8 @@
  */
 
 #include "port.h"
+#include "graph.h"
+#include "../common/slab.h"
 
 /* JACK port */
 struct ladish_port
@@ -43,6 +45,9 @@ struct ladish_port
   ladish_dict_handle dict;
 };
 
+/* ports are shared between graphs, so they come from a common pool */
+static struct ladish_slab g_port_slab = LADISH_SLAB_INIT(g_port_slab, struct ladish_port, 256);
+
 bool
 ladish_port_create(
   const uuid_t uuid_ptr,
@@ -51,17 +56,17 @@ ladish_port_create(
 {
   struct ladish_port * port_ptr;
 
-  port_ptr = malloc(sizeof(struct ladish_port));
+  port_ptr = ladish_slab_alloc(&g_port_slab);
   if (port_ptr == NULL)
   {
-    log_error("malloc() failed to allocate struct ladish_port");
+    log_error("ladish_slab_alloc() failed to allocate struct ladish_port");
     return false;
   }
 
   if (!ladish_dict_create(&port_ptr->dict))
   {
     log_error("ladish_dict_create() failed for port");
-    free(port_ptr);
+    ladish_slab_free(&g_port_slab, port_ptr);
     return false;
   }
 
@@ -100,7 +105,7 @@ void ladish_port_destroy(ladish_port_handle port_handle)
   log_info("port %p destroy", port_ptr);
   ASSERT(port_ptr->refcount == 0);
   ladish_dict_destroy(port_ptr->dict);
-  free(port_ptr);
+  ladish_slab_free(&g_port_slab, port_ptr);
 }
 
 ladish_dict_handle ladish_port_get_dict(ladish_port_handle port_handle)
@@ -117,6 +122,7 @@ void ladish_port_set_jack_id(ladish_port_handle port_handle, uint64_t jack_id)
 {
   log_info("port %p jack id set to %"PRIu64, port_handle, jack_id);
   port_ptr->jack_id = jack_id;
+  ladish_graph_port_jack_id_changed(port_handle);
 }
 
 uint64_t ladish_port_get_jack_id(ladish_port_handle port_handle)
@@ -129,6 +135,7 @@ void ladish_port_set_jack_id_room(ladish_port_handle port_handle, uint64_t jack_
   log_info("port %p jack id (room) set to %"PRIu64, port_handle, jack_id);
   ASSERT(port_ptr->link);
   port_ptr->jack_id_room = jack_id;
+  ladish_graph_port_jack_id_changed(port_handle);
 }
 
 uint64_t ladish_port_get_jack_id_room(ladish_port_handle port_handle)
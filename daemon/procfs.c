@@ -38,7 +38,158 @@
 
 #define BUFFER_SIZE 4096
 
-static char g_buffer[BUFFER_SIZE];
+/* "/proc/" + 20 digits of 64-bit pid + "/" + file name */
+#define PROCFS_PATH_MAX 64
+
+static
+bool
+procfs_format_path(
+  char * path,
+  unsigned long long pid,
+  const char * filename)
+{
+  int ret;
+
+  ret = snprintf(path, PROCFS_PATH_MAX, "/proc/%llu/%s", pid, filename);
+  if (ret < 0 || ret >= PROCFS_PATH_MAX)
+  {
+    log_error("procfs path for pid %llu and file \"%s\" is too long", pid, filename);
+    return false;
+  }
+
+  return true;
+}
+
+static
+ssize_t
+procfs_read_fd(
+  int fd,
+  char * buffer,
+  size_t size)
+{
+  ssize_t ret;
+
+  ASSERT(size > 0);
+
+  do
+  {
+    ret = read(fd, buffer, size - 1);
+  }
+  while (ret == -1 && errno == EINTR);
+
+  if (ret < 0)
+  {
+    return -1;
+  }
+
+  buffer[ret] = 0;
+  return ret;
+}
+
+static
+ssize_t
+procfs_read_process_file(
+  unsigned long long pid,
+  const char * filename,
+  char * buffer,
+  size_t size)
+{
+  char path[PROCFS_PATH_MAX];
+  int fd;
+  ssize_t ret;
+
+  if (!procfs_format_path(path, pid, filename))
+  {
+    return -1;
+  }
+
+  fd = open(path, O_RDONLY);
+  if (fd == -1)
+  {
+    return -1;
+  }
+
+  /* procfs generates the contents of small files on the first read */
+  ret = procfs_read_fd(fd, buffer, size);
+
+  close(fd);
+
+  return ret;
+}
+
+static
+bool
+procfs_parse_stat(
+  char * buffer,
+  struct procfs_process_stat * stat_ptr)
+{
+  char * comm_begin;
+  char * comm_end;
+  size_t comm_size;
+  unsigned long long pid;
+  unsigned long long ppid;
+  unsigned long long pgrp;
+  unsigned long long session;
+  unsigned long long start_time;
+  char state;
+
+  /* comm can contain spaces and parens, it ends at the last ')' */
+  comm_begin = strchr(buffer, '(');
+  comm_end = strrchr(buffer, ')');
+  if (comm_begin == NULL || comm_end == NULL || comm_end < comm_begin)
+  {
+    return false;
+  }
+
+  *comm_end = 0;
+  if (sscanf(buffer, "%llu", &pid) != 1 ||
+      sscanf(
+        comm_end + 1,
+        " %c %llu %llu %llu %*d %*d %*u %*u %*u %*u %*u %*u %*u %*d %*d %*d %*d %*d %*d %llu", /* fields 3-22 */
+        &state, &ppid, &pgrp, &session, &start_time) != 5)
+  {
+    return false;
+  }
+
+  comm_begin++;
+  comm_size = comm_end - comm_begin;
+  if (comm_size >= sizeof(stat_ptr->comm))
+  {
+    comm_size = sizeof(stat_ptr->comm) - 1;
+  }
+
+  memcpy(stat_ptr->comm, comm_begin, comm_size);
+  stat_ptr->comm[comm_size] = 0;
+  stat_ptr->pid = pid;
+  stat_ptr->state = state;
+  stat_ptr->ppid = ppid;
+  stat_ptr->pgrp = pgrp;
+  stat_ptr->session = session;
+  stat_ptr->start_time = start_time;
+
+  return true;
+}
+
+bool
+procfs_get_process_stat(
+  unsigned long long pid,
+  struct procfs_process_stat * stat_ptr)
+{
+  char buffer[PROCFS_STAT_BUFFER_SIZE];
+
+  if (procfs_read_process_file(pid, "stat", buffer, sizeof(buffer)) <= 0)
+  {
+    return false;
+  }
+
+  if (!procfs_parse_stat(buffer, stat_ptr))
+  {
+    log_error("stat of pid %llu not parsed: \"%s\"", pid, buffer);
+    return false;
+  }
+
+  return true;
+}
 
 static
 bool
@@ -48,6 +199,7 @@ procfs_get_process_file(
   char ** buffer_ptr_ptr,
   size_t * size_ptr)
 {
+  char path[PROCFS_PATH_MAX];
   int fd;
   ssize_t ret;
   size_t max;
@@ -56,9 +208,12 @@ procfs_get_process_file(
   size_t buffer_size;
   size_t used_size;
 
-  sprintf(g_buffer, "/proc/%llu/%s", pid, filename);
+  if (!procfs_format_path(path, pid, filename))
+  {
+    return false;
+  }
 
-  fd = open(g_buffer, O_RDONLY);
+  fd = open(path, O_RDONLY);
   if (fd == -1)
   {
     return false;
@@ -140,32 +295,25 @@ procfs_get_process_link(
   unsigned long long pid,
   const char * filename)
 {
-  int fd;
+  char path[PROCFS_PATH_MAX];
+  char buffer[BUFFER_SIZE];
   ssize_t ret;
   char * buffer_ptr;
 
-  sprintf(g_buffer, "/proc/%llu/%s", pid, filename);
-
-  fd = open(g_buffer, O_RDONLY);
-  if (fd == -1)
+  if (!procfs_format_path(path, pid, filename))
   {
     return NULL;
   }
 
-  ret = readlink(g_buffer, g_buffer, sizeof(g_buffer));
-  if (ret != 0)
-  {
-    g_buffer[ret] = 0;
-    buffer_ptr = strdup(g_buffer);
-    log_debug("process %llu %s symlink points to \"%s\"", pid, filename, buffer_ptr);
-  }
-  else
+  ret = readlink(path, buffer, sizeof(buffer) - 1);
+  if (ret < 0)
   {
-    ASSERT(ret == -1);
-    buffer_ptr = NULL;
+    return NULL;
   }
 
-  close(fd);
+  buffer[ret] = 0;
+  buffer_ptr = strdup(buffer);
+  log_debug("process %llu %s symlink points to \"%s\"", pid, filename, buffer);
 
   return buffer_ptr;
 }
@@ -251,68 +399,3 @@ procfs_get_process_cwd(
 {
   return procfs_get_process_link(pid, "cwd");
 }
-
-unsigned long long
-procfs_get_process_parent(
-  unsigned long long pid)
-{
-  char * buffer_ptr;
-  size_t buffer_size;
-  char * begin;
-  char * end;
-  unsigned long long ppid;
-
-  if (!procfs_get_process_file(pid, "status", &buffer_ptr, &buffer_size))
-  {
-    return 0;
-  }
-
-  begin = strstr(buffer_ptr, "\nPPid:\t");
-  if (begin == NULL)
-  {
-    log_error("parent pid not parsed for %llu", pid);
-    log_error("-----------------------------");
-    log_error("%s", buffer_ptr);
-    log_error("-----------------------------");
-    free(buffer_ptr);
-    return 0;
-  }
-
-  begin += 7;
-
-  end = strchr(begin, '\n');
-  if (end == NULL)
-  {
-    log_error("parent pid not parsed for %llu (end)", pid);
-    log_error("-----------------------------");
-    log_error("%s", buffer_ptr);
-    log_error("-----------------------------");
-    free(buffer_ptr);
-    return 0;
-  }
-
-  *end = 0;
-  //log_info("parent pid is %s", begin);
-
-  errno = 0;
-  ppid = strtoull(begin, &end, 10);
-  if (errno != 0)
-  {
-    log_error("strtoull failed to convert '%s' to integer", begin);
-    ppid = 0;
-  }
-  else
-  {
-    //log_info("parent pid is %llu", ppid);
-  }
-
-  /* avoid infinite cycles (should not happen because init has pid 1 and parent 0) */
-  if (ppid == pid)
-  {
-    ppid = 0;
-  }
-
-  free(buffer_ptr);
-
-  return ppid;
-}
@@ -28,6 +28,27 @@
 #define PROCFS_H__604D0D94_1609_4BB4_BFA7_5DC47830011A__INCLUDED
 
 #include "../common.h"
+#include <sys/types.h>
+
+/* /proc/PID/stat is a single line, comm is at most 16 chars */
+#define PROCFS_STAT_BUFFER_SIZE 1024
+
+struct procfs_process_stat
+{
+  unsigned long long pid;
+  unsigned long long ppid;
+  unsigned long long pgrp;
+  unsigned long long session;
+  unsigned long long start_time;  /* in clock ticks since boot, with pid identifies the process */
+  char state;
+  char comm[17];
+};
+
+/* Reads /proc/PID/stat with a single read() into a stack buffer, never allocates */
+bool
+procfs_get_process_stat(
+  unsigned long long pid,
+  struct procfs_process_stat * stat_ptr);
 
 bool
 procfs_get_process_cmdline(
@@ -39,8 +60,4 @@ char *
 procfs_get_process_cwd(
   unsigned long long pid);
 
-unsigned long long
-procfs_get_process_parent(
-  unsigned long long pid);
-
 #endif /* #ifndef PROCFS_H__604D0D94_1609_4BB4_BFA7_5DC47830011A__INCLUDED */
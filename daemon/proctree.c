@@ -0,0 +1,260 @@
+/* -*- Mode: C ; c-basic-offset: 2 -*- */
+/*
+ * LADI Session Handler (ladish)
+ *
+ * Copyright (C) 2026 ladish authors, see the AUTHORS file
+ *
+ **************************************************************************
+ * This file contains the process tree cache implementation
+ **************************************************************************
+ *
+ * LADI Session Handler is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * LADI Session Handler is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LADI Session Handler. If not, see <http://www.gnu.org/licenses/>
+ * or write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "proctree.h"
+#include "procfs.h"
+#include "../common/hash.h"
+#include "../common/slab.h"
+
+/* how many unknown ancestors are remembered in one lookup */
+#define LADISH_PROCTREE_MAX_DEPTH 64
+
+struct ladish_proctree_node
+{
+  struct ladish_hash_node pid_node;    /* link for the g_proctree_nodes hash */
+  struct list_head siblings;           /* link for the root::descendants, the g_proctree_roots or the g_proctree_unowned list */
+  struct list_head descendants;        /* only valid for roots */
+  struct ladish_proctree_node * root;  /* points to self for roots, NULL for processes that don't descend from a root */
+  pid_t pid;
+  unsigned long long start_time;       /* tells apart processes that reused the pid, 0 if unknown */
+};
+
+static struct ladish_hash g_proctree_nodes;
+static LIST_HEAD(g_proctree_roots);
+static LIST_HEAD(g_proctree_unowned);
+static struct ladish_slab g_proctree_slab = LADISH_SLAB_INIT(g_proctree_slab, struct ladish_proctree_node, 64);
+
+static struct ladish_proctree_node * ladish_proctree_find(pid_t pid)
+{
+  struct hlist_node * node_ptr;
+  struct ladish_proctree_node * proc_ptr;
+  uint32_t hash;
+
+  hash = ladish_hash_u64((uint64_t)pid);
+  ladish_hash_for_each_possible(proc_ptr, node_ptr, &g_proctree_nodes, pid_node, hash)
+  {
+    if (proc_ptr->pid == pid)
+    {
+      return proc_ptr;
+    }
+  }
+
+  return NULL;
+}
+
+static
+struct ladish_proctree_node *
+ladish_proctree_new_node(
+  pid_t pid,
+  unsigned long long start_time,
+  struct ladish_proctree_node * root_ptr,
+  struct list_head * list_ptr)
+{
+  struct ladish_proctree_node * proc_ptr;
+
+  proc_ptr = ladish_slab_alloc(&g_proctree_slab);
+  if (proc_ptr == NULL)
+  {
+    log_error("ladish_slab_alloc() failed to allocate struct ladish_proctree_node");
+    return NULL;
+  }
+
+  proc_ptr->pid = pid;
+  proc_ptr->start_time = start_time;
+  INIT_LIST_HEAD(&proc_ptr->descendants);
+  proc_ptr->root = root_ptr;
+  list_add_tail(&proc_ptr->siblings, list_ptr);
+
+  ladish_hash_add(&g_proctree_nodes, &proc_ptr->pid_node, ladish_hash_u64((uint64_t)pid));
+
+  return proc_ptr;
+}
+
+static void ladish_proctree_remove_node(struct ladish_proctree_node * proc_ptr)
+{
+  struct ladish_proctree_node * descendant_ptr;
+
+  while (!list_empty(&proc_ptr->descendants))
+  {
+    descendant_ptr = list_entry(proc_ptr->descendants.next, struct ladish_proctree_node, siblings);
+    ladish_proctree_remove_node(descendant_ptr);
+  }
+
+  list_del(&proc_ptr->siblings);
+
+  ladish_hash_del(&g_proctree_nodes, &proc_ptr->pid_node);
+  ladish_slab_free(&g_proctree_slab, proc_ptr);
+}
+
+void ladish_proctree_forget_unowned(void)
+{
+  while (!list_empty(&g_proctree_unowned))
+  {
+    ladish_proctree_remove_node(list_entry(g_proctree_unowned.next, struct ladish_proctree_node, siblings));
+  }
+}
+
+bool ladish_proctree_init(void)
+{
+  return ladish_hash_init(&g_proctree_nodes);
+}
+
+void ladish_proctree_uninit(void)
+{
+  while (!list_empty(&g_proctree_roots))
+  {
+    ladish_proctree_remove_node(list_entry(g_proctree_roots.next, struct ladish_proctree_node, siblings));
+  }
+
+  ladish_proctree_forget_unowned();
+  ladish_hash_uninit(&g_proctree_nodes);
+  ladish_slab_uninit(&g_proctree_slab);
+}
+
+bool ladish_proctree_add_root(pid_t pid)
+{
+  struct ladish_proctree_node * proc_ptr;
+  struct procfs_process_stat stat;
+
+  /* descendants of the new root may have been looked up already */
+  ladish_proctree_forget_unowned();
+
+  proc_ptr = ladish_proctree_find(pid);
+  if (proc_ptr != NULL)
+  {
+    /* the pid was reused, the cached ancestry is stale */
+    log_info("Dropping stale process tree node for pid %llu", (unsigned long long)pid);
+    ladish_proctree_remove_node(proc_ptr);
+  }
+
+  if (!procfs_get_process_stat((unsigned long long)pid, &stat))
+  {
+    stat.start_time = 0;
+  }
+
+  proc_ptr = ladish_proctree_new_node(pid, stat.start_time, NULL, &g_proctree_roots);
+  if (proc_ptr == NULL)
+  {
+    return false;
+  }
+
+  proc_ptr->root = proc_ptr;
+  return true;
+}
+
+void ladish_proctree_remove_root(pid_t pid)
+{
+  struct ladish_proctree_node * proc_ptr;
+
+  proc_ptr = ladish_proctree_find(pid);
+  if (proc_ptr == NULL || proc_ptr->root != proc_ptr)
+  {
+    /* already dropped as stale, the pid may be cached for another process now */
+    return;
+  }
+
+  ladish_proctree_remove_node(proc_ptr);
+}
+
+/* remember the walked part of the chain so next lookups don't read procfs */
+static
+void
+ladish_proctree_add_chain(
+  pid_t * pids,
+  unsigned long long * start_times,
+  unsigned int count,
+  struct ladish_proctree_node * root_ptr)
+{
+  unsigned int i;
+
+  for (i = 0; i < count; i++)
+  {
+    if (ladish_proctree_new_node(pids[i], start_times[i], root_ptr, root_ptr != NULL ? &root_ptr->descendants : &g_proctree_unowned) == NULL)
+    {
+      return;
+    }
+  }
+}
+
+pid_t ladish_proctree_find_root(pid_t pid)
+{
+  struct ladish_proctree_node * proc_ptr;
+  struct procfs_process_stat stat;
+  pid_t ancestors[LADISH_PROCTREE_MAX_DEPTH];
+  unsigned long long start_times[LADISH_PROCTREE_MAX_DEPTH];
+  unsigned int count;
+
+  proc_ptr = ladish_proctree_find(pid);
+  if (proc_ptr != NULL)
+  {
+    return proc_ptr->root != NULL ? proc_ptr->root->pid : 0;
+  }
+
+  count = 0;
+  while (pid > 1)
+  {
+    if (!procfs_get_process_stat((unsigned long long)pid, &stat))
+    {
+      return 0;
+    }
+
+    proc_ptr = count != 0 ? ladish_proctree_find(pid) : NULL;
+    if (proc_ptr != NULL &&
+        proc_ptr->start_time != 0 &&
+        proc_ptr->start_time != stat.start_time)
+    {
+      /* the cached process exited and its pid was reused */
+      log_info("Dropping stale process tree node for pid %llu", (unsigned long long)pid);
+      ladish_proctree_remove_node(proc_ptr);
+      proc_ptr = NULL;
+    }
+
+    if (proc_ptr != NULL)
+    {
+      ladish_proctree_add_chain(ancestors, start_times, count, proc_ptr->root);
+      return proc_ptr->root != NULL ? proc_ptr->root->pid : 0;
+    }
+
+    if (count < LADISH_PROCTREE_MAX_DEPTH)
+    {
+      ancestors[count] = pid;
+      start_times[count] = stat.start_time;
+      count++;
+    }
+
+    /* avoid infinite cycles (should not happen because init has pid 1 and parent 0) */
+    if ((pid_t)stat.ppid == pid)
+    {
+      break;
+    }
+
+    pid = (pid_t)stat.ppid;
+  }
+
+  /* reached init, the process does not belong to any app */
+  ladish_proctree_add_chain(ancestors, start_times, count, NULL);
+  return 0;
+}
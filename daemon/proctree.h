@@ -0,0 +1,53 @@
+/* -*- Mode: C ; c-basic-offset: 2 -*- */
+/*
+ * LADI Session Handler (ladish)
+ *
+ * Copyright (C) 2026 ladish authors, see the AUTHORS file
+ *
+ **************************************************************************
+ * This file contains the interface to the process tree cache
+ **************************************************************************
+ *
+ * LADI Session Handler is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * LADI Session Handler is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LADI Session Handler. If not, see <http://www.gnu.org/licenses/>
+ * or write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef PROCTREE_H__76A5CCB6_4385_4774_9CF1_DF50F009A739__INCLUDED
+#define PROCTREE_H__76A5CCB6_4385_4774_9CF1_DF50F009A739__INCLUDED
+
+#include "common.h"
+#include <sys/types.h>
+
+/* The process tree cache remembers the ancestry of processes that descend
+ * from children spawned by the loader (roots). Descendants are learned from
+ * procfs the first time they are looked up and are forgotten together with
+ * their root when it exits. Processes that don't descend from any root are
+ * remembered too, until the next SIGCHLD or new root. Cached pids are
+ * answered without reading procfs; while walking the ancestry of an unknown
+ * pid, cached ancestors are checked against their start time, so entries
+ * of exited processes whose pid was reused are dropped. */
+
+bool ladish_proctree_init(void);
+void ladish_proctree_uninit(void);
+bool ladish_proctree_add_root(pid_t pid);
+void ladish_proctree_remove_root(pid_t pid);
+
+/* forget the processes that were found not to descend from any root */
+void ladish_proctree_forget_unowned(void);
+
+/* returns the pid of the root the process descends from (or is), 0 if none */
+pid_t ladish_proctree_find_root(pid_t pid);
+
+#endif /* #ifndef PROCTREE_H__76A5CCB6_4385_4774_9CF1_DF50F009A739__INCLUDED */
@@ -45,31 +45,34 @@ ladish_recent_store_save(
   struct ladish_recent_store * store_ptr)
 {
   unsigned int i;
-  int fd;
+  struct ladish_writer writer;
 
-  fd = open(store_ptr->path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
-  if (fd == -1)
+  if (!ladish_writer_open(&writer, store_ptr->path))
   {
-    log_error("open(%s) failed: %d (%s)", store_ptr->path, errno, strerror(errno));
     return;
   }
 
   for (i = 0; i < store_ptr->max_items && store_ptr->items[i] != NULL; i++)
   {
-    if (!ladish_write_string(fd, store_ptr->items[i]))
+    if (!ladish_write_string(&writer, store_ptr->items[i]))
     {
       log_error("write to file '%s' failed", store_ptr->path);
       break;
     }
 
-    if (!ladish_write_string(fd, "\n"))
+    if (!ladish_write_string(&writer, "\n"))
     {
       log_error("write to file '%s' failed", store_ptr->path);
       break;
     }
   }
 
-  close(fd);
+  if (!ladish_writer_flush(&writer))
+  {
+    log_error("write to file '%s' failed", store_ptr->path);
+  }
+
+  ladish_writer_close(&writer);
 }
 
 static
@@ -290,6 +290,7 @@ ladish_room_create(
   room_ptr->project_description = NULL;
   room_ptr->project_notes = NULL;
   room_ptr->project_state = ROOM_PROJECT_STATE_UNLOADED;
+  room_ptr->modified = 0;
 
   if (template != NULL)
   {
@@ -353,6 +354,8 @@ ladish_room_create(
 
   ladish_studio_room_appeared((ladish_room_handle)room_ptr);
 
+  room_ptr->saved = ladish_modified_now();
+
   *room_handle_ptr = (ladish_room_handle)room_ptr;
   return true;
 
@@ -455,6 +458,14 @@ ladish_app_supervisor_handle ladish_room_get_app_supervisor(ladish_room_handle r
   return room_ptr->app_supervisor;
 }
 
+bool ladish_room_is_dirty(ladish_room_handle room_handle)
+{
+  return
+    room_ptr->modified > room_ptr->saved ||
+    ladish_graph_get_modified(room_ptr->graph) > room_ptr->saved ||
+    ladish_app_supervisor_get_modified(room_ptr->app_supervisor) > room_ptr->saved;
+}
+
 struct ladish_room_iterate_link_ports_context
 {
   void * context;
@@ -911,6 +922,7 @@ void ladish_room_clear_project(struct ladish_room * room_ptr)
   room_ptr->project_notes = NULL;
 
   room_ptr->project_state = ROOM_PROJECT_STATE_UNLOADED;
+  room_ptr->saved = ladish_modified_now();
   ladish_graph_dump(room_ptr->graph);
 }
 
@@ -1030,6 +1042,7 @@ static void ladish_room_dbus_set_project_description(struct cdbus_method_call *
   free(room_ptr->project_description);
   room_ptr->project_description = dup;
 
+  room_ptr->modified = ladish_modified_now();
   ladish_room_emit_project_properties_changed(room_ptr); /* increments the version number */
   cdbus_method_return_new_single(call_ptr, DBUS_TYPE_UINT64, &room_ptr->version);
 }
@@ -1063,10 +1076,19 @@ static void ladish_room_dbus_set_project_notes(struct cdbus_method_call * call_p
   free(room_ptr->project_notes);
   room_ptr->project_notes = dup;
 
+  room_ptr->modified = ladish_modified_now();
   ladish_room_emit_project_properties_changed(room_ptr); /* increments the version number */
   cdbus_method_return_new_single(call_ptr, DBUS_TYPE_UINT64, &room_ptr->version);
 }
 
+static void ladish_room_dbus_is_dirty(struct cdbus_method_call * call_ptr)
+{
+  dbus_bool_t dirty;
+
+  dirty = ladish_room_is_dirty((ladish_room_handle)room_ptr);
+  cdbus_method_return_new_single(call_ptr, DBUS_TYPE_BOOLEAN, &dirty);
+}
+
 #undef room_ptr
 
 CDBUS_METHOD_ARGS_BEGIN(GetName, "Get room name")
@@ -1100,6 +1122,10 @@ CDBUS_METHOD_ARGS_BEGIN(SetProjectNotes, "Set project notes")
   CDBUS_METHOD_ARG_DESCRIBE_OUT("new_version", DBUS_TYPE_UINT64_AS_STRING, "New version of the project properties")
 CDBUS_METHOD_ARGS_END
 
+CDBUS_METHOD_ARGS_BEGIN(IsDirty, "Check whether the project has unsaved changes")
+  CDBUS_METHOD_ARG_DESCRIBE_OUT("dirty", DBUS_TYPE_BOOLEAN_AS_STRING, "Whether the project was changed since it was last saved or loaded")
+CDBUS_METHOD_ARGS_END
+
 CDBUS_METHODS_BEGIN
   CDBUS_METHOD_DESCRIBE(GetName, ladish_room_dbus_get_name) /* sync */
   CDBUS_METHOD_DESCRIBE(SaveProject, ladish_room_dbus_save_project) /* async */
@@ -1108,6 +1134,7 @@ CDBUS_METHODS_BEGIN
   CDBUS_METHOD_DESCRIBE(GetProjectProperties, ladish_room_dbus_get_project_properties) /* sync */
   CDBUS_METHOD_DESCRIBE(SetProjectDescription, ladish_room_dbus_set_project_description) /* sync */
   CDBUS_METHOD_DESCRIBE(SetProjectNotes, ladish_room_dbus_set_project_notes) /* sync */
+  CDBUS_METHOD_DESCRIBE(IsDirty, ladish_room_dbus_is_dirty) /* sync */
 CDBUS_METHODS_END
 
 CDBUS_SIGNAL_ARGS_BEGIN(ProjectPropertiesChanged, "Project properties changed")
@@ -62,6 +62,9 @@ void ladish_room_get_uuid(ladish_room_handle room_handle, uuid_t uuid_ptr);
 ladish_graph_handle ladish_room_get_graph(ladish_room_handle room_handle);
 ladish_app_supervisor_handle ladish_room_get_app_supervisor(ladish_room_handle room_handle);
 
+/* Whether the project was changed since it was last saved, loaded or unloaded */
+bool ladish_room_is_dirty(ladish_room_handle room_handle);
+
 bool
 ladish_room_iterate_link_ports(
   ladish_room_handle room_handle,
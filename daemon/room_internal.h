@@ -61,6 +61,9 @@ struct ladish_room
   char * project_name;
   char * project_description;
   char * project_notes;
+
+  uint64_t modified;            /* modification clock value of the last project description or notes change */
+  uint64_t saved;               /* modification clock value of the last project save, load or unload */
 };
 
 void ladish_room_emit_project_properties_changed(struct ladish_room * room_ptr);
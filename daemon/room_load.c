@@ -26,7 +26,6 @@
  */
 
 #include <sys/types.h>
-#include <sys/stat.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <expat.h>
@@ -785,12 +784,8 @@ static void callback_elend(void * data, const char * UNUSED(el))
 bool ladish_room_load_project(ladish_room_handle room_handle, const char * project_dir)
 {
   char * path;
-  struct stat st;
   XML_Parser parser;
-  int bytes_read;
-  void * buffer;
   int fd;
-  enum XML_Status xmls;
   struct ladish_parse_context parse_context;
   bool ret;
 
@@ -818,12 +813,6 @@ bool ladish_room_load_project(ladish_room_handle room_handle, const char * proje
     goto exit;
   }
 
-  if (stat(path, &st) != 0)
-  {
-    log_error("failed to stat '%s': %d (%s)", path, errno, strerror(errno));
-    goto free_path;
-  }
-
   fd = open(path, O_RDONLY);
   if (fd == -1)
   {
@@ -838,27 +827,6 @@ bool ladish_room_load_project(ladish_room_handle room_handle, const char * proje
     goto close;
   }
 
-  //log_info("conf file size is %llu bytes", (unsigned long long)st.st_size);
-
-  /* we are expecting that conf file has small enough size to fit in memory */
-
-  buffer = XML_GetBuffer(parser, st.st_size);
-  if (buffer == NULL)
-  {
-    log_error("XML_GetBuffer() failed.");
-    goto free_parser;
-  }
-
-  bytes_read = read(fd, buffer, st.st_size);
-  if (bytes_read != st.st_size)
-  {
-    log_error("read() returned unexpected result.");
-    goto free_parser;
-  }
-
-  //log_info("\n----------\n%s\n-----------\n", buffer);
-  //goto free_parser;
-
   parse_context.error = XML_FALSE;
   parse_context.depth = -1;
   parse_context.str = NULL;
@@ -877,12 +845,7 @@ bool ladish_room_load_project(ladish_room_handle room_handle, const char * proje
     ladish_app_supervisor_set_project_name(room_ptr->app_supervisor, NULL);
   }
 
-  xmls = XML_ParseBuffer(parser, bytes_read, XML_TRUE);
-  if (xmls == XML_STATUS_ERROR && !parse_context.error)
-  {
-    log_error("XML_ParseBuffer() failed.");
-  }
-  if (xmls == XML_STATUS_ERROR || parse_context.error)
+  if (!ladish_parse_fd(parser, fd, path, &parse_context.error))
   {
     goto free_parser;
   }
@@ -916,6 +879,7 @@ exit:
   else
   {
     room_ptr->project_state = ROOM_PROJECT_STATE_LOADED;
+    room_ptr->saved = ladish_modified_now();
   }
 
   return ret;
@@ -956,12 +920,8 @@ static void project_name_elstart_callback(void * data, const char * el, const ch
 char * ladish_get_project_name(const char * project_dir)
 {
   char * path;
-  struct stat st;
   XML_Parser parser;
-  int bytes_read;
-  void * buffer;
   int fd;
-  enum XML_Status xmls;
   struct ladish_parse_context parse_context;
 
   parse_context.str = NULL;
@@ -973,12 +933,6 @@ char * ladish_get_project_name(const char * project_dir)
     goto exit;
   }
 
-  if (stat(path, &st) != 0)
-  {
-    log_error("failed to stat '%s': %d (%s)", path, errno, strerror(errno));
-    goto free_path;
-  }
-
   fd = open(path, O_RDONLY);
   if (fd == -1)
   {
@@ -993,34 +947,14 @@ char * ladish_get_project_name(const char * project_dir)
     goto close;
   }
 
-  /* we are expecting that conf file has small enough size to fit in memory */
-
-  buffer = XML_GetBuffer(parser, st.st_size);
-  if (buffer == NULL)
-  {
-    log_error("XML_GetBuffer() failed.");
-    goto free_parser;
-  }
-
-  bytes_read = read(fd, buffer, st.st_size);
-  if (bytes_read != st.st_size)
-  {
-    log_error("read() returned unexpected result.");
-    goto free_parser;
-  }
-
   XML_SetElementHandler(parser, project_name_elstart_callback, NULL);
   XML_SetUserData(parser, &parse_context);
 
   parse_context.parser = parser;
 
-  xmls = XML_ParseBuffer(parser, bytes_read, XML_TRUE);
-  if (xmls == XML_STATUS_ERROR)
-  {
-    log_error("XML_ParseBuffer() failed.");
-  }
+  /* the name is in the first element, parser is suspended as soon as it is found */
+  ladish_parse_fd(parser, fd, path, NULL);
 
-free_parser:
   XML_ParserFree(parser);
 close:
   close(fd);
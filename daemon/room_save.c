@@ -92,6 +92,19 @@ static void ladish_room_save_complete(struct ladish_room_save_context * ctx_ptr,
   ladish_room_save_context_destroy(ctx_ptr);
 }
 
+/* whether the project is saved to the same dir and with the same name as it was saved or loaded last time */
+static bool ladish_room_save_project_location_unchanged(struct ladish_room_save_context * ctx_ptr)
+{
+  if (ctx_ptr->old_project_dir == NULL || ctx_ptr->old_project_name == NULL)
+  {
+    return false;
+  }
+
+  return
+    strcmp(ctx_ptr->old_project_dir, ctx_ptr->room->project_dir) == 0 &&
+    strcmp(ctx_ptr->old_project_name, ctx_ptr->room->project_name) == 0;
+}
+
 static bool ladish_room_save_project_xml(struct ladish_room * room_ptr)
 {
   bool ret;
@@ -100,7 +113,7 @@ static bool ladish_room_save_project_xml(struct ladish_room * room_ptr)
   char uuid_str[37];
   char * filename;
   char * bak_filename;
-  int fd;
+  struct ladish_writer writer;
 
   time(&timestamp);
   ctime_r(&timestamp, timestamp_str);
@@ -125,86 +138,84 @@ static bool ladish_room_save_project_xml(struct ladish_room * room_ptr)
     goto free_filename;
   }
 
-  fd = open(filename, O_WRONLY | O_TRUNC | O_CREAT, 0666);
-  if (fd == -1)
+  if (!ladish_writer_open(&writer, filename))
   {
-    log_error("open(%s) failed: %d (%s)", filename, errno, strerror(errno));
     goto free_bak_filename;
   }
 
-  if (!ladish_write_string(fd, "<?xml version=\"1.0\"?>\n"))
+  if (!ladish_write_string(&writer, "<?xml version=\"1.0\"?>\n"))
   {
     goto close;
   }
 
-  if (!ladish_write_string(fd, "<!--\n"))
+  if (!ladish_write_string(&writer, "<!--\n"))
   {
     goto close;
   }
 
-  if (!ladish_write_string(fd, PROJECT_HEADER_TEXT))
+  if (!ladish_write_string(&writer, PROJECT_HEADER_TEXT))
   {
     goto close;
   }
 
-  if (!ladish_write_string(fd, "-->\n"))
+  if (!ladish_write_string(&writer, "-->\n"))
   {
     goto close;
   }
 
-  if (!ladish_write_string(fd, "<!-- "))
+  if (!ladish_write_string(&writer, "<!-- "))
   {
     goto close;
   }
 
-  if (!ladish_write_string(fd, timestamp_str))
+  if (!ladish_write_string(&writer, timestamp_str))
   {
     goto close;
   }
 
-  if (!ladish_write_string(fd, " -->\n"))
+  if (!ladish_write_string(&writer, " -->\n"))
   {
     goto close;
   }
 
-  if (!ladish_write_string(fd, "<project name=\""))
+  if (!ladish_write_string(&writer, "<project name=\""))
   {
     goto close;
   }
 
-  if (!ladish_write_string_escape(fd, room_ptr->project_name))
+  if (!ladish_write_string_escape(&writer, room_ptr->project_name))
   {
     return false;
   }
 
-  if (!ladish_write_string(fd, "\" uuid=\""))
+  if (!ladish_write_string(&writer, "\" uuid=\""))
   {
     return false;
   }
 
-  if (!ladish_write_string(fd, uuid_str))
+  if (!ladish_write_string(&writer, uuid_str))
   {
     return false;
   }
 
-  if (!ladish_write_string(fd, "\">\n"))
+  if (!ladish_write_string(&writer, "\">\n"))
   {
     goto close;
   }
 
   if (room_ptr->project_description != NULL)
   {
-    if (!ladish_write_indented_string(fd, 1, "<description>"))
+    if (!ladish_write_indented_string(&writer, 1, "<description>"))
     {
       goto close;
     }
 
-    if (!ladish_write_string_escape(fd, room_ptr->project_description))
+    if (!ladish_write_string_escape(&writer, room_ptr->project_description))
     {
       goto close;
     }
 
-    if (!ladish_write_string(fd, "</description>\n"))
+    if (!ladish_write_string(&writer, "</description>\n"))
     {
       goto close;
     }
@@ -212,66 +223,71 @@ static bool ladish_room_save_project_xml(struct ladish_room * room_ptr)
 
   if (room_ptr->project_notes != NULL)
   {
-    if (!ladish_write_indented_string(fd, 1, "<notes>"))
+    if (!ladish_write_indented_string(&writer, 1, "<notes>"))
     {
       goto close;
     }
 
-    if (!ladish_write_string_escape(fd, room_ptr->project_notes))
+    if (!ladish_write_string_escape(&writer, room_ptr->project_notes))
     {
       goto close;
     }
 
-    if (!ladish_write_string(fd, "</notes>\n"))
+    if (!ladish_write_string(&writer, "</notes>\n"))
     {
       goto close;
     }
   }
 
-  if (!ladish_write_indented_string(fd, 1, "<room>\n"))
+  if (!ladish_write_indented_string(&writer, 1, "<room>\n"))
   {
     goto close;
   }
 
-  if (!ladish_write_room_link_ports(fd, 2, (ladish_room_handle)room_ptr))
+  if (!ladish_write_room_link_ports(&writer, 2, (ladish_room_handle)room_ptr))
   {
     log_error("ladish_write_room_link_ports() failed");
     return false;
   }
 
-  if (!ladish_write_indented_string(fd, 1, "</room>\n"))
+  if (!ladish_write_indented_string(&writer, 1, "</room>\n"))
   {
     goto close;
   }
 
-  if (!ladish_write_indented_string(fd, 1, "<jack>\n"))
+  if (!ladish_write_indented_string(&writer, 1, "<jack>\n"))
   {
     goto close;
   }
 
-  if (!ladish_write_jgraph(fd, 2, room_ptr->graph, room_ptr->app_supervisor))
+  if (!ladish_write_jgraph(&writer, 2, room_ptr->graph, room_ptr->app_supervisor))
   {
     log_error("ladish_write_jgraph() failed for room graph");
     goto close;
   }
 
-  if (!ladish_write_indented_string(fd, 1, "</jack>\n"))
+  if (!ladish_write_indented_string(&writer, 1, "</jack>\n"))
   {
     goto close;
   }
 
-  if (!ladish_write_vgraph(fd, 1, room_ptr->graph, room_ptr->app_supervisor))
+  if (!ladish_write_vgraph(&writer, 1, room_ptr->graph, room_ptr->app_supervisor))
   {
     log_error("ladish_write_vgraph() failed for studio");
     goto close;
   }
 
-  if (!ladish_write_dict(fd, 1, ladish_graph_get_dict(room_ptr->graph)))
+  if (!ladish_write_dict(&writer, 1, ladish_graph_get_dict(room_ptr->graph)))
   {
     goto close;
   }
 
-  if (!ladish_write_string(fd, "</project>\n"))
+  if (!ladish_write_string(&writer, "</project>\n"))
+  {
+    goto close;
+  }
+
+  if (!ladish_writer_flush(&writer))
   {
     goto close;
   }
@@ -279,7 +295,7 @@ static bool ladish_room_save_project_xml(struct ladish_room * room_ptr)
   ret = true;
 
 close:
-  close(fd);
+  ladish_writer_close(&writer);
 free_bak_filename:
   free(bak_filename);
 free_filename:
@@ -300,6 +316,14 @@ static void ladish_room_apps_save_complete(void * context, bool success)
     return;
   }
 
+  if (ladish_room_save_project_location_unchanged(ctx_ptr) &&
+      !ladish_room_is_dirty((ladish_room_handle)ctx_ptr->room))
+  {
+    log_info("Project '%s' in room '%s' is not modified, skipping the project xml write", ctx_ptr->room->project_name, ctx_ptr->room->name);
+    ladish_room_save_complete(ctx_ptr, true);
+    return;
+  }
+
   if (!ladish_room_save_project_xml(ctx_ptr->room))
   {
     ladish_room_save_complete(ctx_ptr, false);
@@ -310,6 +334,7 @@ static void ladish_room_apps_save_complete(void * context, bool success)
   ladish_room_emit_project_properties_changed(ctx_ptr->room);
 
   ctx_ptr->room->project_state = ROOM_PROJECT_STATE_LOADED;
+  ctx_ptr->room->saved = ladish_modified_now();
 
   ladish_room_save_complete(ctx_ptr, true);
 }
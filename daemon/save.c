@@ -25,14 +25,19 @@
  */
 
 #include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
 
 #include "save.h"
 #include "escape.h"
 #include "studio.h"
+#include "loop.h"
+#include "../common/catdup.h"
 
 struct ladish_write_vgraph_context
 {
-  int fd;
+  struct ladish_writer * writer;
   int indent;
   ladish_app_supervisor_handle app_supervisor;
   bool client_visible;
@@ -68,71 +73,212 @@ is_hidden_port_interesting(
   return !ladish_app_is_running(app);
 }
 
-bool ladish_write_string(int fd, const char * string)
+#define LADISH_WRITER_BUFFER_SIZE (64 * 1024)
+
+static bool ladish_writer_init(struct ladish_writer * writer, int fd)
 {
-  size_t len;
-  ssize_t ret;
+  writer->buffer = malloc(LADISH_WRITER_BUFFER_SIZE);
+  if (writer->buffer == NULL)
+  {
+    log_error("malloc() failed to allocate write buffer");
+    return false;
+  }
+
+  writer->fd = fd;
+  writer->size = LADISH_WRITER_BUFFER_SIZE;
+  writer->used = 0;
+  writer->escape_buffer = NULL;
+  writer->escape_buffer_size = 0;
 
-  len = strlen(string);
+  return true;
+}
 
-  ret = write(fd, string, len);
-  if (ret == -1)
+bool ladish_writer_open(struct ladish_writer * writer, const char * path)
+{
+  int fd;
+
+  fd = open(path, O_WRONLY | O_TRUNC | O_CREAT, 0666);
+  if (fd == -1)
   {
-    log_error("write(%d, \"%s\", %zu) failed to write file: %d (%s)", fd, string, len, errno, strerror(errno));
+    log_error("open(%s) failed: %d (%s)", path, errno, strerror(errno));
     return false;
   }
-  if ((size_t)ret != len)
+
+  if (!ladish_writer_init(writer, fd))
   {
-    log_error("write() wrote wrong byte count to file (%zd != %zu).", ret, len);
+    close(fd);
     return false;
   }
 
   return true;
 }
 
-bool ladish_write_indented_string(int fd, int indent, const char * string)
+bool ladish_writer_open_memory(struct ladish_writer * writer)
 {
-  ASSERT(indent >= 0);
-  while (indent--)
+  return ladish_writer_init(writer, -1);
+}
+
+static bool ladish_write_fd(int fd, const char * data, size_t len)
+{
+  ssize_t ret;
+
+  while (len > 0)
   {
-    if (!ladish_write_string(fd, LADISH_XML_BASE_INDENT))
+    ret = write(fd, data, len);
+    if (ret == -1)
     {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+
+      log_error("write(%d, %zu) failed to write file: %d (%s)", fd, len, errno, strerror(errno));
       return false;
     }
+
+    data += ret;
+    len -= ret;
+  }
+
+  return true;
+}
+
+bool ladish_writer_flush(struct ladish_writer * writer)
+{
+  bool ret;
+
+  if (writer->fd == -1)
+  { /* memory writer keeps everything */
+    return true;
+  }
+
+  ret = ladish_write_fd(writer->fd, writer->buffer, writer->used);
+  writer->used = 0;
+  return ret;
+}
+
+void ladish_writer_close(struct ladish_writer * writer)
+{
+  if (writer->fd != -1)
+  {
+    close(writer->fd);
+  }
+
+  free(writer->buffer);
+  free(writer->escape_buffer);
+}
+
+/* After success, the data fits in the buffer unless it is bigger than the buffer of a file writer */
+static bool ladish_writer_make_room(struct ladish_writer * writer, size_t len)
+{
+  size_t size;
+  char * buffer;
+
+  if (writer->used + len <= writer->size)
+  {
+    return true;
+  }
+
+  if (writer->fd != -1)
+  {
+    return ladish_writer_flush(writer);
+  }
+
+  size = writer->size;
+  while (size < writer->used + len)
+  {
+    size *= 2;
   }
 
-  if (!ladish_write_string(fd, string))
+  buffer = realloc(writer->buffer, size);
+  if (buffer == NULL)
   {
+    log_error("realloc() failed to grow write buffer to %zu bytes", size);
     return false;
   }
 
+  writer->buffer = buffer;
+  writer->size = size;
   return true;
 }
 
-bool ladish_write_string_escape_ex(int fd, const char * string, unsigned int flags)
+static bool ladish_writer_append(struct ladish_writer * writer, const char * data, size_t len)
 {
-  bool ret;
-  char * escaped_buffer;
+  if (!ladish_writer_make_room(writer, len))
+  {
+    return false;
+  }
 
-  escaped_buffer = malloc(max_escaped_length(strlen(string)));
-  if (escaped_buffer == NULL)
+  if (writer->used + len > writer->size)
+  {
+    return ladish_write_fd(writer->fd, data, len);
+  }
+
+  memcpy(writer->buffer + writer->used, data, len);
+  writer->used += len;
+  return true;
+}
+
+bool ladish_write_string(struct ladish_writer * writer, const char * string)
+{
+  return ladish_writer_append(writer, string, strlen(string));
+}
+
+bool ladish_write_indented_string(struct ladish_writer * writer, int indent, const char * string)
+{
+  ASSERT(indent >= 0);
+  while (indent--)
+  {
+    if (!ladish_writer_append(writer, LADISH_XML_BASE_INDENT, sizeof(LADISH_XML_BASE_INDENT) - 1))
+    {
+      return false;
+    }
+  }
+
+  return ladish_write_string(writer, string);
+}
+
+bool ladish_write_string_escape_ex(struct ladish_writer * writer, const char * string, unsigned int flags)
+{
+  size_t max_len;
+  char * dst;
+  char * escape_buffer;
+
+  max_len = max_escaped_length(strlen(string));
+
+  if (!ladish_writer_make_room(writer, max_len))
   {
-    log_error("malloc() failed to allocate buffer for escaped string");
     return false;
   }
 
-  escape_simple(string, escaped_buffer, flags);
+  if (writer->used + max_len <= writer->size)
+  { /* escape directly into the write buffer */
+    dst = writer->buffer + writer->used;
+    escape(&string, &dst, flags);
+    writer->used = dst - writer->buffer;
+    return true;
+  }
 
-  ret = ladish_write_string(fd, escaped_buffer);
+  if (max_len + 1 > writer->escape_buffer_size)
+  {
+    escape_buffer = realloc(writer->escape_buffer, max_len + 1);
+    if (escape_buffer == NULL)
+    {
+      log_error("realloc() failed to allocate buffer for escaped string");
+      return false;
+    }
 
-  free(escaped_buffer);
+    writer->escape_buffer = escape_buffer;
+    writer->escape_buffer_size = max_len + 1;
+  }
 
-  return ret;
+  escape_simple(string, writer->escape_buffer, flags);
+  return ladish_write_fd(writer->fd, writer->escape_buffer, strlen(writer->escape_buffer));
 }
 
-bool ladish_write_string_escape(int fd, const char * string)
+bool ladish_write_string_escape(struct ladish_writer * writer, const char * string)
 {
-  return ladish_write_string_escape_ex(fd, string, LADISH_ESCAPE_FLAG_ALL);
+  return ladish_write_string_escape_ex(writer, string, LADISH_ESCAPE_FLAG_ALL);
 }
 
 static
@@ -150,7 +296,7 @@ static bool ladish_port_dict_is_empty(ladish_dict_handle dict)
   return ladish_dict_iterate(dict, NULL, ladish_port_dict_ignored_keys_check);
 }
 
-#define fd (((struct ladish_write_context *)context)->fd)
+#define writer (((struct ladish_write_context *)context)->writer)
 #define indent (((struct ladish_write_context *)context)->indent)
 
 static
@@ -160,27 +306,27 @@ write_dict_entry(
   const char * key,
   const char * value)
 {
-  if (!ladish_write_indented_string(fd, indent, "<key name=\""))
+  if (!ladish_write_indented_string(writer, indent, "<key name=\""))
   {
     return false;
   }
 
-  if (!ladish_write_string(fd, key))
+  if (!ladish_write_string(writer, key))
   {
     return false;
   }
 
-  if (!ladish_write_string(fd, "\">"))
+  if (!ladish_write_string(writer, "\">"))
   {
     return false;
   }
 
-  if (!ladish_write_string(fd, value))
+  if (!ladish_write_string(writer, value))
   {
     return false;
   }
 
-  if (!ladish_write_string(fd, "</key>\n"))
+  if (!ladish_write_string(writer, "</key>\n"))
   {
     return false;
   }
@@ -220,42 +366,42 @@ ladish_write_room_port(
 
   log_info("saving room %s %s port '%s' (%s)", direction_str, type_str, name, str);
 
-  if (!ladish_write_indented_string(fd, indent, "<port name=\""))
+  if (!ladish_write_indented_string(writer, indent, "<port name=\""))
   {
     return false;
   }
 
-  if (!ladish_write_string_escape_ex(fd, name, LADISH_ESCAPE_FLAG_XML_ATTR))
+  if (!ladish_write_string_escape_ex(writer, name, LADISH_ESCAPE_FLAG_XML_ATTR))
   {
     return false;
   }
 
-  if (!ladish_write_string(fd, "\" uuid=\""))
+  if (!ladish_write_string(writer, "\" uuid=\""))
   {
     return false;
   }
 
-  if (!ladish_write_string(fd, str))
+  if (!ladish_write_string(writer, str))
   {
     return false;
   }
 
-  if (!ladish_write_string(fd, "\" type=\""))
+  if (!ladish_write_string(writer, "\" type=\""))
   {
     return false;
   }
 
-  if (!ladish_write_string(fd, type_str))
+  if (!ladish_write_string(writer, type_str))
   {
     return false;
   }
 
-  if (!ladish_write_string(fd, "\" direction=\""))
+  if (!ladish_write_string(writer, "\" direction=\""))
   {
     return false;
   }
 
-  if (!ladish_write_string(fd, direction_str))
+  if (!ladish_write_string(writer, direction_str))
   {
     return false;
   }
@@ -263,24 +409,24 @@ ladish_write_room_port(
   dict = ladish_port_get_dict(port);
   if (ladish_port_dict_is_empty(dict))
   {
-    if (!ladish_write_string(fd, "\" />\n"))
+    if (!ladish_write_string(writer, "\" />\n"))
     {
       return false;
     }
   }
   else
   {
-    if (!ladish_write_string(fd, "\">\n"))
+    if (!ladish_write_string(writer, "\">\n"))
     {
       return false;
     }
 
-    if (!ladish_write_dict(fd, indent + 1, dict))
+    if (!ladish_write_dict(writer, indent + 1, dict))
     {
       return false;
     }
 
-    if (!ladish_write_indented_string(fd, indent, "</port>\n"))
+    if (!ladish_write_indented_string(writer, indent, "</port>\n"))
     {
       return false;
     }
@@ -290,9 +436,9 @@ ladish_write_room_port(
 }
 
 #undef indent
-#undef fd
+#undef writer
 
-bool ladish_write_dict(int fd, int indent, ladish_dict_handle dict)
+bool ladish_write_dict(struct ladish_writer * writer, int indent, ladish_dict_handle dict)
 {
   struct ladish_write_context context;
   ladish_dict_handle dict_dup;
@@ -322,10 +468,10 @@ bool ladish_write_dict(int fd, int indent, ladish_dict_handle dict)
     goto dup_destroy;
   }
 
-  context.fd = fd;
+  context.writer = writer;
   context.indent = indent + 1;
 
-  if (!ladish_write_indented_string(fd, indent, "<dict>\n"))
+  if (!ladish_write_indented_string(writer, indent, "<dict>\n"))
   {
     ret = false;
     goto dup_destroy;
@@ -337,7 +483,7 @@ bool ladish_write_dict(int fd, int indent, ladish_dict_handle dict)
     goto dup_destroy;
   }
 
-  if (!ladish_write_indented_string(fd, indent, "</dict>\n"))
+  if (!ladish_write_indented_string(writer, indent, "</dict>\n"))
   {
     ret = false;
     goto dup_destroy;
@@ -354,13 +500,13 @@ dup_destroy:
   return ret;
 }
 
-bool ladish_write_room_link_ports(int fd, int indent, ladish_room_handle room)
+bool ladish_write_room_link_ports(struct ladish_writer * writer, int indent, ladish_room_handle room)
 {
   struct ladish_write_context context;
 
   ladish_check_integrity();
 
-  context.fd = fd;
+  context.writer = writer;
   context.indent = indent;
 
   if (!ladish_room_iterate_link_ports(room, &context, ladish_write_room_port))
@@ -376,7 +522,7 @@ bool ladish_write_room_link_ports(int fd, int indent, ladish_room_handle room)
 /* write vgraph */
 /****************/
 
-#define fd (((struct ladish_write_vgraph_context *)context)->fd)
+#define writer (((struct ladish_write_vgraph_context *)context)->writer)
 #define indent (((struct ladish_write_vgraph_context *)context)->indent)
 #define ctx_ptr ((struct ladish_write_vgraph_context *)context)
 
@@ -419,32 +565,32 @@ ladish_save_vgraph_client_begin(
 
   log_info("saving vgraph client '%s' (%s)", client_name, str);
 
-  if (!ladish_write_indented_string(fd, indent, "<client name=\""))
+  if (!ladish_write_indented_string(writer, indent, "<client name=\""))
   {
     return false;
   }
 
-  if (!ladish_write_string_escape_ex(fd, client_name, LADISH_ESCAPE_FLAG_XML_ATTR))
+  if (!ladish_write_string_escape_ex(writer, client_name, LADISH_ESCAPE_FLAG_XML_ATTR))
   {
     return false;
   }
 
-  if (!ladish_write_string(fd, "\" uuid=\""))
+  if (!ladish_write_string(writer, "\" uuid=\""))
   {
     return false;
   }
 
-  if (!ladish_write_string(fd, str))
+  if (!ladish_write_string(writer, str))
   {
     return false;
   }
 
-  if (!ladish_write_string(fd, "\" naming=\""))
+  if (!ladish_write_string(writer, "\" naming=\""))
   {
     return false;
   }
 
-  if (!ladish_write_string(fd, "app"))
+  if (!ladish_write_string(writer, "app"))
   {
     return false;
   }
@@ -453,23 +599,23 @@ ladish_save_vgraph_client_begin(
   {
     uuid_unparse(app_uuid, app_str);
 
-    if (!ladish_write_string(fd, "\" app=\""))
+    if (!ladish_write_string(writer, "\" app=\""))
     {
       return false;
     }
 
-    if (!ladish_write_string(fd, app_str))
+    if (!ladish_write_string(writer, app_str))
     {
       return false;
     }
   }
 
-  if (!ladish_write_string(fd, "\">\n"))
+  if (!ladish_write_string(writer, "\">\n"))
   {
     return false;
   }
 
-  if (!ladish_write_indented_string(fd, indent + 1, "<ports>\n"))
+  if (!ladish_write_indented_string(writer, indent + 1, "<ports>\n"))
   {
     return false;
   }
@@ -492,17 +638,17 @@ ladish_save_vgraph_client_end(
     return true;
   }
 
-  if (!ladish_write_indented_string(fd, indent + 1, "</ports>\n"))
+  if (!ladish_write_indented_string(writer, indent + 1, "</ports>\n"))
   {
     return false;
   }
 
-  if (!ladish_write_dict(fd, indent + 1, ladish_client_get_dict(client_handle)))
+  if (!ladish_write_dict(writer, indent + 1, ladish_client_get_dict(client_handle)))
   {
     return false;
   }
 
-  if (!ladish_write_indented_string(fd, indent, "</client>\n"))
+  if (!ladish_write_indented_string(writer, indent, "</client>\n"))
   {
     return false;
   }
@@ -582,54 +728,54 @@ ladish_save_vgraph_port(
     log_info("saving vgraph port '%s':'%s' (%s)", client_name, port_name, str);
   }
 
-  if (!ladish_write_indented_string(fd, indent + 2, "<port name=\""))
+  if (!ladish_write_indented_string(writer, indent + 2, "<port name=\""))
   {
     return false;
   }
 
-  if (!ladish_write_string_escape_ex(fd, port_name, LADISH_ESCAPE_FLAG_XML_ATTR))
+  if (!ladish_write_string_escape_ex(writer, port_name, LADISH_ESCAPE_FLAG_XML_ATTR))
   {
     return false;
   }
 
-  if (!ladish_write_string(fd, "\" uuid=\""))
+  if (!ladish_write_string(writer, "\" uuid=\""))
   {
     return false;
   }
 
-  if (!ladish_write_string(fd, str))
+  if (!ladish_write_string(writer, str))
   {
     return false;
   }
 
-  if (!ladish_write_string(fd, "\" type=\""))
+  if (!ladish_write_string(writer, "\" type=\""))
   {
     return false;
   }
 
-  if (!ladish_write_string(fd, port_type == JACKDBUS_PORT_TYPE_AUDIO ? "audio" : "midi"))
+  if (!ladish_write_string(writer, port_type == JACKDBUS_PORT_TYPE_AUDIO ? "audio" : "midi"))
   {
     return false;
   }
 
-  if (!ladish_write_string(fd, "\" direction=\""))
+  if (!ladish_write_string(writer, "\" direction=\""))
   {
     return false;
   }
 
-  if (!ladish_write_string(fd, JACKDBUS_PORT_IS_INPUT(port_flags) ? "input" : "output"))
+  if (!ladish_write_string(writer, JACKDBUS_PORT_IS_INPUT(port_flags) ? "input" : "output"))
   {
     return false;
   }
 
   if (link)
   {
-    if (!ladish_write_string(fd, "\" link_uuid=\""))
+    if (!ladish_write_string(writer, "\" link_uuid=\""))
     {
       return false;
     }
 
-    if (!ladish_write_string(fd, link_str))
+    if (!ladish_write_string(writer, link_str))
     {
       return false;
     }
@@ -638,24 +784,24 @@ ladish_save_vgraph_port(
   dict = ladish_port_get_dict(port_handle);
   if (ladish_port_dict_is_empty(dict))
   {
-    if (!ladish_write_string(fd, "\" />\n"))
+    if (!ladish_write_string(writer, "\" />\n"))
     {
       return false;
     }
   }
   else
   {
-    if (!ladish_write_string(fd, "\">\n"))
+    if (!ladish_write_string(writer, "\">\n"))
     {
       return false;
     }
 
-    if (!ladish_write_dict(fd, indent + 3, dict))
+    if (!ladish_write_dict(writer, indent + 3, dict))
     {
       return false;
     }
 
-    if (!ladish_write_indented_string(fd, indent + 2, "</port>\n"))
+    if (!ladish_write_indented_string(writer, indent + 2, "</port>\n"))
     {
       return false;
     }
@@ -693,7 +839,7 @@ ladish_save_vgraph_connection(
 
   log_info("saving vgraph connection");
 
-  if (!ladish_write_indented_string(fd, indent, "<connection port1=\""))
+  if (!ladish_write_indented_string(writer, indent, "<connection port1=\""))
   {
     return false;
   }
@@ -701,12 +847,12 @@ ladish_save_vgraph_connection(
   ladish_get_vgraph_port_uuids(graph, port1, uuid, NULL);
   uuid_unparse(uuid, str);
 
-  if (!ladish_write_string(fd, str))
+  if (!ladish_write_string(writer, str))
   {
     return false;
   }
 
-  if (!ladish_write_string(fd, "\" port2=\""))
+  if (!ladish_write_string(writer, "\" port2=\""))
   {
     return false;
   }
@@ -714,31 +860,31 @@ ladish_save_vgraph_connection(
   ladish_get_vgraph_port_uuids(graph, port2, uuid, NULL);
   uuid_unparse(uuid, str);
 
-  if (!ladish_write_string(fd, str))
+  if (!ladish_write_string(writer, str))
   {
     return false;
   }
 
   if (ladish_dict_is_empty(dict))
   {
-    if (!ladish_write_string(fd, "\" />\n"))
+    if (!ladish_write_string(writer, "\" />\n"))
     {
       return false;
     }
   }
   else
   {
-    if (!ladish_write_string(fd, "\">\n"))
+    if (!ladish_write_string(writer, "\">\n"))
     {
       return false;
     }
 
-    if (!ladish_write_dict(fd, indent + 1, dict))
+    if (!ladish_write_dict(writer, indent + 1, dict))
     {
       return false;
     }
 
-    if (!ladish_write_indented_string(fd, indent, "</connection>\n"))
+    if (!ladish_write_indented_string(writer, indent, "</connection>\n"))
     {
       return false;
     }
@@ -778,7 +924,7 @@ ladish_save_app(
     goto exit;
   }
 
-  if (!ladish_write_indented_string(fd, indent, "<application name=\""))
+  if (!ladish_write_indented_string(writer, indent, "<application name=\""))
   {
     goto free_buffer;
   }
@@ -787,52 +933,52 @@ ladish_save_app(
   escaped_string = escaped_buffer;
   escape(&unescaped_string, &escaped_string, LADISH_ESCAPE_FLAG_ALL);
   *escaped_string = 0;
-  if (!ladish_write_string(fd, escaped_buffer))
+  if (!ladish_write_string(writer, escaped_buffer))
   {
     goto free_buffer;
   }
 
-  if (!ladish_write_string(fd, "\" uuid=\""))
+  if (!ladish_write_string(writer, "\" uuid=\""))
   {
     return false;
   }
 
-  if (!ladish_write_string(fd, str))
+  if (!ladish_write_string(writer, str))
   {
     return false;
   }
 
-  if (!ladish_write_string(fd, "\" terminal=\""))
+  if (!ladish_write_string(writer, "\" terminal=\""))
   {
     goto free_buffer;
   }
 
-  if (!ladish_write_string(fd, terminal ? "true" : "false"))
+  if (!ladish_write_string(writer, terminal ? "true" : "false"))
   {
     goto free_buffer;
   }
 
-  if (!ladish_write_string(fd, "\" level=\""))
+  if (!ladish_write_string(writer, "\" level=\""))
   {
     goto free_buffer;
   }
 
-  if (!ladish_write_string(fd, level))
+  if (!ladish_write_string(writer, level))
   {
     goto free_buffer;
   }
 
-  if (!ladish_write_string(fd, "\" autorun=\""))
+  if (!ladish_write_string(writer, "\" autorun=\""))
   {
     goto free_buffer;
   }
 
-  if (!ladish_write_string(fd, running ? "true" : "false"))
+  if (!ladish_write_string(writer, running ? "true" : "false"))
   {
     goto free_buffer;
   }
 
-  if (!ladish_write_string(fd, "\">"))
+  if (!ladish_write_string(writer, "\">"))
   {
     goto free_buffer;
   }
@@ -841,12 +987,12 @@ ladish_save_app(
   escaped_string = escaped_buffer;
   escape(&unescaped_string, &escaped_string, LADISH_ESCAPE_FLAG_ALL);
   *escaped_string = 0;
-  if (!ladish_write_string(fd, escaped_buffer))
+  if (!ladish_write_string(writer, escaped_buffer))
   {
     goto free_buffer;
   }
 
-  if (!ladish_write_string(fd, "</application>\n"))
+  if (!ladish_write_string(writer, "</application>\n"))
   {
     goto free_buffer;
   }
@@ -862,19 +1008,19 @@ exit:
 
 #undef ctx_ptr
 #undef indent
-#undef fd
+#undef writer
 
-bool ladish_write_vgraph(int fd, int indent, ladish_graph_handle vgraph, ladish_app_supervisor_handle app_supervisor)
+bool ladish_write_vgraph(struct ladish_writer * writer, int indent, ladish_graph_handle vgraph, ladish_app_supervisor_handle app_supervisor)
 {
   struct ladish_write_vgraph_context context;
 
   ladish_check_integrity();
 
-  context.fd = fd;
+  context.writer = writer;
   context.indent = indent + 1;
   context.app_supervisor = app_supervisor;
 
-  if (!ladish_write_indented_string(fd, indent, "<clients>\n"))
+  if (!ladish_write_indented_string(writer, indent, "<clients>\n"))
   {
     return false;
   }
@@ -890,12 +1036,12 @@ bool ladish_write_vgraph(int fd, int indent, ladish_graph_handle vgraph, ladish_
     return false;
   }
 
-  if (!ladish_write_indented_string(fd, indent, "</clients>\n"))
+  if (!ladish_write_indented_string(writer, indent, "</clients>\n"))
   {
     return false;
   }
 
-  if (!ladish_write_indented_string(fd, indent, "<connections>\n"))
+  if (!ladish_write_indented_string(writer, indent, "<connections>\n"))
   {
     return false;
   }
@@ -906,12 +1052,12 @@ bool ladish_write_vgraph(int fd, int indent, ladish_graph_handle vgraph, ladish_
     return false;
   }
 
-  if (!ladish_write_indented_string(fd, indent, "</connections>\n"))
+  if (!ladish_write_indented_string(writer, indent, "</connections>\n"))
   {
     return false;
   }
 
-  if (!ladish_write_indented_string(fd, indent, "<applications>\n"))
+  if (!ladish_write_indented_string(writer, indent, "<applications>\n"))
   {
     return false;
   }
@@ -921,7 +1067,7 @@ bool ladish_write_vgraph(int fd, int indent, ladish_graph_handle vgraph, ladish_
     return false;
   }
 
-  if (!ladish_write_indented_string(fd, indent, "</applications>\n"))
+  if (!ladish_write_indented_string(writer, indent, "</applications>\n"))
   {
     return false;
   }
@@ -935,7 +1081,7 @@ bool ladish_write_vgraph(int fd, int indent, ladish_graph_handle vgraph, ladish_
 
 struct ladish_write_jack_context
 {
-  int fd;
+  struct ladish_writer * writer;
   int indent;
   ladish_graph_handle vgraph_filter;
   ladish_app_supervisor_handle app_supervisor;
@@ -944,7 +1090,7 @@ struct ladish_write_jack_context
   bool client_visible;
 };
 
-static bool ladish_save_jack_client_write_prolog(int fd, int indent, ladish_client_handle client_handle, const char * client_name)
+static bool ladish_save_jack_client_write_prolog(struct ladish_writer * writer, int indent, ladish_client_handle client_handle, const char * client_name)
 {
   uuid_t uuid;
   char str[37];
@@ -954,32 +1100,32 @@ static bool ladish_save_jack_client_write_prolog(int fd, int indent, ladish_clie
 
   log_info("saving jack client '%s' (%s)", client_name, str);
 
-  if (!ladish_write_indented_string(fd, indent, "<client name=\""))
+  if (!ladish_write_indented_string(writer, indent, "<client name=\""))
   {
     return false;
   }
 
-  if (!ladish_write_string_escape_ex(fd, client_name, LADISH_ESCAPE_FLAG_XML_ATTR))
+  if (!ladish_write_string_escape_ex(writer, client_name, LADISH_ESCAPE_FLAG_XML_ATTR))
   {
     return false;
   }
 
-  if (!ladish_write_string(fd, "\" uuid=\""))
+  if (!ladish_write_string(writer, "\" uuid=\""))
   {
     return false;
   }
 
-  if (!ladish_write_string(fd, str))
+  if (!ladish_write_string(writer, str))
   {
     return false;
   }
 
-  if (!ladish_write_string(fd, "\">\n"))
+  if (!ladish_write_string(writer, "\">\n"))
   {
     return false;
   }
 
-  if (!ladish_write_indented_string(fd, indent + 1, "<ports>\n"))
+  if (!ladish_write_indented_string(writer, indent + 1, "<ports>\n"))
   {
     return false;
   }
@@ -987,7 +1133,7 @@ static bool ladish_save_jack_client_write_prolog(int fd, int indent, ladish_clie
   return true;
 }
 
-#define fd (((struct ladish_write_jack_context *)context)->fd)
+#define writer (((struct ladish_write_jack_context *)context)->writer)
 #define indent (((struct ladish_write_jack_context *)context)->indent)
 #define ctx_ptr ((struct ladish_write_jack_context *)context)
 
@@ -1020,7 +1166,7 @@ ladish_save_jack_client_begin(
     return true;
   }
 
-  return ladish_save_jack_client_write_prolog(fd, indent, client_handle, client_name);
+  return ladish_save_jack_client_write_prolog(writer, indent, client_handle, client_name);
 }
 
 static
@@ -1038,12 +1184,12 @@ ladish_save_jack_client_end(
     return true;
   }
 
-  if (!ladish_write_indented_string(fd, indent + 1, "</ports>\n"))
+  if (!ladish_write_indented_string(writer, indent + 1, "</ports>\n"))
   {
     return false;
   }
 
-  if (!ladish_write_indented_string(fd, indent, "</client>\n"))
+  if (!ladish_write_indented_string(writer, indent, "</client>\n"))
   {
     return false;
   }
@@ -1078,7 +1224,7 @@ ladish_save_jack_port(
   {
     if (!ctx_ptr->client_visible)
     {
-      if (!ladish_save_jack_client_write_prolog(fd, indent, client_handle, client_name))
+      if (!ladish_save_jack_client_write_prolog(writer, indent, client_handle, client_name))
       {
         return false;
       }
@@ -1104,27 +1250,27 @@ ladish_save_jack_port(
 
   log_info("saving jack port '%s':'%s' (%s)", client_name, port_name, str);
 
-  if (!ladish_write_indented_string(fd, indent + 2, "<port name=\""))
+  if (!ladish_write_indented_string(writer, indent + 2, "<port name=\""))
   {
     return false;
   }
 
-  if (!ladish_write_string_escape_ex(fd, port_name, LADISH_ESCAPE_FLAG_XML_ATTR))
+  if (!ladish_write_string_escape_ex(writer, port_name, LADISH_ESCAPE_FLAG_XML_ATTR))
   {
     return false;
   }
 
-  if (!ladish_write_string(fd, "\" uuid=\""))
+  if (!ladish_write_string(writer, "\" uuid=\""))
   {
     return false;
   }
 
-  if (!ladish_write_string(fd, str))
+  if (!ladish_write_string(writer, str))
   {
     return false;
   }
 
-  if (!ladish_write_string(fd, "\" />\n"))
+  if (!ladish_write_string(writer, "\" />\n"))
   {
     return false;
   }
@@ -1134,20 +1280,20 @@ ladish_save_jack_port(
 
 #undef ctx_ptr
 #undef indent
-#undef fd
+#undef writer
 
-bool ladish_write_jgraph(int fd, int indent, ladish_graph_handle vgraph, ladish_app_supervisor_handle app_supervisor)
+bool ladish_write_jgraph(struct ladish_writer * writer, int indent, ladish_graph_handle vgraph, ladish_app_supervisor_handle app_supervisor)
 {
   struct ladish_write_jack_context context;
 
   ladish_check_integrity();
 
-  if (!ladish_write_indented_string(fd, indent, "<clients>\n"))
+  if (!ladish_write_indented_string(writer, indent, "<clients>\n"))
   {
     return false;
   }
 
-  context.fd = fd;
+  context.writer = writer;
   context.indent = indent + 1;
   context.vgraph_filter = vgraph;
   context.app_supervisor = app_supervisor;
@@ -1163,10 +1309,276 @@ bool ladish_write_jgraph(int fd, int indent, ladish_graph_handle vgraph, ladish_
     return false;
   }
 
-  if (!ladish_write_indented_string(fd, indent, "</clients>\n"))
+  if (!ladish_write_indented_string(writer, indent, "</clients>\n"))
   {
     return false;
   }
 
   return true;
 }
+
+struct ladish_save_job
+{
+  pthread_t thread;
+  bool threaded;
+  struct ladish_writer writer;  /* memory writer with the document */
+  char * path;
+  char * tmp_path;
+  char * old_path;
+  char * bak_path;
+  bool success;
+  int done_fd;                  /* eventfd, signalled by the worker thread when finished */
+  struct ladish_loop_fd done_loop_fd;
+  void * context;
+  void (* callback)(void * context, bool success);
+};
+
+static void ladish_save_job_sync_dir(const char * path)
+{
+  char * dir;
+  char * slash;
+  int fd;
+
+  dir = strdup(path);
+  if (dir == NULL)
+  {
+    log_error("strdup() failed for '%s'", path);
+    return;
+  }
+
+  slash = strrchr(dir, '/');
+  if (slash == NULL || slash == dir)
+  {
+    free(dir);
+    return;
+  }
+
+  *slash = 0;
+
+  fd = open(dir, O_RDONLY | O_DIRECTORY);
+  if (fd == -1)
+  {
+    log_error("open(%s) failed: %d (%s)", dir, errno, strerror(errno));
+  }
+  else
+  {
+    if (fsync(fd) != 0)
+    {
+      log_error("fsync(%s) failed: %d (%s)", dir, errno, strerror(errno));
+    }
+
+    close(fd);
+  }
+
+  free(dir);
+}
+
+static bool ladish_save_job_write(struct ladish_save_job * job_ptr)
+{
+  int fd;
+
+  fd = open(job_ptr->tmp_path, O_WRONLY | O_TRUNC | O_CREAT | O_CLOEXEC, 0666);
+  if (fd == -1)
+  {
+    log_error("open(%s) failed: %d (%s)", job_ptr->tmp_path, errno, strerror(errno));
+    return false;
+  }
+
+  if (!ladish_write_fd(fd, job_ptr->writer.buffer, job_ptr->writer.used))
+  {
+    close(fd);
+    goto unlink_tmp;
+  }
+
+  if (fsync(fd) != 0)
+  {
+    log_error("fsync(%s) failed: %d (%s)", job_ptr->tmp_path, errno, strerror(errno));
+    close(fd);
+    goto unlink_tmp;
+  }
+
+  if (close(fd) != 0)
+  {
+    log_error("close(%s) failed: %d (%s)", job_ptr->tmp_path, errno, strerror(errno));
+    goto unlink_tmp;
+  }
+
+  /* keep the previous version of the file as backup, the file itself is replaced atomically below */
+  if (job_ptr->bak_path != NULL && strcmp(job_ptr->old_path, job_ptr->path) == 0)
+  {
+    if (unlink(job_ptr->bak_path) != 0 && errno != ENOENT)
+    {
+      log_error("unlink(%s) failed: %d (%s)", job_ptr->bak_path, errno, strerror(errno));
+    }
+
+    if (link(job_ptr->old_path, job_ptr->bak_path) != 0 && errno != ENOENT)
+    {
+      log_error("link(%s, %s) failed: %d (%s)", job_ptr->old_path, job_ptr->bak_path, errno, strerror(errno));
+    }
+  }
+
+  if (rename(job_ptr->tmp_path, job_ptr->path) != 0)
+  {
+    log_error("rename(%s, %s) failed: %d (%s)", job_ptr->tmp_path, job_ptr->path, errno, strerror(errno));
+    goto unlink_tmp;
+  }
+
+  /* file was saved under new name, the file with the old name becomes the backup */
+  if (job_ptr->bak_path != NULL && strcmp(job_ptr->old_path, job_ptr->path) != 0)
+  {
+    if (rename(job_ptr->old_path, job_ptr->bak_path) != 0 && errno != ENOENT)
+    {
+      log_error("rename(%s, %s) failed: %d (%s)", job_ptr->old_path, job_ptr->bak_path, errno, strerror(errno));
+    }
+  }
+
+  ladish_save_job_sync_dir(job_ptr->path);
+  return true;
+
+unlink_tmp:
+  unlink(job_ptr->tmp_path);
+  return false;
+}
+
+static void * ladish_save_job_thread(void * arg)
+{
+  struct ladish_save_job * job_ptr = arg;
+
+  uint64_t value = 1;
+
+  job_ptr->success = ladish_save_job_write(job_ptr);
+
+  /* wakes the main loop, the write also publishes the success flag */
+  if (write(job_ptr->done_fd, &value, sizeof(value)) != sizeof(value))
+  {
+    log_error("write() to save job eventfd failed: %d (%s)", errno, strerror(errno));
+  }
+
+  return NULL;
+}
+
+static void ladish_save_job_done(struct ladish_loop_fd * loop_fd_ptr, uint32_t UNUSED(events))
+{
+  struct ladish_save_job * job_ptr;
+  uint64_t value;
+
+  job_ptr = container_of(loop_fd_ptr, struct ladish_save_job, done_loop_fd);
+
+  if (read(job_ptr->done_fd, &value, sizeof(value)) != sizeof(value))
+  {
+    if (errno != EAGAIN)
+    {
+      log_error("read() from save job eventfd failed: %d (%s)", errno, strerror(errno));
+    }
+
+    return;
+  }
+
+  ladish_loop_fd_remove(&job_ptr->done_loop_fd);
+
+  if (job_ptr->threaded)
+  {
+    pthread_join(job_ptr->thread, NULL);
+    job_ptr->threaded = false;
+  }
+
+  /* callback may destroy the job */
+  job_ptr->callback(job_ptr->context, job_ptr->success);
+}
+
+struct ladish_save_job *
+ladish_save_job_start(
+  struct ladish_writer * writer,
+  const char * path,
+  const char * old_path,
+  const char * bak_path,
+  void * context,
+  void (* callback)(void * context, bool success))
+{
+  struct ladish_save_job * job_ptr;
+  int ret;
+
+  ASSERT(writer->fd == -1);
+  ASSERT(bak_path == NULL || old_path != NULL);
+
+  job_ptr = calloc(1, sizeof(struct ladish_save_job));
+  if (job_ptr == NULL)
+  {
+    log_error("calloc() failed to allocate save job");
+    return NULL;
+  }
+
+  job_ptr->context = context;
+  job_ptr->callback = callback;
+  ladish_loop_fd_init(&job_ptr->done_loop_fd);
+
+  job_ptr->done_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if (job_ptr->done_fd == -1)
+  {
+    log_error("eventfd() failed: %d (%s)", errno, strerror(errno));
+    goto free;
+  }
+
+  job_ptr->path = strdup(path);
+  job_ptr->tmp_path = catdup(path, ".tmp");
+  job_ptr->old_path = old_path != NULL ? strdup(old_path) : NULL;
+  job_ptr->bak_path = bak_path != NULL ? strdup(bak_path) : NULL;
+  if (job_ptr->path == NULL ||
+      job_ptr->tmp_path == NULL ||
+      (old_path != NULL && job_ptr->old_path == NULL) ||
+      (bak_path != NULL && job_ptr->bak_path == NULL))
+  {
+    log_error("strdup() failed for save job paths");
+    goto close_fd;
+  }
+
+  if (!ladish_loop_fd_add(&job_ptr->done_loop_fd, job_ptr->done_fd, EPOLLIN, ladish_save_job_done))
+  {
+    goto close_fd;
+  }
+
+  /* the job takes over the document */
+  job_ptr->writer = *writer;
+
+  ret = pthread_create(&job_ptr->thread, NULL, ladish_save_job_thread, job_ptr);
+  if (ret == 0)
+  {
+    job_ptr->threaded = true;
+  }
+  else
+  {
+    log_error("pthread_create() failed: %d (%s), saving synchronously", ret, strerror(ret));
+    /* completion is still reported through the main loop */
+    ladish_save_job_thread(job_ptr);
+  }
+
+  return job_ptr;
+
+close_fd:
+  close(job_ptr->done_fd);
+free:
+  free(job_ptr->bak_path);
+  free(job_ptr->old_path);
+  free(job_ptr->tmp_path);
+  free(job_ptr->path);
+  free(job_ptr);
+  return NULL;
+}
+
+void ladish_save_job_destroy(struct ladish_save_job * job_ptr)
+{
+  ladish_loop_fd_remove(&job_ptr->done_loop_fd);
+
+  if (job_ptr->threaded)
+  {
+    pthread_join(job_ptr->thread, NULL);
+  }
+
+  close(job_ptr->done_fd);
+  ladish_writer_close(&job_ptr->writer);
+  free(job_ptr->bak_path);
+  free(job_ptr->old_path);
+  free(job_ptr->tmp_path);
+  free(job_ptr->path);
+  free(job_ptr);
+}
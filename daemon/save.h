@@ -35,19 +35,58 @@
 
 #define LADISH_XML_BASE_INDENT "  "
 
+/* Buffered writer, data reaches the file when the buffer is full
+ * or when ladish_writer_flush() is called. Memory writer grows
+ * the buffer instead and is used to hand a document to a save job. */
+struct ladish_writer
+{
+  int fd;                       /* -1 for memory writer */
+  char * buffer;
+  size_t size;
+  size_t used;
+  char * escape_buffer;         /* scratch area for strings too long to be escaped in place */
+  size_t escape_buffer_size;
+};
+
 struct ladish_write_context
 {
-  int fd;
+  struct ladish_writer * writer;
   int indent;
 };
 
-bool ladish_write_string(int fd, const char * string);
-bool ladish_write_indented_string(int fd, int indent, const char * string);
-bool ladish_write_string_escape(int fd, const char * string);
-bool ladish_write_string_escape_ex(int fd, const char * string, unsigned int flags);
-bool ladish_write_dict(int fd, int indent, ladish_dict_handle dict);
-bool ladish_write_vgraph(int fd, int indent, ladish_graph_handle vgraph, ladish_app_supervisor_handle app_supervisor);
-bool ladish_write_room_link_ports(int fd, int indent, ladish_room_handle room);
-bool ladish_write_jgraph(int fd, int indent, ladish_graph_handle vgraph, ladish_app_supervisor_handle app_supervisor);
+bool ladish_writer_open(struct ladish_writer * writer, const char * path);
+bool ladish_writer_open_memory(struct ladish_writer * writer);
+bool ladish_writer_flush(struct ladish_writer * writer);
+/* Close the file, data that is not flushed is discarded */
+void ladish_writer_close(struct ladish_writer * writer);
+
+bool ladish_write_string(struct ladish_writer * writer, const char * string);
+bool ladish_write_indented_string(struct ladish_writer * writer, int indent, const char * string);
+bool ladish_write_string_escape(struct ladish_writer * writer, const char * string);
+bool ladish_write_string_escape_ex(struct ladish_writer * writer, const char * string, unsigned int flags);
+bool ladish_write_dict(struct ladish_writer * writer, int indent, ladish_dict_handle dict);
+bool ladish_write_vgraph(struct ladish_writer * writer, int indent, ladish_graph_handle vgraph, ladish_app_supervisor_handle app_supervisor);
+bool ladish_write_room_link_ports(struct ladish_writer * writer, int indent, ladish_room_handle room);
+bool ladish_write_jgraph(struct ladish_writer * writer, int indent, ladish_graph_handle vgraph, ladish_app_supervisor_handle app_supervisor);
+
+/* Save job writes a document prepared by a memory writer on a worker
+ * thread. The document goes to a temp file that is fsync()ed and then
+ * renamed over path. If bak_path is not NULL, the file at old_path is
+ * kept as backup. On success the job takes over the writer. When the
+ * file is written, callback is called from the main loop; it may
+ * destroy the job. */
+struct ladish_save_job;
+
+struct ladish_save_job *
+ladish_save_job_start(
+  struct ladish_writer * writer,
+  const char * path,
+  const char * old_path,
+  const char * bak_path,
+  void * context,
+  void (* callback)(void * context, bool success));
+
+/* Waits for the job to finish if it is still running, callback is not called */
+void ladish_save_job_destroy(struct ladish_save_job * job_ptr);
 
 #endif /* #ifndef SAVE_H__120D6D3D_90A9_4998_8F00_23FCB8BA8DE9__INCLUDED */
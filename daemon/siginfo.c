@@ -23,6 +23,7 @@
  */
 
 #include "common.h"
+#include "flightrec.h"
 #define siginfo_log log_error
 
 #if defined(HAVE_CONFIG_H)
@@ -402,11 +403,25 @@ static void dump_registers(ucontext_t * ucontext)
 
 static void signal_handler(int signum, siginfo_t * info, void * ptr)
 {
+    const char * flightrec_path;
+
+    /* before anything that is not async-signal-safe */
+    flightrec_path = ladish_flightrec_dump();
+
+    /* write what is queued, crash info itself is logged synchronously */
+    ladish_log_flush();
+
     dump_siginfo(signum, info);
 #if defined(USE_UCONTEXT)
     dump_registers(ptr);
 #endif
     dump_stack(ptr);
+
+    if (flightrec_path != NULL)
+    {
+        siginfo_log("Flight recorder dumped to %s", flightrec_path);
+    }
+
     exit(-1);
 }
 
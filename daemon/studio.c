@@ -148,7 +148,8 @@ void ladish_studio_clear(void)
 
   ladish_studio_jack_conf_clear();
 
-  g_studio.modified = false;
+  g_studio.modified = 0;
+  g_studio.saved = 0;
   g_studio.persisted = false;
 
   ladish_app_supervisor_clear(g_studio.app_supervisor);
@@ -305,6 +306,7 @@ void ladish_studio_room_appeared(ladish_room_handle room)
 {
   log_info("Room \"%s\" appeared", ladish_room_get_name(room));
   list_add_tail(ladish_room_get_list_node(room), &g_studio.rooms);
+  g_studio.modified = ladish_modified_now();
   ladish_studio_emit_room_appeared(room);
 }
 
@@ -312,6 +314,7 @@ void ladish_studio_room_disappeared(ladish_room_handle room)
 {
   log_info("Room \"%s\" disappeared", ladish_room_get_name(room));
   list_del(ladish_room_get_list_node(room));
+  g_studio.modified = ladish_modified_now();
   ladish_studio_emit_room_disappeared(room);
 }
 
@@ -336,6 +339,7 @@ void ladish_studio_on_event_jack_started(void)
 
   log_info("jack conf successfully retrieved");
   g_studio.jack_conf_valid = true;
+  g_studio.modified = ladish_modified_now();
 
   if (!graph_proxy_create(JACKDBUS_SERVICE_NAME, JACKDBUS_OBJECT_PATH, false, false, &g_studio.jack_graph_proxy))
   {
@@ -707,6 +711,21 @@ bool ladish_studio_is_started(void)
   return ladish_environment_get(&g_studio.env_store, ladish_environment_jack_server_started);
 }
 
+/* Whether the studio xml file is out of date. Room projects are tracked separately by ladish_room_is_dirty() */
+bool ladish_studio_is_dirty(void)
+{
+  if (!g_studio.persisted)
+  {
+    return true;
+  }
+
+  return
+    g_studio.modified > g_studio.saved ||
+    ladish_graph_get_modified(g_studio.studio_graph) > g_studio.saved ||
+    ladish_graph_get_modified(g_studio.jack_graph) > g_studio.saved || /* saved in the studio xml too */
+    ladish_app_supervisor_get_modified(g_studio.app_supervisor) > g_studio.saved;
+}
+
 bool ladish_studio_compose_filename(const char * name, char ** filename_ptr_ptr, char ** backup_filename_ptr_ptr)
 {
   size_t len_dir;
@@ -1139,6 +1158,15 @@ static void ladish_studio_dbus_is_started(struct cdbus_method_call * call_ptr)
   cdbus_method_return_new_single(call_ptr, DBUS_TYPE_BOOLEAN, &started);
 }
 
+static void ladish_studio_dbus_is_dirty(struct cdbus_method_call * call_ptr)
+{
+  dbus_bool_t dirty;
+
+  dirty = ladish_studio_is_dirty();
+
+  cdbus_method_return_new_single(call_ptr, DBUS_TYPE_BOOLEAN, &dirty);
+}
+
 static void ladish_studio_dbus_create_room(struct cdbus_method_call * call_ptr)
 {
   const char * room_name;
@@ -1255,6 +1283,10 @@ CDBUS_METHOD_ARGS_BEGIN(IsStarted, "Check whether studio is started")
   CDBUS_METHOD_ARG_DESCRIBE_OUT("started", "b", "Whether studio is started")
 CDBUS_METHOD_ARGS_END
 
+CDBUS_METHOD_ARGS_BEGIN(IsDirty, "Check whether studio has changes not saved yet. Room projects are queried through their own IsDirty methods")
+  CDBUS_METHOD_ARG_DESCRIBE_OUT("dirty", "b", "Whether studio was changed since it was last saved or loaded")
+CDBUS_METHOD_ARGS_END
+
 CDBUS_METHOD_ARGS_BEGIN(CreateRoom, "Create new studio room")
   CDBUS_METHOD_ARG_DESCRIBE_IN("room_name", "s", "Studio room name")
   CDBUS_METHOD_ARG_DESCRIBE_IN("room_template_name", "s", "Room template name")
@@ -1277,6 +1309,7 @@ CDBUS_METHODS_BEGIN
   CDBUS_METHOD_DESCRIBE(Start, ladish_studio_dbus_start)               /* async */
   CDBUS_METHOD_DESCRIBE(Stop, ladish_studio_dbus_stop)                 /* async */
   CDBUS_METHOD_DESCRIBE(IsStarted, ladish_studio_dbus_is_started)      /* sync */
+  CDBUS_METHOD_DESCRIBE(IsDirty, ladish_studio_dbus_is_dirty)          /* sync */
   CDBUS_METHOD_DESCRIBE(CreateRoom, ladish_studio_dbus_create_room)    /* async */
   CDBUS_METHOD_DESCRIBE(GetRoomList, ladish_studio_dbus_get_room_list) /* sync */
   CDBUS_METHOD_DESCRIBE(DeleteRoom, ladish_studio_dbus_delete_room)    /* async */
@@ -37,6 +37,7 @@ void ladish_studio_uninit(void);
 void ladish_studio_run(void);
 bool ladish_studio_is_loaded(void);
 bool ladish_studio_is_started(void);
+bool ladish_studio_is_dirty(void);
 
 bool ladish_studios_iterate(void * call_ptr, void * context, bool (* callback)(void * call_ptr, void * context, const char * studio, uint32_t modtime));
 bool ladish_studio_delete(void * call_ptr, const char * studio_name);
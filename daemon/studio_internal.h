@@ -133,9 +133,11 @@ struct studio
 
   bool automatic:1;             /* Studio was automatically created because of external JACK start */
   bool persisted:1;             /* Studio has on-disk representation, i.e. can be reloaded from disk */
-  bool modified:1;              /* Studio needs saving */
   bool jack_conf_valid:1;       /* JACK server configuration obtained successfully */
 
+  uint64_t modified;            /* modification clock value of the last change of the room list or of the JACK conf */
+  uint64_t saved;               /* modification clock value of the last studio load or save */
+
   struct list_head jack_conf;   /* root of the conf tree */
   struct list_head jack_params; /* list of conf tree leaves */
 
@@ -28,7 +28,8 @@
 #include "../dbus_constants.h"
 #include "../proxies/a2j_proxy.h"
 #include "../proxies/jmcore_proxy.h"
-#include "procfs.h"
+#include "proctree.h"
+#include "flightrec.h"
 #include "app_supervisor.h"
 #include "studio_internal.h"
 #include "../common/catdup.h"
@@ -42,6 +43,29 @@ struct virtualizer
   ladish_graph_handle jack_graph;
   uint64_t system_client_id;
   unsigned int our_clients_count;
+  struct list_head a2j_pending_ports;    /* a2j ports waiting for ALSA mapping */
+  struct list_head deferred_connections; /* connections of pending a2j ports */
+};
+
+/* a2j port that appeared but is not placed yet because a2jmidid did not reply yet */
+struct a2j_pending_port
+{
+  struct list_head siblings;
+  struct virtualizer * virtualizer_ptr;
+  uint64_t client_id;
+  uint64_t port_id;
+  bool is_input;
+  bool is_terminal;
+  bool is_midi;
+};
+
+struct deferred_connection
+{
+  struct list_head siblings;
+  uint64_t client1_id;
+  uint64_t port1_id;
+  uint64_t client2_id;
+  uint64_t port2_id;
 };
 
 /* 47c1cd18-7b21-4389-bec4-6e0658e1d6b1 */
@@ -64,31 +88,15 @@ struct app_find_context
 
 static bool lookup_app_in_supervisor(void * context, ladish_graph_handle graph, ladish_app_supervisor_handle app_supervisor)
 {
-  pid_t pid;
   ladish_app_handle app;
 
   /* we stop iteration when app is found */
   ASSERT(app_find_context_ptr->app == NULL && app_find_context_ptr->graph == NULL);
 
-  //log_info("checking app supervisor \"%s\" for pid %llu", ladish_app_supervisor_get_name(app_supervisor), (unsigned long long)pid);
-
-  pid = app_find_context_ptr->pid;
-  do
-  {
-    app = ladish_app_supervisor_find_app_by_pid(app_supervisor, pid);
-    if (app != NULL)
-      break;
-
-    pid = (pid_t)procfs_get_process_parent((unsigned long long)pid);
-#if 0
-    if (pid != 0)
-    {
-      log_info("parent pid %llu", (unsigned long long)pid);
-    }
-#endif
-  }
-  while (pid != 0);
+  //log_info("checking app supervisor \"%s\" for pid %llu", ladish_app_supervisor_get_name(app_supervisor), (unsigned long long)app_find_context_ptr->pid);
 
+  /* app_find_context_ptr->pid is the pid of process started by the loader */
+  app = ladish_app_supervisor_find_app_by_pid(app_supervisor, app_find_context_ptr->pid);
   if (app == NULL)
   {                            /* app not found in current supervisor */
     return true;               /* continue app supervisor iteration */
@@ -106,7 +114,13 @@ ladish_app_handle ladish_find_app_by_pid(pid_t pid, ladish_graph_handle * graph_
 {
   struct app_find_context context;
 
-  context.pid = pid;
+  /* Apps are started by the loader, so only descendants of loader children can belong to an app */
+  context.pid = ladish_proctree_find_root(pid);
+  if (context.pid == 0)
+  {
+    return NULL;
+  }
+
   context.app = NULL;
   context.graph = NULL;
 
@@ -266,11 +280,140 @@ lookup_port(
   return true;
 }
 
+static struct a2j_pending_port * find_a2j_pending_port(struct virtualizer * virtualizer_ptr, uint64_t port_id)
+{
+  struct list_head * node_ptr;
+  struct a2j_pending_port * pending_ptr;
+
+  list_for_each(node_ptr, &virtualizer_ptr->a2j_pending_ports)
+  {
+    pending_ptr = list_entry(node_ptr, struct a2j_pending_port, siblings);
+    if (pending_ptr->port_id == port_id)
+    {
+      return pending_ptr;
+    }
+  }
+
+  return NULL;
+}
+
+static
+bool
+defer_connection(
+  struct virtualizer * virtualizer_ptr,
+  uint64_t client1_id,
+  uint64_t port1_id,
+  uint64_t client2_id,
+  uint64_t port2_id)
+{
+  struct deferred_connection * connection_ptr;
+
+  connection_ptr = malloc(sizeof(struct deferred_connection));
+  if (connection_ptr == NULL)
+  {
+    log_error("malloc() failed for struct deferred_connection");
+    return false;
+  }
+
+  connection_ptr->client1_id = client1_id;
+  connection_ptr->port1_id = port1_id;
+  connection_ptr->client2_id = client2_id;
+  connection_ptr->port2_id = port2_id;
+  list_add_tail(&connection_ptr->siblings, &virtualizer_ptr->deferred_connections);
+
+  return true;
+}
+
+/* port_id 0 matches all deferred connections */
+static
+void
+drop_deferred_connections(
+  struct virtualizer * virtualizer_ptr,
+  uint64_t port1_id,
+  uint64_t port2_id)
+{
+  struct list_head * node_ptr;
+  struct list_head * next_ptr;
+  struct deferred_connection * connection_ptr;
+
+  list_for_each_safe(node_ptr, next_ptr, &virtualizer_ptr->deferred_connections)
+  {
+    connection_ptr = list_entry(node_ptr, struct deferred_connection, siblings);
+    if ((port1_id == 0 || connection_ptr->port1_id == port1_id || connection_ptr->port2_id == port1_id) &&
+        (port2_id == 0 || connection_ptr->port1_id == port2_id || connection_ptr->port2_id == port2_id))
+    {
+      list_del(&connection_ptr->siblings);
+      free(connection_ptr);
+    }
+  }
+}
+
+static void drop_a2j_pending_port(struct a2j_pending_port * pending_ptr)
+{
+  a2j_proxy_cancel_map_requests(pending_ptr);
+  drop_deferred_connections(pending_ptr->virtualizer_ptr, pending_ptr->port_id, 0);
+  list_del(&pending_ptr->siblings);
+  free(pending_ptr);
+}
+
+static void drop_a2j_pending_ports(struct virtualizer * virtualizer_ptr)
+{
+  while (!list_empty(&virtualizer_ptr->a2j_pending_ports))
+  {
+    drop_a2j_pending_port(list_entry(virtualizer_ptr->a2j_pending_ports.next, struct a2j_pending_port, siblings));
+  }
+
+  drop_deferred_connections(virtualizer_ptr, 0, 0);
+}
+
+static void ports_connected(void * context, uint64_t client1_id, uint64_t port1_id, uint64_t client2_id, uint64_t port2_id);
+static void on_a2j_port_mapped(void * context, const char * jack_port_name, const struct a2j_proxy_port_mapping * mapping_ptr);
+
+static
+bool
+defer_a2j_port(
+  struct virtualizer * virtualizer_ptr,
+  uint64_t client_id,
+  uint64_t port_id,
+  const char * jack_port_name,
+  bool is_input,
+  bool is_terminal,
+  bool is_midi)
+{
+  struct a2j_pending_port * pending_ptr;
+
+  pending_ptr = malloc(sizeof(struct a2j_pending_port));
+  if (pending_ptr == NULL)
+  {
+    log_error("malloc() failed for struct a2j_pending_port");
+    return false;
+  }
+
+  pending_ptr->virtualizer_ptr = virtualizer_ptr;
+  pending_ptr->client_id = client_id;
+  pending_ptr->port_id = port_id;
+  pending_ptr->is_input = is_input;
+  pending_ptr->is_terminal = is_terminal;
+  pending_ptr->is_midi = is_midi;
+
+  if (!a2j_proxy_map_jack_port_async(jack_port_name, pending_ptr, on_a2j_port_mapped))
+  {
+    free(pending_ptr);
+    return false;
+  }
+
+  list_add_tail(&pending_ptr->siblings, &virtualizer_ptr->a2j_pending_ports);
+  log_info("a2j port mapping for '%s' requested", jack_port_name);
+
+  return true;
+}
+
 #define virtualizer_ptr ((struct virtualizer *)context)
 
-static void clear(void * UNUSED(context))
+static void clear(void * context)
 {
   log_info("clear");
+  drop_a2j_pending_ports(virtualizer_ptr);
 }
 
 static void client_appeared(void * context, uint64_t id, const char * jack_name)
@@ -286,6 +429,7 @@ static void client_appeared(void * context, uint64_t id, const char * jack_name)
   bool jmcore;
 
   log_info("client_appeared(%"PRIu64", %s)", id, jack_name);
+  ladish_flightrec_record(LADISH_FLIGHTREC_JACK_CLIENT_APPEARED, id, 0, 0);
 
   a2j_name = a2j_proxy_get_jack_client_name_cached();
   is_a2j = a2j_name != NULL && strcmp(a2j_name, jack_name) == 0;
@@ -451,8 +595,21 @@ static void client_disappeared(void * context, uint64_t id)
   uuid_t app_uuid;
   ladish_app_handle app;
   ladish_graph_handle vgraph;
+  struct list_head * node_ptr;
+  struct list_head * next_ptr;
+  struct a2j_pending_port * pending_ptr;
 
   log_info("client_disappeared(%"PRIu64")", id);
+  ladish_flightrec_record(LADISH_FLIGHTREC_JACK_CLIENT_DISAPPEARED, id, 0, 0);
+
+  list_for_each_safe(node_ptr, next_ptr, &virtualizer_ptr->a2j_pending_ports)
+  {
+    pending_ptr = list_entry(node_ptr, struct a2j_pending_port, siblings);
+    if (pending_ptr->client_id == id)
+    {
+      drop_a2j_pending_port(pending_ptr);
+    }
+  }
 
   client = ladish_graph_find_client_by_jack_id(virtualizer_ptr->jack_graph, id);
   if (client == NULL)
@@ -503,16 +660,20 @@ static void client_disappeared(void * context, uint64_t id)
   }
 }
 
+/* For a2j ports, a2j_mapped is true when the mapping was already requested from a2jmidid.
+ * a2j_mapping_ptr is the result then, NULL if the mapping failed. */
 static
 void
-port_appeared(
+port_appeared_internal(
   void * context,
   uint64_t client_id,
   uint64_t port_id,
   const char * real_jack_port_name,
   bool is_input,
   bool is_terminal,
-  bool is_midi)
+  bool is_midi,
+  bool a2j_mapped,
+  const struct a2j_proxy_port_mapping * a2j_mapping_ptr)
 {
   ladish_client_handle jack_client;
   ladish_client_handle vclient;
@@ -534,6 +695,7 @@ port_appeared(
   const char * jack_port_name;
   const char * vport_name;
   ladish_graph_handle vgraph;
+  struct a2j_proxy_port_mapping a2j_mapping;
 
   log_info("port_appeared(%"PRIu64", %"PRIu64", %s (%s, %s))", client_id, port_id, real_jack_port_name, is_input ? "in" : "out", is_midi ? "midi" : "audio");
 
@@ -613,7 +775,21 @@ port_appeared(
   if (is_a2j)
   {
     log_info("a2j port appeared");
-    if (!a2j_proxy_map_jack_port(real_jack_port_name, &alsa_client_name, &alsa_port_name, &alsa_client_id))
+
+    if (!a2j_mapped)
+    {
+      if (a2j_proxy_lookup_jack_port(real_jack_port_name, &a2j_mapping))
+      {
+        a2j_mapping_ptr = &a2j_mapping;
+      }
+      else if (defer_a2j_port(virtualizer_ptr, client_id, port_id, real_jack_port_name, is_input, is_terminal, is_midi))
+      {
+        /* placement will be finished when a2jmidid replies */
+        goto exit;
+      }
+    }
+
+    if (a2j_mapping_ptr == NULL)
     {
       is_a2j = false;
       alsa_client_name = catdup("FAILED ", jack_client_name);
@@ -635,6 +811,16 @@ port_appeared(
     }
     else
     {
+      alsa_client_name = strdup(a2j_mapping_ptr->alsa_client_name);
+      alsa_port_name = strdup(a2j_mapping_ptr->alsa_port_name);
+      if (alsa_client_name == NULL || alsa_port_name == NULL)
+      {
+        log_error("strdup() failed for a2j alsa names");
+        goto free_alsa_names;
+      }
+
+      alsa_client_id = a2j_mapping_ptr->alsa_client_id;
+
       log_info("a2j: '%s':'%s' (%"PRIu32")", alsa_client_name, alsa_port_name, alsa_client_id);
       vclient_name = alsa_client_name;
       if (alsapid_get_pid(alsa_client_id, &pid))
@@ -908,6 +1094,65 @@ exit:
   return;
 }
 
+static
+void
+port_appeared(
+  void * context,
+  uint64_t client_id,
+  uint64_t port_id,
+  const char * real_jack_port_name,
+  bool is_input,
+  bool is_terminal,
+  bool is_midi)
+{
+  ladish_flightrec_record(LADISH_FLIGHTREC_JACK_PORT_APPEARED, client_id, port_id, 0);
+  port_appeared_internal(context, client_id, port_id, real_jack_port_name, is_input, is_terminal, is_midi, false, NULL);
+}
+
+#undef virtualizer_ptr
+
+static void on_a2j_port_mapped(void * context, const char * jack_port_name, const struct a2j_proxy_port_mapping * mapping_ptr)
+{
+  struct a2j_pending_port * pending_ptr;
+  struct virtualizer * virtualizer_ptr;
+  struct list_head * node_ptr;
+  struct list_head * next_ptr;
+  struct deferred_connection * connection_ptr;
+
+  pending_ptr = context;
+  virtualizer_ptr = pending_ptr->virtualizer_ptr;
+
+  list_del(&pending_ptr->siblings);
+
+  port_appeared_internal(
+    virtualizer_ptr,
+    pending_ptr->client_id,
+    pending_ptr->port_id,
+    jack_port_name,
+    pending_ptr->is_input,
+    pending_ptr->is_terminal,
+    pending_ptr->is_midi,
+    true,
+    mapping_ptr);
+
+  free(pending_ptr);
+
+  /* replay connections that were waiting for the port */
+  list_for_each_safe(node_ptr, next_ptr, &virtualizer_ptr->deferred_connections)
+  {
+    connection_ptr = list_entry(node_ptr, struct deferred_connection, siblings);
+    if (find_a2j_pending_port(virtualizer_ptr, connection_ptr->port1_id) == NULL &&
+        find_a2j_pending_port(virtualizer_ptr, connection_ptr->port2_id) == NULL)
+    {
+      list_del(&connection_ptr->siblings);
+      ports_connected(virtualizer_ptr, connection_ptr->client1_id, connection_ptr->port1_id, connection_ptr->client2_id, connection_ptr->port2_id);
+      free(connection_ptr);
+    }
+  }
+}
+
+#define virtualizer_ptr ((struct virtualizer *)context)
+
 static void maybe_clear_a2j_port_pid(ladish_graph_handle vgraph, ladish_client_handle jclient, ladish_port_handle port)
 {
   const char * opath;
@@ -937,8 +1182,18 @@ static void port_disappeared(void * context, uint64_t client_id, uint64_t port_i
   ladish_port_handle port;
   ladish_graph_handle vgraph;
   bool jmcore;
+  struct a2j_pending_port * pending_ptr;
 
   log_info("port_disappeared(%"PRIu64", %"PRIu64")", client_id, port_id);
+  ladish_flightrec_record(LADISH_FLIGHTREC_JACK_PORT_DISAPPEARED, client_id, port_id, 0);
+
+  pending_ptr = find_a2j_pending_port(virtualizer_ptr, port_id);
+  if (pending_ptr != NULL)
+  {
+    log_info("a2j port disappeared before its mapping was resolved");
+    drop_a2j_pending_port(pending_ptr);
+    return;
+  }
 
   jclient = ladish_graph_find_client_by_jack_id(virtualizer_ptr->jack_graph, client_id);
   if (jclient == NULL)
@@ -1051,6 +1306,16 @@ port_renamed(
   }
 }
 
+static uint64_t get_port_jack_id_for_graph(ladish_graph_handle graph_handle, ladish_port_handle port)
+{
+  if (graph_handle == g_studio.studio_graph)
+  {
+    return ladish_port_get_jack_id(port);
+  }
+
+  return ladish_port_get_jack_id_room(port);
+}
+
 static bool ports_connect_request(void * context, ladish_graph_handle graph_handle, ladish_port_handle port1, ladish_port_handle port2)
 {
   uint64_t port1_id;
@@ -1059,16 +1324,8 @@ static bool ports_connect_request(void * context, ladish_graph_handle graph_hand
   ASSERT(ladish_graph_get_opath(graph_handle)); /* studio or room virtual graph */
   log_info("virtualizer: ports connect request");
 
-  if (graph_handle == g_studio.studio_graph)
-  {
-    port1_id = ladish_port_get_jack_id(port1);
-    port2_id = ladish_port_get_jack_id(port2);
-  }
-  else
-  {
-    port1_id = ladish_port_get_jack_id_room(port1);
-    port2_id = ladish_port_get_jack_id_room(port2);
-  }
+  port1_id = get_port_jack_id_for_graph(graph_handle, port1);
+  port2_id = get_port_jack_id_for_graph(graph_handle, port2);
 
   return graph_proxy_connect_ports(virtualizer_ptr->jack_graph_proxy, port1_id, port2_id);
 }
@@ -1090,18 +1347,97 @@ static bool ports_disconnect_request(void * context, ladish_graph_handle graph_h
     return false;
   }
 
-  if (graph_handle == g_studio.studio_graph)
+  port1_id = get_port_jack_id_for_graph(graph_handle, port1);
+  port2_id = get_port_jack_id_for_graph(graph_handle, port2);
+
+  return graph_proxy_disconnect_ports(virtualizer_ptr->jack_graph_proxy, port1_id, port2_id);
+}
+
+static
+void
+ports_connect_batch_request(
+  void * context,
+  ladish_graph_handle graph_handle,
+  unsigned int count,
+  const ladish_port_handle * ports,
+  bool * results)
+{
+  uint64_t * port_ids;
+  unsigned int i;
+
+  ASSERT(ladish_graph_get_opath(graph_handle)); /* studio or room virtual graph */
+  log_info("virtualizer: ports connect batch request for %u port pairs", count);
+
+  port_ids = malloc((count > 0 ? count : 1) * 2 * sizeof(uint64_t));
+  if (port_ids == NULL)
   {
-    port1_id = ladish_port_get_jack_id(port1);
-    port2_id = ladish_port_get_jack_id(port2);
+    log_error("malloc() failed for port ids of %u port pairs", count);
+    for (i = 0; i < count; i++)
+    {
+      results[i] = false;
+    }
+    return;
   }
-  else
+
+  for (i = 0; i < count * 2; i++)
   {
-    port1_id = ladish_port_get_jack_id_room(port1);
-    port2_id = ladish_port_get_jack_id_room(port2);
+    port_ids[i] = get_port_jack_id_for_graph(graph_handle, ports[i]);
   }
 
-  return graph_proxy_disconnect_ports(virtualizer_ptr->jack_graph_proxy, port1_id, port2_id);
+  graph_proxy_connect_ports_batch(virtualizer_ptr->jack_graph_proxy, count, port_ids, results);
+
+  free(port_ids);
+}
+
+static
+void
+ports_disconnect_batch_request(
+  void * context,
+  ladish_graph_handle graph_handle,
+  unsigned int count,
+  const uint64_t * connection_ids,
+  bool * results)
+{
+  uint64_t * port_ids;
+  unsigned int i;
+  ladish_port_handle port1;
+  ladish_port_handle port2;
+
+  ASSERT(ladish_graph_get_opath(graph_handle)); /* studio or room virtual graph */
+  log_info("virtualizer: ports disconnect batch request for %u port pairs", count);
+
+  port_ids = malloc((count > 0 ? count : 1) * 2 * sizeof(uint64_t));
+  if (port_ids == NULL)
+  {
+    log_error("malloc() failed for port ids of %u port pairs", count);
+    for (i = 0; i < count; i++)
+    {
+      results[i] = false;
+    }
+    return;
+  }
+
+  for (i = 0; i < count; i++)
+  {
+    if (!ladish_graph_get_connection_ports(graph_handle, connection_ids[i], &port1, &port2))
+    {
+      log_error("cannot find ports that are disconnect-requested");
+      ASSERT_NO_PASS;
+      free(port_ids);
+      for (i = 0; i < count; i++)
+      {
+        results[i] = false;
+      }
+      return;
+    }
+
+    port_ids[i * 2] = get_port_jack_id_for_graph(graph_handle, port1);
+    port_ids[i * 2 + 1] = get_port_jack_id_for_graph(graph_handle, port2);
+  }
+
+  graph_proxy_disconnect_ports_batch(virtualizer_ptr->jack_graph_proxy, count, port_ids, results);
+
+  free(port_ids);
 }
 
 static void ports_connected(void * context, uint64_t client1_id, uint64_t port1_id, uint64_t client2_id, uint64_t port2_id)
@@ -1113,6 +1449,15 @@ static void ports_connected(void * context, uint64_t client1_id, uint64_t port1_
   ladish_graph_handle vgraph2;
 
   log_info("ports_connected %"PRIu64":%"PRIu64" %"PRIu64":%"PRIu64"", client1_id, port1_id, client2_id, port2_id);
+  ladish_flightrec_record(LADISH_FLIGHTREC_JACK_PORTS_CONNECTED, port1_id, port2_id, 0);
+
+  if (find_a2j_pending_port(virtualizer_ptr, port1_id) != NULL ||
+      find_a2j_pending_port(virtualizer_ptr, port2_id) != NULL)
+  {
+    log_info("connection of a2j port with pending mapping deferred");
+    defer_connection(virtualizer_ptr, client1_id, port1_id, client2_id, port2_id);
+    return;
+  }
 
   if (!lookup_port(virtualizer_ptr, port1_id, &port1, &vgraph1))
   {
@@ -1154,6 +1499,14 @@ static void ports_disconnected(void * context, uint64_t client1_id, uint64_t por
   ladish_graph_handle vgraph2;
 
   log_info("ports_disconnected %"PRIu64":%"PRIu64" %"PRIu64":%"PRIu64"", client1_id, port1_id, client2_id, port2_id);
+  ladish_flightrec_record(LADISH_FLIGHTREC_JACK_PORTS_DISCONNECTED, port1_id, port2_id, 0);
+
+  if (find_a2j_pending_port(virtualizer_ptr, port1_id) != NULL ||
+      find_a2j_pending_port(virtualizer_ptr, port2_id) != NULL)
+  {
+    drop_deferred_connections(virtualizer_ptr, port1_id, port2_id);
+    return;
+  }
 
   if (!lookup_port(virtualizer_ptr, port1_id, &port1, &vgraph1))
   {
@@ -1212,6 +1565,8 @@ ladish_virtualizer_create(
   virtualizer_ptr->jack_graph = jack_graph;
   virtualizer_ptr->system_client_id = 0;
   virtualizer_ptr->our_clients_count = 0;
+  INIT_LIST_HEAD(&virtualizer_ptr->a2j_pending_ports);
+  INIT_LIST_HEAD(&virtualizer_ptr->deferred_connections);
 
   if (!graph_proxy_attach(
         jack_graph_proxy,
@@ -1242,6 +1597,7 @@ ladish_virtualizer_set_graph_connection_handlers(
   ladish_graph_handle graph)
 {
   ladish_graph_set_connection_handlers(graph, virtualizer_ptr, ports_connect_request, ports_disconnect_request);
+  ladish_graph_set_batch_connection_handlers(graph, ports_connect_batch_request, ports_disconnect_batch_request);
 }
 
 unsigned int
@@ -1482,6 +1838,7 @@ ladish_virtualizer_destroy(
   log_info("ladish_virtualizer_destroy() called");
 
   graph_proxy_detach((graph_proxy_handle)handle, virtualizer_ptr);
+  drop_a2j_pending_ports(virtualizer_ptr);
   free(virtualizer_ptr);
 }
 
@@ -46,6 +46,7 @@
 #define IFACE_GRAPH_DICT         DBUS_NAME_BASE ".GraphDict"
 #define IFACE_GRAPH_MANAGER      DBUS_NAME_BASE ".GraphManager"
 #define IFACE_RECENT_ITEMS       DBUS_NAME_BASE ".RecentItems"
+#define IFACE_METRICS            DBUS_NAME_BASE ".Metrics"
 #define LASH_SERVER_OBJECT_PATH  DBUS_BASE_PATH "/LashServer"
 #define IFACE_LASH_SERVER        DBUS_NAME_BASE ".LashServer"
 #define IFACE_LASH_CLIENT        DBUS_NAME_BASE ".LashClient"
@@ -74,6 +75,15 @@
 #define GRAPH_DICT_OBJECT_TYPE_PORT           2
 #define GRAPH_DICT_OBJECT_TYPE_CONNECTION     3
 
+#define GRAPH_CHANGE_CLIENT_APPEARED          0
+#define GRAPH_CHANGE_CLIENT_DISAPPEARED       1
+#define GRAPH_CHANGE_CLIENT_RENAMED           2
+#define GRAPH_CHANGE_PORT_APPEARED            3
+#define GRAPH_CHANGE_PORT_DISAPPEARED         4
+#define GRAPH_CHANGE_PORT_RENAMED             5
+#define GRAPH_CHANGE_PORTS_CONNECTED          6
+#define GRAPH_CHANGE_PORTS_DISCONNECTED       7
+
 #define URI_CANVAS_WIDTH    "http://ladish.org/ns/canvas/width"
 #define URI_CANVAS_HEIGHT   "http://ladish.org/ns/canvas/height"
 #define URI_CANVAS_X        "http://ladish.org/ns/canvas/x"
@@ -39,15 +39,12 @@ extern const struct cdbus_interface_descriptor g_interface;
 static const char * g_dbus_unique_name;
 static cdbus_object_path g_object;
 static bool g_quit;
-static unsigned int g_unique_index;
 
 struct list_head g_pairs;
 
 struct port_pair
 {
   struct list_head siblings;
-  jack_client_t * client;
-  bool dead;
   bool midi;
   jack_port_t * input_port;
   jack_port_t * output_port;
@@ -55,67 +52,252 @@ struct port_pair
   char * output_port_name;
 };
 
-#define pair_ptr ((struct port_pair *)arg)
+/* Snapshot of the active pairs, as seen by the process callback.
+ * It is never modified after being published; adding or removing a pair
+ * builds a new array and swaps the pointer. */
+struct pairs_array
+{
+  unsigned int count;
+  struct port_pair * pairs[];
+};
+
+/* All port pairs are hosted by single JACK client */
+static jack_client_t * g_client;
+static bool g_client_dead;
+
+static struct pairs_array * g_pairs_array;
 
-void shutdown_callback(void * arg)
+/* Incremented both on enter and on exit of the process callback,
+ * odd value means that process callback is running */
+static unsigned int g_process_sequence;
+
+static void shutdown_callback(void * UNUSED(arg))
 {
-  pair_ptr->dead = true;
+  __atomic_store_n(&g_client_dead, true, __ATOMIC_SEQ_CST);
 }
 
-int process_callback(jack_nframes_t nframes, void * arg)
+static int process_callback(jack_nframes_t nframes, void * UNUSED(arg))
 {
+  struct pairs_array * array_ptr;
+  struct port_pair * pair_ptr;
+  unsigned int index;
   void * input;
   void * output;
   jack_midi_event_t midi_event;
   jack_nframes_t midi_event_index;
 
-  input = jack_port_get_buffer(pair_ptr->input_port, nframes);
-  output = jack_port_get_buffer(pair_ptr->output_port, nframes);
+  __atomic_add_fetch(&g_process_sequence, 1, __ATOMIC_SEQ_CST);
 
-  if (!pair_ptr->midi)
+  array_ptr = __atomic_load_n(&g_pairs_array, __ATOMIC_SEQ_CST);
+  if (array_ptr == NULL)
   {
-    memcpy(output, input, nframes * sizeof(jack_default_audio_sample_t));
+    goto exit;
   }
-  else
+
+  for (index = 0; index < array_ptr->count; index++)
   {
-    jack_midi_clear_buffer(output);
-    midi_event_index = 0;
-    while (jack_midi_event_get(&midi_event, input, midi_event_index) == 0)
+    pair_ptr = array_ptr->pairs[index];
+
+    input = jack_port_get_buffer(pair_ptr->input_port, nframes);
+    output = jack_port_get_buffer(pair_ptr->output_port, nframes);
+
+    if (!pair_ptr->midi)
+    {
+      memcpy(output, input, nframes * sizeof(jack_default_audio_sample_t));
+    }
+    else
     {
-      jack_midi_event_write(output, midi_event.time, midi_event.buffer, midi_event.size);
-      midi_event_index++;
+      jack_midi_clear_buffer(output);
+      midi_event_index = 0;
+      while (jack_midi_event_get(&midi_event, input, midi_event_index) == 0)
+      {
+        jack_midi_event_write(output, midi_event.time, midi_event.buffer, midi_event.size);
+        midi_event_index++;
+      }
     }
   }
 
+exit:
+  __atomic_add_fetch(&g_process_sequence, 1, __ATOMIC_SEQ_CST);
   return 0;
 }
 
-#undef pair_ptr
+/* Wait until the process callback is guaranteed not to use the previously published pairs array.
+ * The callback never blocks and increments the sequence on every exit, so the wait is not bounded
+ * by a timeout: freeing the array while the callback may still read it is never safe. */
+static void wait_process_callback(void)
+{
+  unsigned int sequence;
+  unsigned int retries;
 
-static void destroy_pair(struct port_pair * pair_ptr)
+  sequence = __atomic_load_n(&g_process_sequence, __ATOMIC_SEQ_CST);
+  if ((sequence & 1) == 0)
+  {
+    /* Process callback is not running. When it runs, it will see the new array */
+    return;
+  }
+
+  retries = 0;
+  while (__atomic_load_n(&g_process_sequence, __ATOMIC_SEQ_CST) == sequence)
+  {
+    retries++;
+    if (retries % 10000 == 0)   /* every second */
+    {
+      log_error("JACK process cycle did not complete for %u seconds, still waiting", retries / 10000);
+    }
+
+    usleep(100);
+  }
+}
+
+/* Publish the current contents of g_pairs to the process callback */
+static bool publish_pairs(void)
 {
-  list_del(&pair_ptr->siblings);
-  jack_client_close(pair_ptr->client);
+  struct pairs_array * new_array_ptr;
+  struct pairs_array * old_array_ptr;
+  struct list_head * node_ptr;
+  unsigned int count;
+
+  count = 0;
+  list_for_each(node_ptr, &g_pairs)
+  {
+    count++;
+  }
+
+  new_array_ptr = malloc(sizeof(struct pairs_array) + count * sizeof(struct port_pair *));
+  if (new_array_ptr == NULL)
+  {
+    log_error("Allocation of port pairs array failed");
+    return false;
+  }
+
+  new_array_ptr->count = 0;
+  list_for_each(node_ptr, &g_pairs)
+  {
+    new_array_ptr->pairs[new_array_ptr->count++] = list_entry(node_ptr, struct port_pair, siblings);
+  }
+
+  old_array_ptr = __atomic_exchange_n(&g_pairs_array, new_array_ptr, __ATOMIC_SEQ_CST);
+  wait_process_callback();
+  free(old_array_ptr);
+
+  return true;
+}
+
+static bool open_client(void)
+{
+  int ret;
+
+  ASSERT(g_client == NULL);
+
+  g_client_dead = false;
+  g_pairs_array = NULL;
+  g_process_sequence = 0;
+
+  g_client = jack_client_open("jmcore", JackNoStartServer, NULL);
+  if (g_client == NULL)
+  {
+    log_error("Cannot connect to JACK server");
+    return false;
+  }
+
+  ret = jack_set_process_callback(g_client, process_callback, NULL);
+  if (ret != 0)
+  {
+    log_error("JACK process callback setup failed");
+    goto close_client;
+  }
+
+  jack_on_shutdown(g_client, shutdown_callback, NULL);
+
+  ret = jack_activate(g_client);
+  if (ret != 0)
+  {
+    log_error("JACK client activation failed");
+    goto close_client;
+  }
+
+  log_info("JACK client '%s' opened", jack_get_client_name(g_client));
+  return true;
+
+close_client:
+  jack_client_close(g_client);
+  g_client = NULL;
+  return false;
+}
+
+static void close_client(void)
+{
+  ASSERT(g_client != NULL);
+  ASSERT(list_empty(&g_pairs));
+
+  jack_client_close(g_client);
+  g_client = NULL;
+
+  free(g_pairs_array);
+  g_pairs_array = NULL;
+
+  log_info("JACK client closed");
+}
+
+static void free_pair(struct port_pair * pair_ptr)
+{
+  if (!g_client_dead)
+  {
+    jack_port_unregister(g_client, pair_ptr->output_port);
+    jack_port_unregister(g_client, pair_ptr->input_port);
+  }
+
   free(pair_ptr->input_port_name);
   free(pair_ptr->output_port_name);
   free(pair_ptr);
 }
 
+static void destroy_pair(struct port_pair * pair_ptr)
+{
+  struct pairs_array * old_array_ptr;
+
+  list_del(&pair_ptr->siblings);
+  if (!publish_pairs())
+  {
+    /* The process callback may still reference the pair,
+     * stop processing so it can be released safely */
+    old_array_ptr = __atomic_exchange_n(&g_pairs_array, NULL, __ATOMIC_SEQ_CST);
+    wait_process_callback();
+    free(old_array_ptr);
+  }
+
+  free_pair(pair_ptr);
+
+  if (list_empty(&g_pairs))
+  {
+    close_client();
+  }
+}
+
 static void bury_zombie_pairs(void)
 {
-  struct list_head * node_ptr;
-  struct list_head * temp_node_ptr;
   struct port_pair * pair_ptr;
+  struct pairs_array * old_array_ptr;
 
-  list_for_each_safe(node_ptr, temp_node_ptr, &g_pairs)
+  if (g_client == NULL || !__atomic_load_n(&g_client_dead, __ATOMIC_SEQ_CST))
   {
-    pair_ptr = list_entry(node_ptr, struct port_pair, siblings);
-    if (pair_ptr->dead)
-    {
-      log_info("Bury zombie '%s':'%s'", pair_ptr->input_port_name, pair_ptr->output_port_name);
-      destroy_pair(pair_ptr);
-    }
+    return;
   }
+
+  /* JACK server is gone, all pairs die with the client */
+  old_array_ptr = __atomic_exchange_n(&g_pairs_array, NULL, __ATOMIC_SEQ_CST);
+  wait_process_callback();
+  free(old_array_ptr);
+  while (!list_empty(&g_pairs))
+  {
+    pair_ptr = list_entry(g_pairs.next, struct port_pair, siblings);
+    log_info("Bury zombie '%s':'%s'", pair_ptr->input_port_name, pair_ptr->output_port_name);
+    list_del(&pair_ptr->siblings);
+    free_pair(pair_ptr);
+  }
+
+  close_client();
 }
 
 static bool connect_dbus(void)
@@ -227,6 +409,7 @@ int main(int UNUSED(argc), char ** UNUSED(argv))
     bury_zombie_pairs();
   }
 
+  bury_zombie_pairs();
   while (!list_empty(&g_pairs))
   {
     destroy_pair(list_entry(g_pairs.next, struct port_pair, siblings));
@@ -254,11 +437,6 @@ static void jmcore_create(struct cdbus_method_call * call_ptr)
   const char * input;
   const char * output;
   struct port_pair * pair_ptr;
-  int ret;
-  char client_name[256];
-
-  g_unique_index++;
-  sprintf(client_name, "jmcore-%u", g_unique_index);
 
   dbus_error_init(&cdbus_g_dbus_error);
   if (!dbus_message_get_args(
@@ -274,6 +452,9 @@ static void jmcore_create(struct cdbus_method_call * call_ptr)
     goto exit;
   }
 
+  /* the client of the previous JACK server instance is closed here */
+  bury_zombie_pairs();
+
   pair_ptr = malloc(sizeof(struct port_pair));
   if (pair_ptr == NULL)
   {
@@ -289,40 +470,29 @@ static void jmcore_create(struct cdbus_method_call * call_ptr)
   }
 
   pair_ptr->output_port_name = strdup(output);
-  if (pair_ptr->input_port_name == NULL)
+  if (pair_ptr->output_port_name == NULL)
   {
     cdbus_error(call_ptr, DBUS_ERROR_FAILED, "Allocation of port name buffer failed");
     goto free_input_name;
   }
 
-  pair_ptr->client = jack_client_open(client_name, JackNoStartServer, NULL);
-  if (pair_ptr->client == NULL)
+  if (g_client == NULL && !open_client())
   {
     cdbus_error(call_ptr, DBUS_ERROR_FAILED, "Cannot connect to JACK server");
     goto free_output_name;
   }
 
   pair_ptr->midi = midi;
-  pair_ptr->dead = false;
-
-  ret = jack_set_process_callback(pair_ptr->client, process_callback, pair_ptr);
-  if (ret != 0)
-  {
-    cdbus_error(call_ptr, DBUS_ERROR_FAILED, "JACK process callback setup failed");
-    goto close_client;
-  }
 
-  jack_on_shutdown(pair_ptr->client, shutdown_callback, pair_ptr);
-
-  pair_ptr->input_port = jack_port_register(pair_ptr->client, input, midi ? JACK_DEFAULT_MIDI_TYPE : JACK_DEFAULT_AUDIO_TYPE, JackPortIsInput, 0);
+  pair_ptr->input_port = jack_port_register(g_client, input, midi ? JACK_DEFAULT_MIDI_TYPE : JACK_DEFAULT_AUDIO_TYPE, JackPortIsInput, 0);
   if (pair_ptr->input_port == NULL)
   {
     cdbus_error(call_ptr, DBUS_ERROR_FAILED, "Port '%s' registration failed.", input);
-    goto free_output_name;
+    goto maybe_close_client;
   }
 
-  pair_ptr->output_port = jack_port_register(pair_ptr->client, output, midi ? JACK_DEFAULT_MIDI_TYPE : JACK_DEFAULT_AUDIO_TYPE, JackPortIsOutput, 0);
-  if (pair_ptr->input_port == NULL)
+  pair_ptr->output_port = jack_port_register(g_client, output, midi ? JACK_DEFAULT_MIDI_TYPE : JACK_DEFAULT_AUDIO_TYPE, JackPortIsOutput, 0);
+  if (pair_ptr->output_port == NULL)
   {
     cdbus_error(call_ptr, DBUS_ERROR_FAILED, "Port '%s' registration failed.", output);
     goto unregister_input_port;
@@ -330,10 +500,9 @@ static void jmcore_create(struct cdbus_method_call * call_ptr)
 
   list_add_tail(&pair_ptr->siblings, &g_pairs);
 
-  ret = jack_activate(pair_ptr->client);
-  if (ret != 0)
+  if (!publish_pairs())
   {
-    cdbus_error(call_ptr, DBUS_ERROR_FAILED, "JACK client activation failed");
+    cdbus_error(call_ptr, DBUS_ERROR_FAILED, "Activation of port pair failed");
     goto remove_from_list;
   }
 
@@ -343,11 +512,14 @@ static void jmcore_create(struct cdbus_method_call * call_ptr)
 remove_from_list:
   list_del(&pair_ptr->siblings);
 //unregister_output_port:
-  jack_port_unregister(pair_ptr->client, pair_ptr->output_port);
+  jack_port_unregister(g_client, pair_ptr->output_port);
 unregister_input_port:
-  jack_port_unregister(pair_ptr->client, pair_ptr->input_port);
-close_client:
-  jack_client_close(pair_ptr->client);
+  jack_port_unregister(g_client, pair_ptr->input_port);
+maybe_close_client:
+  if (list_empty(&g_pairs))
+  {
+    close_client();
+  }
 free_output_name:
   free(pair_ptr->output_port_name);
 free_input_name:
@@ -36,6 +36,7 @@
 #define ANSI_RESET      "\033[0m"
 
 #include <stdio.h>
+#include <stdbool.h>
 
 #include "config.h"
 
@@ -65,6 +66,26 @@ ladish_log(
 #endif
   ;
 
+/* Switch to asynchronous logging. Messages are queued by the calling
+ * thread and written by a background thread. Opt-in, per process. */
+#ifdef __cplusplus
+extern "C"
+#endif
+bool ladish_log_async_start(void);
+
+/* write queued messages and switch back to synchronous logging */
+#ifdef __cplusplus
+extern "C"
+#endif
+void ladish_log_async_stop(void);
+
+/* Write queued messages, logging stays synchronous afterwards.
+ * Meant for crash handlers. */
+#ifdef __cplusplus
+extern "C"
+#endif
+void ladish_log_flush(void);
+
 #define LADISH_LOG_LEVEL_DEBUG        0
 #define LADISH_LOG_LEVEL_INFO         1
 #define LADISH_LOG_LEVEL_WARN         2
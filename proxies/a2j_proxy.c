@@ -25,6 +25,7 @@
  */
 
 #include "a2j_proxy.h"
+#include "../common/hash.h"
 
 #define A2J_SERVICE       "org.gna.home.a2jmidid"
 #define A2J_OBJECT        "/"
@@ -33,6 +34,143 @@
 static bool g_a2j_started = false;
 static char * g_a2j_jack_client_name = NULL;
 
+/* JACK port name to ALSA client/port mapping, valid while the bridge is running */
+struct a2j_port_map
+{
+  struct list_head siblings;
+  struct ladish_hash_node jack_port_name_node; /* link for the g_a2j_port_maps_by_name hash */
+  char * jack_port_name;
+  char * alsa_client_name;
+  char * alsa_port_name;
+  uint32_t alsa_client_id;
+};
+
+/* map_jack_port_to_alsa call that is in flight */
+struct a2j_map_request
+{
+  struct list_head siblings;
+  DBusPendingCall * pending_call_ptr;
+  unsigned int generation;
+  void * context;
+  a2j_proxy_map_callback callback;
+  char jack_port_name[];
+};
+
+static LIST_HEAD(g_a2j_port_maps);
+static struct ladish_hash g_a2j_port_maps_by_name;
+static LIST_HEAD(g_a2j_map_requests);
+
+/* incremented on each cache invalidation, replies to calls made before it are not cached */
+static unsigned int g_a2j_map_generation;
+
+static void a2j_port_map_destroy(struct a2j_port_map * map_ptr)
+{
+  list_del(&map_ptr->siblings);
+  ladish_hash_del(&g_a2j_port_maps_by_name, &map_ptr->jack_port_name_node);
+  free(map_ptr->jack_port_name);
+  free(map_ptr->alsa_client_name);
+  free(map_ptr->alsa_port_name);
+  free(map_ptr);
+}
+
+static void a2j_proxy_invalidate_port_maps(void)
+{
+  while (!list_empty(&g_a2j_port_maps))
+  {
+    a2j_port_map_destroy(list_entry(g_a2j_port_maps.next, struct a2j_port_map, siblings));
+  }
+
+  g_a2j_map_generation++;
+}
+
+static struct a2j_port_map * a2j_port_map_find(const char * jack_port_name)
+{
+  struct hlist_node * node_ptr;
+  struct a2j_port_map * map_ptr;
+  uint32_t hash;
+
+  hash = ladish_hash_string(jack_port_name);
+  ladish_hash_for_each_possible(map_ptr, node_ptr, &g_a2j_port_maps_by_name, jack_port_name_node, hash)
+  {
+    if (strcmp(map_ptr->jack_port_name, jack_port_name) == 0)
+    {
+      return map_ptr;
+    }
+  }
+
+  return NULL;
+}
+
+static
+struct a2j_port_map *
+a2j_port_map_add(
+  const char * jack_port_name,
+  const char * alsa_client_name,
+  const char * alsa_port_name,
+  uint32_t alsa_client_id)
+{
+  struct a2j_port_map * map_ptr;
+
+  map_ptr = a2j_port_map_find(jack_port_name);
+  if (map_ptr != NULL)
+  {
+    a2j_port_map_destroy(map_ptr);
+  }
+
+  map_ptr = malloc(sizeof(struct a2j_port_map));
+  if (map_ptr == NULL)
+  {
+    log_error("malloc() failed for struct a2j_port_map");
+    goto fail;
+  }
+
+  map_ptr->jack_port_name = strdup(jack_port_name);
+  if (map_ptr->jack_port_name == NULL)
+  {
+    log_error("strdup() failed for a2j jack port name string");
+    goto free_struct;
+  }
+
+  map_ptr->alsa_client_name = strdup(alsa_client_name);
+  if (map_ptr->alsa_client_name == NULL)
+  {
+    log_error("strdup() failed for a2j alsa client name string");
+    goto free_jack_port_name;
+  }
+
+  map_ptr->alsa_port_name = strdup(alsa_port_name);
+  if (map_ptr->alsa_port_name == NULL)
+  {
+    log_error("strdup() failed for a2j alsa port name string");
+    goto free_alsa_client_name;
+  }
+
+  map_ptr->alsa_client_id = alsa_client_id;
+  list_add_tail(&map_ptr->siblings, &g_a2j_port_maps);
+  ladish_hash_add(&g_a2j_port_maps_by_name, &map_ptr->jack_port_name_node, ladish_hash_string(jack_port_name));
+
+  return map_ptr;
+
+free_alsa_client_name:
+  free(map_ptr->alsa_client_name);
+free_jack_port_name:
+  free(map_ptr->jack_port_name);
+free_struct:
+  free(map_ptr);
+fail:
+  return NULL;
+}
+
+/* for requests that were not replied yet */
+static void a2j_map_request_destroy(struct a2j_map_request * request_ptr)
+{
+  list_del(&request_ptr->siblings);
+  /* otherwise the reply would be dispatched to the freed request */
+  dbus_pending_call_cancel(request_ptr->pending_call_ptr);
+  dbus_pending_call_unref(request_ptr->pending_call_ptr);
+  free(request_ptr);
+}
+
 static
 void
 on_a2j_bridge_started(
@@ -47,6 +185,8 @@ on_a2j_bridge_started(
     g_a2j_jack_client_name = NULL;
   }
 
+  a2j_proxy_invalidate_port_maps();
+
   g_a2j_started = true;
 }
 
@@ -62,6 +202,8 @@ on_a2j_bridge_stopped(
     g_a2j_jack_client_name = NULL;
   }
 
+  a2j_proxy_invalidate_port_maps();
+
   g_a2j_started = false;
 
   log_info("a2j bridge stop detected.");
@@ -77,6 +219,8 @@ static void on_a2j_life_status_changed(bool appeared)
   {
       log_info("a2j deactivatation detected.");
   }
+
+  a2j_proxy_invalidate_port_maps();
 }
 
 /* this must be static because it is referenced by the
@@ -90,6 +234,12 @@ static struct cdbus_signal_hook g_signal_hooks[] =
 
 bool a2j_proxy_init(void)
 {
+  if (!ladish_hash_init(&g_a2j_port_maps_by_name))
+  {
+    log_error("ladish_hash_init() failed for a2j port maps");
+    return false;
+  }
+
   g_a2j_started = a2j_proxy_is_started();
   if (g_a2j_started)
   {
@@ -99,7 +249,7 @@ bool a2j_proxy_init(void)
   if (!cdbus_register_service_lifetime_hook(cdbus_g_dbus_connection, A2J_SERVICE, on_a2j_life_status_changed))
   {
     log_error("dbus_register_service_lifetime_hook() failed for a2j service");
-    return false;
+    goto uninit_hash;
   }
 
   if (!cdbus_register_object_signal_hooks(
@@ -112,14 +262,28 @@ bool a2j_proxy_init(void)
   {
     cdbus_unregister_service_lifetime_hook(cdbus_g_dbus_connection, A2J_SERVICE);
     log_error("dbus_register_object_signal_hooks() failed for a2j control interface");
-    return false;
+    goto uninit_hash;
   }
 
   return true;
+
+uninit_hash:
+  free(g_a2j_jack_client_name);
+  g_a2j_jack_client_name = NULL;
+  ladish_hash_uninit(&g_a2j_port_maps_by_name);
+  return false;
 }
 
 void a2j_proxy_uninit(void)
 {
+  while (!list_empty(&g_a2j_map_requests))
+  {
+    a2j_map_request_destroy(list_entry(g_a2j_map_requests.next, struct a2j_map_request, siblings));
+  }
+
+  a2j_proxy_invalidate_port_maps();
+  ladish_hash_uninit(&g_a2j_port_maps_by_name);
+
   cdbus_unregister_object_signal_hooks(cdbus_g_dbus_connection, A2J_SERVICE, A2J_OBJECT, A2J_IFACE_CONTROL);
   cdbus_unregister_service_lifetime_hook(cdbus_g_dbus_connection, A2J_SERVICE);
 }
@@ -166,66 +330,180 @@ bool a2j_proxy_get_jack_client_name_noncached(char ** client_name_ptr_ptr)
   return true;
 }
 
+static
 bool
-a2j_proxy_map_jack_port(
-    const char * jack_port_name,
-    char ** alsa_client_name_ptr_ptr,
-    char ** alsa_port_name_ptr_ptr,
-    uint32_t * alsa_client_id_ptr)
+a2j_proxy_decode_map_reply(
+  DBusMessage * reply_ptr,
+  const char ** alsa_client_name_ptr,
+  const char ** alsa_port_name_ptr,
+  dbus_uint32_t * alsa_client_id_ptr)
 {
-  DBusMessage * reply_ptr;
-  dbus_uint32_t alsa_client_id;
   dbus_uint32_t alsa_port_id;
-  const char * alsa_client_name;
-  const char * alsa_port_name;
-
-  if (!cdbus_call(0, A2J_SERVICE, A2J_OBJECT, A2J_IFACE_CONTROL, "map_jack_port_to_alsa", "s", &jack_port_name, NULL, &reply_ptr))
-  {
-    log_error("a2j::map_jack_port_to_alsa() failed.");
-    return false;
-  }
 
   if (!dbus_message_get_args(
         reply_ptr,
         &cdbus_g_dbus_error,
         DBUS_TYPE_UINT32,
-        &alsa_client_id,
+        alsa_client_id_ptr,
         DBUS_TYPE_UINT32,
         &alsa_port_id,
         DBUS_TYPE_STRING,
-        &alsa_client_name,
+        alsa_client_name_ptr,
         DBUS_TYPE_STRING,
-        &alsa_port_name,
+        alsa_port_name_ptr,
         DBUS_TYPE_INVALID))
   {
-    dbus_message_unref(reply_ptr);
+    log_error("decoding reply of map_jack_port_to_alsa failed: %s", cdbus_g_dbus_error.message);
     dbus_error_free(&cdbus_g_dbus_error);
-    log_error("decoding reply of map_jack_port_to_alsa failed.");
     return false;
   }
 
-  *alsa_client_name_ptr_ptr = strdup(alsa_client_name);
-  if (*alsa_client_name_ptr_ptr == NULL)
+  return true;
+}
+
+bool
+a2j_proxy_lookup_jack_port(
+  const char * jack_port_name,
+  struct a2j_proxy_port_mapping * mapping_ptr)
+{
+  struct a2j_port_map * map_ptr;
+
+  map_ptr = a2j_port_map_find(jack_port_name);
+  if (map_ptr == NULL)
   {
-    dbus_message_unref(reply_ptr);
-    log_error("strdup() failed for a2j alsa client name string");
     return false;
   }
-  
-  *alsa_port_name_ptr_ptr = strdup(alsa_port_name);
-  if (*alsa_port_name_ptr_ptr == NULL)
+
+  mapping_ptr->alsa_client_name = map_ptr->alsa_client_name;
+  mapping_ptr->alsa_port_name = map_ptr->alsa_port_name;
+  mapping_ptr->alsa_client_id = map_ptr->alsa_client_id;
+  return true;
+}
+
+static void a2j_proxy_on_map_reply(DBusPendingCall * pending_call_ptr, void * data)
+{
+  struct a2j_map_request * request_ptr;
+  DBusMessage * reply_ptr;
+  struct a2j_proxy_port_mapping mapping;
+  struct a2j_proxy_port_mapping * mapping_ptr;
+
+  request_ptr = data;
+  ASSERT(request_ptr->pending_call_ptr == pending_call_ptr);
+
+  /* the request is not cancelable anymore */
+  list_del_init(&request_ptr->siblings);
+
+  mapping_ptr = NULL;
+
+  reply_ptr = dbus_pending_call_steal_reply(pending_call_ptr);
+  if (reply_ptr == NULL)
+  {
+    log_error("no reply for a2j::map_jack_port_to_alsa(\"%s\")", request_ptr->jack_port_name);
+  }
+  else if (dbus_message_get_type(reply_ptr) == DBUS_MESSAGE_TYPE_ERROR)
+  {
+    log_error("a2j::map_jack_port_to_alsa(\"%s\") failed: %s", request_ptr->jack_port_name, dbus_message_get_error_name(reply_ptr));
+  }
+  else if (a2j_proxy_decode_map_reply(reply_ptr, &mapping.alsa_client_name, &mapping.alsa_port_name, &mapping.alsa_client_id))
+  {
+    if (request_ptr->generation == g_a2j_map_generation)
+    {
+      a2j_port_map_add(request_ptr->jack_port_name, mapping.alsa_client_name, mapping.alsa_port_name, mapping.alsa_client_id);
+    }
+
+    mapping_ptr = &mapping;
+  }
+
+  request_ptr->callback(request_ptr->context, request_ptr->jack_port_name, mapping_ptr);
+
+  if (reply_ptr != NULL)
   {
     dbus_message_unref(reply_ptr);
-    log_error("strdup() failed for a2j alsa port name string");
-    free(*alsa_client_name_ptr_ptr);
+  }
+
+  dbus_pending_call_unref(pending_call_ptr);
+  free(request_ptr);
+}
+
+bool
+a2j_proxy_map_jack_port_async(
+  const char * jack_port_name,
+  void * context,
+  a2j_proxy_map_callback callback)
+{
+  struct a2j_map_request * request_ptr;
+  DBusMessage * message_ptr;
+  size_t len;
+
+  len = strlen(jack_port_name) + 1;
+  request_ptr = malloc(sizeof(struct a2j_map_request) + len);
+  if (request_ptr == NULL)
+  {
+    log_error("malloc() failed for struct a2j_map_request");
     return false;
   }
 
-  *alsa_client_id_ptr = alsa_client_id;
+  memcpy(request_ptr->jack_port_name, jack_port_name, len);
+  request_ptr->generation = g_a2j_map_generation;
+  request_ptr->context = context;
+  request_ptr->callback = callback;
 
-  dbus_message_unref(reply_ptr);
+  message_ptr = dbus_message_new_method_call(A2J_SERVICE, A2J_OBJECT, A2J_IFACE_CONTROL, "map_jack_port_to_alsa");
+  if (message_ptr == NULL)
+  {
+    log_error("dbus_message_new_method_call() failed");
+    goto free_request;
+  }
+
+  if (!dbus_message_append_args(message_ptr, DBUS_TYPE_STRING, &jack_port_name, DBUS_TYPE_INVALID))
+  {
+    log_error("dbus_message_append_args() failed");
+    goto unref_message;
+  }
+
+  /* the reply is not waited for, calls for many ports are pipelined */
+  if (!dbus_connection_send_with_reply(cdbus_g_dbus_connection, message_ptr, &request_ptr->pending_call_ptr, DBUS_TIMEOUT_USE_DEFAULT) ||
+      request_ptr->pending_call_ptr == NULL)
+  {
+    log_error("dbus_connection_send_with_reply() failed for map_jack_port_to_alsa()");
+    goto unref_message;
+  }
+
+  dbus_message_unref(message_ptr);
+
+  if (!dbus_pending_call_set_notify(request_ptr->pending_call_ptr, a2j_proxy_on_map_reply, request_ptr, NULL))
+  {
+    log_error("dbus_pending_call_set_notify() failed");
+    dbus_pending_call_cancel(request_ptr->pending_call_ptr);
+    dbus_pending_call_unref(request_ptr->pending_call_ptr);
+    goto free_request;
+  }
+
+  list_add_tail(&request_ptr->siblings, &g_a2j_map_requests);
 
   return true;
+
+unref_message:
+  dbus_message_unref(message_ptr);
+free_request:
+  free(request_ptr);
+  return false;
+}
+
+void a2j_proxy_cancel_map_requests(void * context)
+{
+  struct list_head * node_ptr;
+  struct list_head * next_ptr;
+  struct a2j_map_request * request_ptr;
+
+  list_for_each_safe(node_ptr, next_ptr, &g_a2j_map_requests)
+  {
+    request_ptr = list_entry(node_ptr, struct a2j_map_request, siblings);
+    if (request_ptr->context == context)
+    {
+      a2j_map_request_destroy(request_ptr);
+    }
+  }
 }
 
 bool a2j_proxy_is_started(void)
@@ -34,12 +34,38 @@ void a2j_proxy_uninit(void);
 const char * a2j_proxy_get_jack_client_name_cached(void);
 bool a2j_proxy_get_jack_client_name_noncached(char ** client_name_ptr_ptr);
 
+struct a2j_proxy_port_mapping
+{
+  const char * alsa_client_name;
+  const char * alsa_port_name;
+  uint32_t alsa_client_id;
+};
+
+/* mapping_ptr is NULL when the mapping failed */
+typedef
+void
+(* a2j_proxy_map_callback)(
+  void * context,
+  const char * jack_port_name,
+  const struct a2j_proxy_port_mapping * mapping_ptr);
+
+/* Lookup in the mapping cache only. Strings stay valid until the next
+ * return to the main loop. The cache is invalidated when the bridge
+ * is started or stopped. */
 bool
-a2j_proxy_map_jack_port(
-    const char * jack_port_name,
-    char ** alsa_client_name_ptr_ptr,
-    char ** alsa_port_name_ptr_ptr,
-    uint32_t * alsa_client_id_ptr);
+a2j_proxy_lookup_jack_port(
+  const char * jack_port_name,
+  struct a2j_proxy_port_mapping * mapping_ptr);
+
+/* The callback is called from the main loop when a2jmidid replies,
+ * unless the request is cancelled before that. */
+bool
+a2j_proxy_map_jack_port_async(
+  const char * jack_port_name,
+  void * context,
+  a2j_proxy_map_callback callback);
+
+void a2j_proxy_cancel_map_requests(void * context);
 
 bool a2j_proxy_is_started(void);
 bool a2j_proxy_start_bridge(void);
@@ -598,6 +598,105 @@ graph_proxy_disconnect_ports(
   return true;
 }
 
+/* Send all requests first and only then wait for the replies, so the round trips overlap */
+static
+void
+graph_proxy_call_ports_pipelined(
+  graph_proxy_handle graph,
+  const char * method,
+  unsigned int count,
+  const uint64_t * port_ids,
+  bool * results)
+{
+  DBusPendingCall ** pending_calls;
+  DBusMessage * message_ptr;
+  unsigned int i;
+
+  for (i = 0; i < count; i++)
+  {
+    results[i] = false;
+  }
+
+  pending_calls = calloc(count, sizeof(DBusPendingCall *));
+  if (pending_calls == NULL)
+  {
+    log_error("calloc() failed for %u pending calls", count);
+    return;
+  }
+
+  for (i = 0; i < count; i++)
+  {
+    message_ptr = cdbus_new_method_call_message(
+      graph_ptr->service,
+      graph_ptr->object,
+      JACKDBUS_IFACE_PATCHBAY,
+      method,
+      "tt",
+      port_ids + i * 2,
+      port_ids + i * 2 + 1);
+    if (message_ptr == NULL)
+    {
+      continue;
+    }
+
+    if (!dbus_connection_send_with_reply(cdbus_g_dbus_connection, message_ptr, pending_calls + i, DBUS_TIMEOUT_USE_DEFAULT))
+    {
+      log_error("dbus_connection_send_with_reply() failed for %s()", method);
+      pending_calls[i] = NULL;
+    }
+
+    dbus_message_unref(message_ptr);
+  }
+
+  for (i = 0; i < count; i++)
+  {
+    if (pending_calls[i] == NULL)
+    {
+      continue;
+    }
+
+    dbus_pending_call_block(pending_calls[i]);
+    message_ptr = dbus_pending_call_steal_reply(pending_calls[i]);
+    if (message_ptr != NULL)
+    {
+      if (dbus_message_get_type(message_ptr) == DBUS_MESSAGE_TYPE_ERROR)
+      {
+        log_error("%s(%"PRIu64", %"PRIu64") failed: %s", method, port_ids[i * 2], port_ids[i * 2 + 1], dbus_message_get_error_name(message_ptr));
+      }
+      else
+      {
+        results[i] = true;
+      }
+
+      dbus_message_unref(message_ptr);
+    }
+
+    dbus_pending_call_unref(pending_calls[i]);
+  }
+
+  free(pending_calls);
+}
+
+void
+graph_proxy_connect_ports_batch(
+  graph_proxy_handle graph,
+  unsigned int count,
+  const uint64_t * port_ids,
+  bool * results)
+{
+  graph_proxy_call_ports_pipelined(graph, "ConnectPortsByID", count, port_ids, results);
+}
+
+void
+graph_proxy_disconnect_ports_batch(
+  graph_proxy_handle graph,
+  unsigned int count,
+  const uint64_t * port_ids,
+  bool * results)
+{
+  graph_proxy_call_ports_pipelined(graph, "DisconnectPortsByID", count, port_ids, results);
+}
+
 static void on_client_appeared(void * graph, DBusMessage * message_ptr)
 {
   dbus_uint64_t new_graph_version;
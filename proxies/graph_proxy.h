@@ -88,6 +88,21 @@ graph_proxy_disconnect_ports(
   uint64_t port1_id,
   uint64_t port2_id);
 
+/* port_ids contains count pairs of port ids, results receives status of each pair */
+void
+graph_proxy_connect_ports_batch(
+  graph_proxy_handle graph,
+  unsigned int count,
+  const uint64_t * port_ids,
+  bool * results);
+
+void
+graph_proxy_disconnect_ports_batch(
+  graph_proxy_handle graph,
+  unsigned int count,
+  const uint64_t * port_ids,
+  bool * results);
+
 bool
 graph_proxy_dict_entry_set(
   graph_proxy_handle graph,